@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "SyntheticData.hpp"
+
+namespace {
+
+  constexpr int conceptDepth = 8;
+
+  /** Node of the random tree that assigns the classes. */
+  struct ConceptNode {
+    size_t column;
+    double value;      // threshold, or category index
+    size_t label;      // class of a leaf
+    bool leaf;
+  };
+
+  struct Column {
+    double mean;
+    double scale;
+  };
+
+  /** Complete binary tree in heap order: the children of n are 2n + 1 and 2n + 2. */
+  std::vector<ConceptNode> drawConcept(const SyntheticSpec& spec, const std::vector<Column>& columns,
+                                       std::mt19937_64& rng) {
+    const size_t numColumns = spec.numeric + spec.categorical;
+    std::normal_distribution<double> normal;
+    std::vector<ConceptNode> nodes((size_t(1) << (conceptDepth + 1)) - 1);
+    for (size_t n = 0; n < nodes.size(); n++) {
+      if (n >= (size_t(1) << conceptDepth) - 1 || numColumns == 0) {
+        nodes[n] = ConceptNode{0, 0.0, rng() % spec.classes, true};
+        continue;
+      }
+      const size_t col = rng() % numColumns;
+      const double value = col < spec.numeric
+          ? std::round(columns[col].mean + columns[col].scale * normal(rng))
+          : static_cast<double>(rng() % spec.cardinality);
+      nodes[n] = ConceptNode{col, value, 0, false};
+    }
+    return nodes;
+  }
+
+}
+
+void SyntheticData::writeArff(const SyntheticSpec& spec, const std::string& filename, uint64_t stream) {
+  if (spec.classes == 0 || spec.cardinality == 0)
+    throw std::invalid_argument("A data set needs at least one class and one category per column");
+  std::ofstream out(filename);
+  if (!out)
+    throw std::runtime_error("Can't open file: " + filename);
+
+  std::mt19937_64 conceptRng(spec.seed);
+  std::vector<Column> columns(spec.numeric);
+  for (auto& column: columns)
+    column = Column{static_cast<double>(conceptRng() % 3000), static_cast<double>(10 + conceptRng() % 500)};
+  const auto concept = drawConcept(spec, columns, conceptRng);
+
+  out << "@relation synthetic\n\n";
+  for (size_t col = 0; col < spec.numeric; col++)
+    out << "@attribute n" << col << " numeric\n";
+  for (size_t col = 0; col < spec.categorical; col++) {
+    out << "@attribute c" << col << " {";
+    for (size_t v = 0; v < spec.cardinality; v++)
+      out << (v > 0 ? "," : "") << "v" << v;
+    out << "}\n";
+  }
+  out << "@attribute class {";
+  for (size_t c = 0; c < spec.classes; c++)
+    out << (c > 0 ? "," : "") << "class" << c;
+  out << "}\n\n@data\n";
+
+  std::mt19937_64 rng(spec.seed * 0x9E3779B97F4A7C15ull + stream + 1);
+  std::normal_distribution<double> normal;
+  std::uniform_real_distribution<double> uniform;
+  std::vector<double> row(spec.numeric + spec.categorical);
+  for (size_t r = 0; r < spec.rows; r++) {
+    for (size_t col = 0; col < spec.numeric; col++)
+      row[col] = std::round(columns[col].mean + columns[col].scale * normal(rng));
+    for (size_t col = spec.numeric; col < row.size(); col++)
+      row[col] = static_cast<double>(rng() % spec.cardinality);
+
+    size_t n = 0;
+    while (!concept[n].leaf) {
+      const ConceptNode& node = concept[n];
+      const bool answer = node.column < spec.numeric ? row[node.column] >= node.value : row[node.column] == node.value;
+      n = 2 * n + (answer ? 1 : 2);
+    }
+    const size_t label = uniform(rng) < spec.noise ? rng() % spec.classes : concept[n].label;
+
+    for (size_t col = 0; col < spec.numeric; col++)
+      out << static_cast<long long>(row[col]) << ',';
+    for (size_t col = spec.numeric; col < row.size(); col++)
+      out << 'v' << static_cast<size_t>(row[col]) << ',';
+    out << "class" << label << '\n';
+  }
+  if (!out)
+    throw std::runtime_error("Can't write file: " + filename);
+}
+
+std::string SyntheticData::fileName(const SyntheticSpec& spec, const std::string& suffix) {
+  return "synthetic_" + std::to_string(spec.rows) + "_" + std::to_string(spec.numeric) + "n"
+         + std::to_string(spec.categorical) + "c" + std::to_string(spec.cardinality) + "v"
+         + std::to_string(spec.classes) + "k" + std::to_string(std::lround(spec.noise * 100)) + "p_"
+         + std::to_string(spec.seed) + suffix + ".arff";
+}
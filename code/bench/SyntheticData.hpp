@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_SYNTHETICDATA_HPP
+#define DECISIONTREE_SYNTHETICDATA_HPP
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Shape of a synthetic classification data set. The defaults mimic covtype:
+ * integer-valued numeric columns, a few categorical ones and 7 classes.
+ */
+struct SyntheticSpec {
+  size_t rows = 10000;
+  size_t numeric = 10;
+  size_t categorical = 4;
+  size_t cardinality = 10;
+  size_t classes = 7;
+  // Fraction of the rows that get a random class instead of the true one.
+  double noise = 0.05;
+  uint64_t seed = 1;
+};
+
+namespace SyntheticData {
+
+/**
+ * Write `spec.rows` rows to an ARFF file. The class of a row is given by a
+ * random tree of depth 8 drawn from `spec.seed`, so every file written
+ * with the same spec follows the same concept; `stream` selects the rows,
+ * e.g. 0 for a training set and 1 for its test set. Rows are written as
+ * they are drawn, so files of any size need little memory.
+ */
+void writeArff(const SyntheticSpec& spec, const std::string& filename, uint64_t stream);
+
+/** File name that identifies the spec, for caching generated files. */
+std::string fileName(const SyntheticSpec& spec, const std::string& suffix);
+
+}
+
+#endif //DECISIONTREE_SYNTHETICDATA_HPP
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <chrono>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include "../lib/include/BatchTrainer.hpp"
+#include "SyntheticData.hpp"
+
+/**
+ * Throughput of training many small trees, one per tenant.
+ *
+ * --tenants data sets of --rows rows are generated (or reused from --dir),
+ * each with its own concept. All trees are first trained the naive way,
+ * every tree started with std::async and built with the default parallel
+ * builder, and then with BatchTrainer on pools of every size in --workers.
+ * Models per second are printed for every run; with a pool per core they
+ * should grow in proportion to the number of workers.
+ *
+ *   BatchTrain --tenants 500 --rows 2000 --workers 1,2,4,8
+ */
+
+int main(int argc, char** argv) {
+  size_t tenants = 200;
+  std::vector<size_t> workers{1, std::max(1u, std::thread::hardware_concurrency())};
+  std::string dir = ".";
+  SyntheticSpec spec{};
+  spec.rows = 2000;
+  bool valid = argc % 2 == 1;
+  for (int i = 1; valid && i + 1 < argc; i += 2) {
+    const std::string arg = argv[i];
+    const std::string value = argv[i + 1];
+    if (arg == "--tenants") {
+      tenants = std::stoul(value);
+    } else if (arg == "--rows") {
+      spec.rows = std::stoul(value);
+    } else if (arg == "--workers") {
+      workers.clear();
+      std::istringstream in(value);
+      std::string item;
+      while (std::getline(in, item, ','))
+        workers.push_back(std::stoul(item));
+    } else if (arg == "--dir") {
+      dir = value;
+    } else {
+      valid = false;
+    }
+  }
+  if (!valid || tenants == 0) {
+    std::cerr << "Usage: " << argv[0] << " [--tenants N] [--rows N] [--workers N,...] [--dir DIR]" << std::endl;
+    return 1;
+  }
+
+  std::vector<TrainingJob> jobs;
+  for (size_t t = 0; t < tenants; t++) {
+    spec.seed = t + 1;
+    Dataset d{};
+    d.train.filename = dir + "/" + SyntheticData::fileName(spec, "train");
+    d.test.filename = dir + "/" + SyntheticData::fileName(spec, "test");
+    struct stat st{};
+    if (::stat(d.train.filename.c_str(), &st) != 0)
+      SyntheticData::writeArff(spec, d.train.filename, 0);
+    if (::stat(d.test.filename.c_str(), &st) != 0)
+      SyntheticData::writeArff(spec, d.test.filename, 1);
+    TrainingJob job{};
+    job.data = std::make_shared<const DataReader>(d);
+    jobs.push_back(job);
+  }
+
+  const auto report = [&](const std::string& name, size_t models, double seconds) {
+    std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << seconds << " s" << std::setprecision(1) << std::setw(12)
+              << static_cast<double>(models) / seconds << " models/s" << std::endl;
+  };
+
+  {
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::future<DecisionTree>> futures;
+    for (const auto& job: jobs)
+      futures.push_back(std::async(std::launch::async, [&job]() {
+        return DecisionTree(job.data, job.weights, job.config);
+      }));
+    for (auto& future: futures)
+      future.get();
+    report("naive (async)", jobs.size(),
+           std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  }
+
+  for (const auto n: workers) {
+    // Started from a task of the pool, so the caller is one of the n workers.
+    ThreadPool pool(n);
+    const BatchResult result = pool.submit([&pool, &jobs]() { return BatchTrainer(pool).train(jobs); }).get();
+    report("batch, " + std::to_string(n) + " workers", result.trees.size(), result.seconds);
+  }
+  return 0;
+}
@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include "../lib/include/Bagging.hpp"
+#include "../lib/include/DecisionTree.hpp"
+#include "SyntheticData.hpp"
+#include "../lib/include/Memory.hpp"
+#include "../lib/include/Trace.hpp"
+
+/**
+ * End-to-end benchmark on synthetic covtype-like data.
+ *
+ * For every training set size in --rows, a data set is generated (or
+ * reused from --dir) and five phases are timed: loading the training set,
+ * training a tree, loading the test set, evaluating the tree on it and
+ * training plus evaluating a bagged ensemble of --trees trees. Each phase records wall time, CPU
+ * time, its peak resident set size and, where it applies, accuracy. The
+ * results are written as JSON to --report; with --baseline they are
+ * compared to an earlier report, and the exit code is 2 if a phase got
+ * slower by more than --tolerance or lost more than 0.01 accuracy.
+ *
+ * With --trace, the run is also traced and written as a Chrome trace, and
+ * with --counters the hardware counters of every phase are written as a
+ * table to the given file, or to stdout for "-". --memory-budget limits the
+ * resident set size to the given number of MB; a run that would exceed it
+ * stops with exit code 3. The memory held by the ensemble of the largest
+ * data set is printed after the results.
+ *
+ *   EndToEndBench --rows 10000,100000 --baseline ../bench/baseline.json
+ */
+
+namespace {
+
+  struct Options {
+    std::vector<size_t> rows{10000, 100000};
+    size_t testRows = 10000;
+    int trees = 10;
+    std::string dir = ".";
+    std::string report = "end_to_end.json";
+    std::string baseline{};
+    std::string trace{};
+    std::string counters{};
+    size_t memoryBudget = 0;   // MB
+    double tolerance = 0.25;
+    SyntheticSpec spec{};
+  };
+
+  struct Result {
+    std::string phase;
+    size_t rows;
+    double wall;          // seconds
+    double cpu;           // seconds, user + system
+    long peakRss;         // kilobytes
+    double accuracy;      // NaN if the phase does not predict
+  };
+
+  bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+      const std::string arg = argv[i];
+      const std::string value = argv[i + 1];
+      if (arg == "--rows") {
+        options.rows.clear();
+        std::stringstream in(value);
+        std::string item;
+        while (std::getline(in, item, ','))
+          options.rows.push_back(std::stoul(item));
+      } else if (arg == "--test-rows") {
+        options.testRows = std::stoul(value);
+      } else if (arg == "--trees") {
+        options.trees = std::stoi(value);
+      } else if (arg == "--dir") {
+        options.dir = value;
+      } else if (arg == "--report") {
+        options.report = value;
+      } else if (arg == "--baseline") {
+        options.baseline = value;
+      } else if (arg == "--trace") {
+        options.trace = value;
+      } else if (arg == "--counters") {
+        options.counters = value;
+      } else if (arg == "--memory-budget") {
+        options.memoryBudget = std::stoul(value);
+      } else if (arg == "--tolerance") {
+        options.tolerance = std::stod(value);
+      } else if (arg == "--numeric") {
+        options.spec.numeric = std::stoul(value);
+      } else if (arg == "--categorical") {
+        options.spec.categorical = std::stoul(value);
+      } else if (arg == "--classes") {
+        options.spec.classes = std::stoul(value);
+      } else if (arg == "--noise") {
+        options.spec.noise = std::stod(value);
+      } else {
+        return false;
+      }
+    }
+    return argc % 2 == 1;
+  }
+
+  template<typename F>
+  Result measure(const std::string& phase, size_t rows, F&& run) {
+    Memory::resetPeakRss();
+    boost::timer::cpu_timer timer;
+    const double accuracy = run();
+    const auto times = timer.elapsed();
+    return Result{phase, rows, times.wall / 1e9, (times.user + times.system) / 1e9,
+                  static_cast<long>(Memory::peakRss() / 1024), accuracy};
+  }
+
+  bool exists(const std::string& filename) {
+    struct stat st{};
+    return ::stat(filename.c_str(), &st) == 0;
+  }
+
+  std::string toJson(const Result& r) {
+    std::ostringstream out;
+    out << std::setprecision(6) << "{\"phase\": \"" << r.phase << "\", \"rows\": " << r.rows
+        << ", \"wall_s\": " << r.wall << ", \"cpu_s\": " << r.cpu << ", \"peak_rss_kb\": " << r.peakRss
+        << ", \"accuracy\": ";
+    if (std::isnan(r.accuracy))
+      out << "null";
+    else
+      out << r.accuracy;
+    out << "}";
+    return out.str();
+  }
+
+  /** Value of `"key": value` in a line of a report, empty if it is not there. */
+  std::string field(const std::string& line, const std::string& key) {
+    const auto at = line.find("\"" + key + "\":");
+    if (at == std::string::npos)
+      return "";
+    auto begin = line.find_first_not_of(" \"", at + key.size() + 3);
+    const auto end = line.find_first_of(",}\"", begin);
+    return line.substr(begin, end - begin);
+  }
+
+  /** The results of a report written by this program, one per line. */
+  std::vector<Result> readReport(const std::string& filename) {
+    std::ifstream in(filename);
+    if (!in)
+      throw std::runtime_error("Can't open file: " + filename);
+    std::vector<Result> results;
+    std::string line;
+    while (std::getline(in, line)) {
+      if (field(line, "phase").empty())
+        continue;
+      const std::string accuracy = field(line, "accuracy");
+      results.push_back(Result{field(line, "phase"), std::stoul(field(line, "rows")), std::stod(field(line, "wall_s")),
+                               std::stod(field(line, "cpu_s")), std::stol(field(line, "peak_rss_kb")),
+                               accuracy == "null" ? std::nan("") : std::stod(accuracy)});
+    }
+    return results;
+  }
+
+  std::string accuracy(const Result& r) {
+    if (std::isnan(r.accuracy))
+      return "-";
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(4) << r.accuracy;
+    return out.str();
+  }
+
+  /** Print how every result compares to the baseline; returns whether any phase regressed. */
+  bool compare(const std::vector<Result>& results, const std::vector<Result>& baseline, double tolerance) {
+    std::map<std::pair<std::string, size_t>, Result> before;
+    for (const auto& r: baseline)
+      before.emplace(std::make_pair(r.phase, r.rows), r);
+
+    bool regressed = false;
+    std::cout << std::left << std::setw(10) << "phase" << std::right << std::setw(10) << "rows"
+              << std::setw(12) << "wall (s)" << std::setw(12) << "baseline" << std::setw(9) << "ratio"
+              << std::setw(10) << "accuracy" << std::setw(10) << "baseline" << "\n";
+    for (const auto& r: results) {
+      const auto it = before.find(std::make_pair(r.phase, r.rows));
+      std::cout << std::left << std::setw(10) << r.phase << std::right << std::setw(10) << r.rows
+                << std::fixed << std::setprecision(3) << std::setw(12) << r.wall;
+      if (it == before.end()) {
+        std::cout << std::setw(12) << "-" << "\n";
+        continue;
+      }
+      const Result& b = it->second;
+      const double ratio = b.wall > 0 ? r.wall / b.wall : 1.0;
+      const bool slower = ratio > 1.0 + tolerance;
+      const bool worse = !std::isnan(r.accuracy) && !std::isnan(b.accuracy) && r.accuracy < b.accuracy - 0.01;
+      std::cout << std::setw(12) << b.wall << std::setprecision(2) << std::setw(9) << ratio
+                << std::setprecision(4) << std::setw(10) << accuracy(r) << std::setw(10) << accuracy(b)
+                << (slower ? "  SLOWER" : "") << (worse ? "  LESS ACCURATE" : "") << "\n";
+      regressed |= slower || worse;
+    }
+    return regressed;
+  }
+
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    std::cerr << "Usage: " << argv[0] << " [--rows N,...] [--test-rows N] [--trees N] [--dir DIR]"
+              << " [--report FILE] [--baseline FILE] [--tolerance FRACTION] [--numeric N]"
+              << " [--categorical N] [--classes N] [--noise FRACTION] [--trace FILE]"
+              << " [--counters FILE] [--memory-budget MB]" << std::endl;
+    return 1;
+  }
+  Trace::enable(!options.trace.empty());
+  if (!options.counters.empty())
+    PerfCounters::enable();
+  Memory::setBudget(options.memoryBudget << 20);
+
+  std::vector<Result> results;
+  MemoryUsage usage;
+  try {
+    for (const auto rows: options.rows) {
+      SyntheticSpec spec = options.spec;
+      spec.rows = rows;
+      // The test set only depends on its own row count, so runs with any
+      // number of training rows share it.
+      SyntheticSpec testSpec = options.spec;
+      testSpec.rows = options.testRows;
+      Dataset d{};
+      d.train.filename = options.dir + "/" + SyntheticData::fileName(spec, "");
+      d.test.filename = options.dir + "/" + SyntheticData::fileName(testSpec, "_test");
+      if (!exists(d.train.filename))
+        SyntheticData::writeArff(spec, d.train.filename, 0);
+      if (!exists(d.test.filename))
+        SyntheticData::writeArff(testSpec, d.test.filename, 1);
+
+      std::shared_ptr<const DataReader> dr;
+      results.push_back(measure("load", rows, [&]() {
+        dr = std::make_shared<const DataReader>(d);
+        return std::nan("");
+      }));
+      std::unique_ptr<DecisionTree> tree;
+      results.push_back(measure("train", rows, [&]() {
+        tree = std::make_unique<DecisionTree>(dr, Weights(), TreeConfig());
+        return std::nan("");
+      }));
+      results.push_back(measure("load_test", rows, [&]() {
+        dr->testData();
+        return std::nan("");
+      }));
+      results.push_back(measure("evaluate", rows, [&]() {
+        return tree->test().accuracy();
+      }));
+      results.push_back(measure("bag", rows, [&]() {
+        const Bagging bagging(dr, options.trees);
+        usage = bagging.memoryUsage();
+        return bagging.test().accuracy();
+      }));
+    }
+  } catch (const Memory::BudgetExceeded& e) {
+    std::cerr << e.what() << std::endl;
+    return 3;
+  }
+
+  if (!options.trace.empty())
+    Trace::writeChromeTrace(options.trace);
+  if (options.counters == "-") {
+    PerfCounters::printSummary(std::cout);
+  } else if (!options.counters.empty()) {
+    std::ofstream counters(options.counters);
+    PerfCounters::printSummary(counters);
+  }
+
+  std::ofstream report(options.report);
+  report << "{\n  \"threads\": " << std::thread::hardware_concurrency() << ",\n  \"trees\": " << options.trees
+         << ",\n  \"results\": [\n";
+  for (size_t i = 0; i < results.size(); i++)
+    report << "    " << toJson(results[i]) << (i + 1 < results.size() ? ",\n" : "\n");
+  report << "  ]\n}\n";
+  if (!report)
+    throw std::runtime_error("Can't write file: " + options.report);
+
+  if (options.baseline.empty()) {
+    for (const auto& r: results)
+      std::cout << toJson(r) << "\n";
+    Memory::print(std::cout, usage);
+    return 0;
+  }
+  return compare(results, readReport(options.baseline), options.tolerance) ? 2 : 0;
+}
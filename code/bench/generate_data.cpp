@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <iostream>
+#include <string>
+#include "SyntheticData.hpp"
+
+/**
+ * Writes a synthetic training set and test set in ARFF format, see
+ * SyntheticData. For example
+ *
+ *   GenerateData --rows 581012 --test-rows 100000 --out covtype_like
+ *
+ * writes covtype_like.arff and covtype_like_test.arff.
+ */
+int main(int argc, char** argv) {
+  SyntheticSpec spec;
+  size_t testRows = 10000;
+  std::string out = "synthetic";
+  bool valid = argc % 2 == 1;
+  for (int i = 1; valid && i + 1 < argc; i += 2) {
+    const std::string arg = argv[i];
+    const std::string value = argv[i + 1];
+    if (arg == "--rows")
+      spec.rows = std::stoul(value);
+    else if (arg == "--test-rows")
+      testRows = std::stoul(value);
+    else if (arg == "--numeric")
+      spec.numeric = std::stoul(value);
+    else if (arg == "--categorical")
+      spec.categorical = std::stoul(value);
+    else if (arg == "--cardinality")
+      spec.cardinality = std::stoul(value);
+    else if (arg == "--classes")
+      spec.classes = std::stoul(value);
+    else if (arg == "--noise")
+      spec.noise = std::stod(value);
+    else if (arg == "--seed")
+      spec.seed = std::stoull(value);
+    else if (arg == "--out")
+      out = value;
+    else
+      valid = false;
+  }
+  if (!valid) {
+    std::cerr << "Usage: " << argv[0] << " [--rows N] [--test-rows N] [--numeric N] [--categorical N]"
+              << " [--cardinality N] [--classes N] [--noise FRACTION] [--seed N] [--out PREFIX]" << std::endl;
+    return 1;
+  }
+
+  SyntheticData::writeArff(spec, out + ".arff", 0);
+  spec.rows = testRows;
+  SyntheticData::writeArff(spec, out + "_test.arff", 1);
+  return 0;
+}
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../lib/include/Calculations.hpp"
+#include "../lib/include/ColumnStore.hpp"
+#include "../lib/include/TreeTest.hpp"
+
+/**
+ * Micro-benchmarks of the kernels of the tree learner.
+ *
+ * Every kernel runs on a synthetic data set for each combination of the
+ * given row counts, column counts, categorical cardinalities and class
+ * counts. Half of the columns (rounded up) are numeric, the rest
+ * categorical. A kernel is repeated until it has run for --min-time
+ * seconds, and the report gives the time and the bytes of input it reads
+ * per row. Lists are comma separated, e.g.
+ *
+ *   KernelBench --rows 1000,100000 --columns 8 --cardinality 4,64 --classes 2,7
+ *
+ * With --csv the report is printed as comma separated values.
+ */
+
+namespace {
+
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    std::vector<size_t> rows{1000, 10000, 100000};
+    std::vector<size_t> columns{8};
+    std::vector<size_t> cardinality{8};
+    std::vector<size_t> classes{2, 7};
+    double minTime = 0.2;
+    bool csv = false;
+  };
+
+  struct Shape {
+    size_t rows;
+    size_t columns;
+    size_t cardinality;
+    size_t classes;
+  };
+
+  std::vector<size_t> parseList(const std::string& value) {
+    std::vector<size_t> list;
+    std::stringstream in(value);
+    std::string item;
+    while (std::getline(in, item, ','))
+      list.push_back(std::stoul(item));
+    return list;
+  }
+
+  bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+      const std::string arg = argv[i];
+      if (arg == "--csv") {
+        options.csv = true;
+        continue;
+      }
+      if (i + 1 == argc)
+        return false;
+      const std::string value = argv[++i];
+      if (arg == "--rows")
+        options.rows = parseList(value);
+      else if (arg == "--columns")
+        options.columns = parseList(value);
+      else if (arg == "--cardinality")
+        options.cardinality = parseList(value);
+      else if (arg == "--classes")
+        options.classes = parseList(value);
+      else if (arg == "--min-time")
+        options.minTime = std::stod(value);
+      else
+        return false;
+    }
+    return true;
+  }
+
+  /**
+   * Rows with normally distributed numeric values and uniform categorical
+   * values. The class mostly follows the first column, so splits have some
+   * gain to find.
+   */
+  void generate(const Shape& shape, Data& data, MetaData& meta) {
+    std::mt19937_64 rng(42);
+    std::normal_distribution<double> normal;
+    std::uniform_int_distribution<size_t> category(0, shape.cardinality - 1);
+    std::uniform_int_distribution<size_t> label(0, shape.classes - 1);
+    const size_t numeric = (shape.columns + 1) / 2;
+
+    meta = MetaData{};
+    for (size_t col = 0; col < shape.columns; col++) {
+      meta.labels.push_back("f" + std::to_string(col));
+      meta.columnTypes.push_back(col < numeric ? "numeric" : "categorical");
+      VecS domain;
+      for (size_t v = 0; v < shape.cardinality && col >= numeric; v++)
+        domain.push_back("v" + std::to_string(v));
+      meta.domains.push_back(domain);
+    }
+    VecS classes;
+    for (size_t c = 0; c < shape.classes; c++)
+      classes.push_back("c" + std::to_string(c));
+    meta.labels.push_back("class");
+    meta.columnTypes.push_back("categorical");
+    meta.domains.push_back(classes);
+
+    data.assign(shape.rows, VecS());
+    for (auto& row: data) {
+      for (size_t col = 0; col < shape.columns; col++)
+        row.push_back(col < numeric ? std::to_string(normal(rng)) : meta.domains[col][category(rng)]);
+      const double x = shape.columns > 0 ? std::stod(row[0]) : 0.0;
+      const auto c = label(rng) % 4 == 0 ? label(rng) : static_cast<size_t>(std::fabs(x) * shape.classes) % shape.classes;
+      row.push_back(classes[c]);
+    }
+  }
+
+  /** Balanced tree of the given depth with random tests, for TreeTest::classify. */
+  Node randomTree(const ColumnStore& store, int depth, std::mt19937_64& rng) {
+    if (depth == 0)
+      return Node(Leaf(ClassCounter{{store.schema().classes()[rng() % store.numClasses()], 1}}));
+    const size_t col = rng() % store.numFeatures();
+    const double value = store.column(col)[rng() % store.numRows()];
+    const Question question = store.isNumeric(col)
+        ? Question(static_cast<int>(col), value)
+        : Question(static_cast<int>(col), store.schema().domains()[col][static_cast<size_t>(value)], false);
+    return Node(randomTree(store, depth - 1, rng), randomTree(store, depth - 1, rng), question);
+  }
+
+  /** Keeps results alive so the compiler can not drop the kernel calls. */
+  volatile double sink = 0;
+
+  /** Run `kernel` until `minTime` has passed; returns seconds per run. */
+  double measure(const std::function<void()>& kernel, double minTime) {
+    kernel();   // warm up caches and allocations
+    size_t runs = 0;
+    const auto start = Clock::now();
+    double elapsed = 0;
+    do {
+      kernel();
+      runs++;
+      elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < minTime);
+    return elapsed / static_cast<double>(runs);
+  }
+
+  void report(const Options& options, const std::string& kernel, const Shape& shape, double seconds,
+              double rowsPerRun, double bytesPerRow) {
+    const double nsPerRow = seconds * 1e9 / rowsPerRun;
+    if (options.csv) {
+      std::cout << kernel << "," << shape.rows << "," << shape.columns << "," << shape.cardinality << ","
+                << shape.classes << "," << nsPerRow << "," << bytesPerRow << "\n";
+      return;
+    }
+    std::cout << std::left << std::setw(34) << kernel << std::right
+              << std::setw(9) << shape.rows << std::setw(6) << shape.columns
+              << std::setw(6) << shape.cardinality << std::setw(6) << shape.classes
+              << std::fixed << std::setprecision(2) << std::setw(12) << nsPerRow
+              << std::setprecision(1) << std::setw(10) << bytesPerRow << "\n";
+  }
+
+  void run(const Options& options, const Shape& shape) {
+    Data data;
+    MetaData meta{};
+    generate(shape, data, meta);
+    const ColumnStore store(data, meta);
+    Rows rows(store.numRows());
+    std::iota(rows.begin(), rows.end(), 0);
+    const Weights weights;
+    const double n = static_cast<double>(rows.size());
+    const size_t numericCol = 0;
+    const size_t categoricalCol = shape.columns - 1;
+
+    // Every kernel reads a 4-byte row id and, where it counts classes, a
+    // 4-byte label per row, plus 8 bytes per column value it looks at.
+    report(options, "classCounts", shape, measure([&]() {
+      sink = sink + Calculations::classCounts(store, rows, weights)[0];
+    }, options.minTime), n, 8);
+
+    const auto counts = Calculations::classCounts(store, rows, weights);
+    report(options, "gini (per class)", shape, measure([&]() {
+      sink = sink + Calculations::gini(counts, n);
+    }, options.minTime), static_cast<double>(shape.classes), 8);
+
+    report(options, "determine_best_threshold_numeric", shape, measure([&]() {
+      sink = sink + std::get<1>(Calculations::determine_best_threshold_numeric(store, rows, weights, numericCol));
+    }, options.minTime), n, 16);
+
+    if (!store.isNumeric(categoricalCol)) {
+      report(options, "determine_best_threshold_cat", shape, measure([&]() {
+        sink = sink + std::get<1>(Calculations::determine_best_threshold_cat(store, rows, weights, categoricalCol));
+      }, options.minTime), n, 16);
+    }
+
+    report(options, "find_best_split", shape, measure([&]() {
+      sink = sink + std::get<0>(Calculations::find_best_split(store, rows, weights, false));
+    }, options.minTime), n, 8.0 + 8.0 * static_cast<double>(shape.columns));
+
+    const Question question(static_cast<int>(numericCol), 0.0);
+    Rows trueRows;
+    Rows falseRows;
+    report(options, "partition", shape, measure([&]() {
+      trueRows.clear();
+      falseRows.clear();
+      Calculations::partition(store, rows, question, trueRows, falseRows);
+      sink = sink + static_cast<double>(trueRows.size());
+    }, options.minTime), n, 16);
+
+    // classify parses the strings it tests, so count the bytes of the row.
+    std::mt19937_64 rng(7);
+    const auto tree = std::make_shared<Node>(randomTree(store, 10, rng));
+    const TreeTest tester;
+    double rowBytes = 0;
+    for (const auto& row: data)
+      for (const auto& value: row)
+        rowBytes += static_cast<double>(value.size());
+    report(options, "TreeTest::classify (depth 10)", shape, measure([&]() {
+      for (const auto& row: data)
+        sink = sink + static_cast<double>(tester.classify(row, tree).size());
+    }, options.minTime), n, rowBytes / n);
+  }
+
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    std::cerr << "Usage: " << argv[0] << " [--rows N,...] [--columns N,...] [--cardinality N,...]"
+              << " [--classes N,...] [--min-time SECONDS] [--csv]" << std::endl;
+    return 1;
+  }
+
+  if (options.csv)
+    std::cout << "kernel,rows,columns,cardinality,classes,ns_per_row,bytes_per_row\n";
+  else
+    std::cout << std::left << std::setw(34) << "kernel" << std::right << std::setw(9) << "rows"
+              << std::setw(6) << "cols" << std::setw(6) << "card" << std::setw(6) << "K"
+              << std::setw(12) << "ns/row" << std::setw(10) << "B/row" << "\n";
+  for (const auto rows: options.rows)
+    for (const auto columns: options.columns)
+      for (const auto cardinality: options.cardinality)
+        for (const auto classes: options.classes)
+          if (rows > 0 && columns > 0 && cardinality > 0 && classes > 0)
+            run(options, Shape{rows, columns, cardinality, classes});
+  return 0;
+}
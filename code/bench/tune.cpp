@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../lib/include/HyperparameterSearch.hpp"
+
+/**
+ * Hyperparameter search on an ARFF data set, see HyperparameterSearch.
+ * Every setting takes a comma separated list of values; all combinations
+ * are tried, or --random N of them. The ranked report is printed and, with
+ * --report, also written to a file. For example
+ *
+ *   Tune --train covtype.arff --test covtype_test.arff --max-depth 0,10,20 \
+ *        --min-leaf 1,5 --mtry 0,7 --trees 1,10 --random 12
+ *
+ * The test set is loaded with the training set, but only held-out training
+ * rows are used to score the configurations.
+ */
+
+namespace {
+
+  template<typename T>
+  std::vector<T> parseList(const std::string& value) {
+    std::vector<T> values;
+    std::istringstream in(value);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+      std::istringstream parse(item);
+      T v{};
+      parse >> v;
+      values.push_back(v);
+    }
+    return values;
+  }
+
+}
+
+int main(int argc, char** argv) {
+  Dataset d{};
+  SearchSpace space{};
+  space.maxDepth = {0, 8, 16};
+  space.minLeaf = {1, 5, 20};
+  SearchOptions options{};
+  size_t random = 0;
+  std::string report;
+  bool valid = argc % 2 == 1;
+  for (int i = 1; valid && i + 1 < argc; i += 2) {
+    const std::string arg = argv[i];
+    const std::string value = argv[i + 1];
+    if (arg == "--train")
+      d.train.filename = value;
+    else if (arg == "--test")
+      d.test.filename = value;
+    else if (arg == "--max-depth")
+      space.maxDepth = parseList<int>(value);
+    else if (arg == "--min-leaf")
+      space.minLeaf = parseList<size_t>(value);
+    else if (arg == "--mtry")
+      space.mtry = parseList<size_t>(value);
+    else if (arg == "--random-thresholds")
+      space.randomThresholds = parseList<bool>(value);
+    else if (arg == "--trees")
+      space.trees = parseList<int>(value);
+    else if (arg == "--random")
+      random = std::stoul(value);
+    else if (arg == "--eta")
+      options.eta = std::stod(value);
+    else if (arg == "--min-rows")
+      options.minRows = std::stoul(value);
+    else if (arg == "--folds")
+      options.validationFolds = std::stoul(value);
+    else if (arg == "--seed")
+      options.seed = std::stoull(value);
+    else if (arg == "--report")
+      report = value;
+    else
+      valid = false;
+  }
+  if (!valid || d.train.filename.empty() || d.test.filename.empty()) {
+    std::cerr << "Usage: " << argv[0] << " --train FILE --test FILE [--max-depth N,...] [--min-leaf N,...]"
+              << " [--mtry N,...] [--random-thresholds 0,1] [--trees N,...] [--random N] [--eta X]"
+              << " [--min-rows N] [--folds N] [--seed N] [--report FILE]" << std::endl;
+    return 1;
+  }
+
+  const auto dr = std::make_shared<const DataReader>(d);
+  const HyperparameterSearch search(dr, options);
+  const auto candidates = random > 0 ? HyperparameterSearch::sample(space, random, options.seed)
+                                     : HyperparameterSearch::grid(space);
+  const auto results = search.run(candidates);
+  HyperparameterSearch::printReport(std::cout, results);
+  if (!report.empty()) {
+    std::ofstream out(report);
+    HyperparameterSearch::printReport(out, results);
+    if (!out)
+      throw std::runtime_error("Can't write file: " + report);
+  }
+  return 0;
+}
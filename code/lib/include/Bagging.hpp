@@ -13,6 +13,8 @@
 #include "DecisionTree.hpp"
 #include "Calculations.hpp"
 #include "DataReader.hpp"
+#include "Forest.hpp"
+#include "Metrics.hpp"
 #include "TreeTest.hpp"
 
 class Bagging {
@@ -20,17 +22,106 @@ class Bagging {
     Bagging() = delete;
     explicit Bagging(const DataReader& dr, const int ensembleSize, uint seed = 1234);
 
-    void test() const;
+    /**
+     * Build an ensemble on a data set that is shared with the caller. All
+     * learners refer to this one copy of the data.
+     */
+    Bagging(std::shared_ptr<const DataReader> dr, const int ensembleSize, uint seed = 1234);
 
-    inline Data testData() { return dr_.testData(); }
+    /**
+     * Build an ensemble of trees that are grown with the given settings,
+     * e.g. a feature sample per split. Every tree gets its own seed.
+     */
+    Bagging(std::shared_ptr<const DataReader> dr, const int ensembleSize, const TreeConfig& config,
+            uint seed = 1234);
+
+    /**
+     * Continue from a trained model, e.g. one loaded with ModelIO. The
+     * model's seed is the ensemble seed, so `addTrees` draws the samples
+     * the original ensemble would have drawn for its next learners. Trees
+     * must be grown with the same `config` as the model's to match. The
+     * out-of-bag estimate only covers trees added after loading.
+     */
+    Bagging(std::shared_ptr<const DataReader> dr, const Forest& model, const TreeConfig& config = TreeConfig());
+
+    /**
+     * Random forest: every split examines `mtry` randomly chosen features,
+     * the square root of the number of features if `mtry` is 0.
+     */
+    static Bagging randomForest(std::shared_ptr<const DataReader> dr, const int ensembleSize, size_t mtry = 0,
+                                uint seed = 1234);
+
+    /**
+     * Extra-Trees: a feature sample per split as in a random forest, and
+     * numeric features are split on a random threshold instead of sorting
+     * them to find the best one.
+     */
+    static Bagging extraTrees(std::shared_ptr<const DataReader> dr, const int ensembleSize, size_t mtry = 0,
+                              uint seed = 1234);
+
+    /**
+     * Evaluate on the test set with the flattened ensemble, which counts
+     * votes as integers and stops as soon as a row's majority is settled.
+     */
+    Metrics test() const;
+
+    /**
+     * Out-of-bag estimate: every training row is predicted by majority vote
+     * of the learners whose bootstrap sample left it out. Rows that were in
+     * every sample are not counted. The votes are collected while the
+     * ensemble is built, no extra pass over a test set is needed.
+     */
+    inline const Metrics& outOfBag() const { return outOfBag_; }
+
+    /**
+     * Grow the ensemble by `count` learners. Learner i always uses random
+     * stream i of the ensemble seed, so an ensemble grown in steps equals
+     * one built at its final size, and existing learners are kept as is.
+     */
+    void addTrees(int count);
+    inline size_t size() const { return learners_.size(); }
+
+    /**
+     * Cost-complexity pruning of every learner with the same `alpha`, see
+     * DecisionTree::pruneCostComplexity. Returns the node counts of the
+     * whole ensemble.
+     */
+    PruneResult prune(double alpha);
+
+    /**
+     * All learners flattened into one `Forest`, which predicts by the same
+     * majority vote as `test`.
+     */
+    Forest flatten() const;
+    void save(const std::string& filename) const;
+
+    /**
+     * Bytes held by the ensemble, per learner and in total. The data set is
+     * shared by all learners and counted once.
+     */
+    MemoryUsage memoryUsage() const;
+
+    inline Data testData() { return dr_->testData(); }
 
   private:
-    DataReader dr_;
+    std::shared_ptr<const DataReader> dr_;
     int ensembleSize_;
+    uint seed_;
+    TreeConfig config_;
     std::vector<DecisionTree> learners_;
-    std::mt19937_64 random_number_generator;
+    std::vector<uint32_t> outOfBagVotes_;   // per training row and class
+    Metrics outOfBag_;
+
+    /** A trained learner with its predictions for the rows it did not see. */
+    struct Learner {
+      DecisionTree tree;
+      Rows outOfBag;
+      std::vector<uint32_t> predictions;
+    };
 
-    void buildBag();
+    /** Build learners first, ..., first + count - 1 and add them. */
+    void buildBag(int first, int count);
+    Learner buildLearner(size_t index) const;
 };
 
 #endif //DECISIONTREE_BAGGING_HPP
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_BATCHTRAINER_HPP
+#define DECISIONTREE_BATCHTRAINER_HPP
+
+#include <memory>
+#include <vector>
+#include "Calculations.hpp"
+#include "DataReader.hpp"
+#include "DecisionTree.hpp"
+#include "ThreadPool.hpp"
+#include "TreeConfig.hpp"
+
+/** One model to train: a tree on `data`, with its rows counted `weights` times. */
+struct TrainingJob {
+  std::shared_ptr<const DataReader> data{};
+  TreeConfig config{};
+  Weights weights{};    // empty: every training row once
+};
+
+struct BatchResult {
+  std::vector<DecisionTree> trees{};   // in the order of the jobs
+  double seconds = 0.0;                // wall time of the batch
+
+  inline double modelsPerSecond() const { return seconds > 0 ? static_cast<double>(trees.size()) / seconds : 0.0; }
+};
+
+/**
+ * Trains many small, independent trees, e.g. one per customer.
+ *
+ * A single DecisionTree builds its top levels with std::async and searches
+ * splits with OpenMP; for a tree of a few thousand rows starting those
+ * threads costs more than the tree, and many trees trained at once this
+ * way start far more threads than there are cores. The batch trainer runs
+ * every model on one worker of a fixed pool instead, with the serial
+ * builder (parallelDepth 0, so no threads are started inside a model).
+ * Workers claim the next job as soon as they are done, largest data set
+ * first, so the batch is not held up by a large model that started last.
+ * The scratch buffers of the split search are kept per thread, so all
+ * models a worker trains reuse the same memory.
+ */
+class BatchTrainer {
+  public:
+    explicit BatchTrainer(ThreadPool& pool = ThreadPool::shared());
+
+    /**
+     * Train a tree for every job. The first exception of a job, e.g.
+     * Memory::BudgetExceeded, is rethrown once the running jobs are done.
+     */
+    BatchResult train(const std::vector<TrainingJob>& jobs) const;
+
+  private:
+    ThreadPool& pool_;
+};
+
+#endif //DECISIONTREE_BATCHTRAINER_HPP
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_BINNEDCOLUMNS_HPP
+#define DECISIONTREE_BINNEDCOLUMNS_HPP
+
+#include <cstdint>
+#include <vector>
+#include "ColumnStore.hpp"
+
+/**
+ * Column store with every value replaced by a small bin number, used by
+ * histogram-based split search.
+ *
+ * Bin 0 holds missing values. A numeric column gets at most `maxBins`
+ * further bins of about equal size, bounded by quantiles of the column as
+ * estimated by its sketch in the column store (see QuantileSketch), so the
+ * column is not sorted; one with at most `maxBins` distinct values gets
+ * one bin per value. A categorical column gets one bin per code. Codes
+ * beyond `maxBins` share bin 0 and are never split on. A split on bin `b` is the test
+ * `x >= threshold(col, b)` for numeric columns (bins >= b go to the true
+ * side) and `x == threshold(col, b)` for categorical ones (bin b only), so
+ * missing values always end up on the false side, as in a `Question`.
+ */
+class BinnedColumns {
+  public:
+    static constexpr size_t maxBins = 255;
+
+    BinnedColumns() = default;
+    explicit BinnedColumns(const ColumnStore& store, size_t maxBins = BinnedColumns::maxBins);
+
+    inline size_t numRows() const { return numRows_; }
+    inline size_t numFeatures() const { return bins_.size(); }
+    inline bool isNumeric(size_t col) const { return numeric_[col]; }
+
+    /** Number of bins of a column, the missing bin included. */
+    inline size_t numBins(size_t col) const { return thresholds_[col].size(); }
+    inline const std::vector<uint8_t>& bins(size_t col) const { return bins_[col]; }
+
+    /** Bin of an encoded value of a column, for rows that were not binned yet. */
+    uint8_t binOf(size_t col, double value) const;
+
+    /** Threshold or category code of the split on bin `bin` (> 0). */
+    inline double threshold(size_t col, size_t bin) const { return thresholds_[col][bin]; }
+
+  private:
+    size_t numRows_ = 0;
+    std::vector<bool> numeric_{};
+    std::vector<std::vector<uint8_t>> bins_{};
+    std::vector<std::vector<double>> thresholds_{};   // lower bound or code of every bin
+};
+
+#endif //DECISIONTREE_BINNEDCOLUMNS_HPP
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_BOOSTING_HPP
+#define DECISIONTREE_BOOSTING_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "BinnedColumns.hpp"
+#include "Calculations.hpp"
+#include "DataReader.hpp"
+#include "Forest.hpp"
+#include "Metrics.hpp"
+#include "Schema.hpp"
+#include "Utils.hpp"
+
+/**
+ * Settings of the gradient boosting learner.
+ */
+struct BoostingConfig {
+  // Maximum number of boosting rounds.
+  int rounds = 100;
+
+  // Shrinkage: every tree's output is scaled by this factor.
+  double learningRate = 0.1;
+
+  // Depth of the regression trees; a tree of depth d has at most 2^d leaves.
+  int maxDepth = 6;
+
+  // L2 regularisation of the leaf values, shrinks leaves with few rows.
+  double lambda = 1.0;
+
+  // Minimum sum of hessians on each side of a split.
+  double minHessian = 1.0;
+
+  // Stop when the loss on the validation set has not improved for this many
+  // rounds, and keep the best round. 0, or no validation set, disables it.
+  int earlyStoppingRounds = 10;
+
+  // Number of histogram bins per numeric feature, at most 255.
+  size_t maxBins = BinnedColumns::maxBins;
+};
+
+/**
+ * Gradient boosted regression trees for classification.
+ *
+ * Two classes are fitted with the logistic loss and one tree per round, more
+ * classes with the softmax loss and one tree per class per round. Trees are
+ * grown on a second order approximation of the loss, with splits found on
+ * histograms of binned features (see BinnedColumns and the gradient kernels
+ * in Calculations). The histogram of the larger child of a node is derived
+ * from its parent's and its sibling's, so every level of a tree costs about
+ * one pass over half of the rows.
+ */
+class Boosting {
+  public:
+    Boosting() = delete;
+    explicit Boosting(const DataReader& dr, const BoostingConfig& config = BoostingConfig(),
+                      const Data& validation = Data());
+
+    /**
+     * Train on a data set that is shared with the caller. If `validation`
+     * is not empty, it is used for early stopping.
+     */
+    Boosting(std::shared_ptr<const DataReader> dr, const BoostingConfig& config = BoostingConfig(),
+             const Data& validation = Data());
+
+    /**
+     * Train on the training rows weighted by `weights` (see DecisionTree):
+     * rows with weight 0 are left out, so part of the training set can be
+     * held out without copying the data set.
+     */
+    Boosting(std::shared_ptr<const DataReader> dr, const Weights& weights, const BoostingConfig& config,
+             const Data& validation = Data());
+
+    Metrics test() const;
+
+    /** Predicted class index, in the classes of `schema()`, of every row. */
+    std::vector<uint32_t> predictBatch(const Data& rows) const;
+    std::string predict(const VecS& row) const;
+
+    inline const Schema& schema() const { return dr_->trainColumns().schema(); }
+    inline size_t rounds() const { return trees_.size() / numOutputs_; }
+
+    /** Loss on the validation set after every round that was trained. */
+    inline const std::vector<double>& validationLoss() const { return validationLoss_; }
+
+    inline Data testData() { return dr_->testData(); }
+
+  private:
+    // Nodes in pre-order as in a FlatTree; a leaf holds its output in `value`.
+    using RegressionTree = std::vector<FlatNode>;
+
+    std::shared_ptr<const DataReader> dr_;
+    BoostingConfig config_;
+    size_t numOutputs_;                 // 1 for the logistic loss, one per class for softmax
+    std::vector<double> baseScores_;
+    std::vector<RegressionTree> trees_; // numOutputs_ trees per round
+    std::vector<double> validationLoss_;
+
+    void boost(const Weights& weights, const Data& validation);
+
+    /** Raw scores of an encoded row, one per output. */
+    void scores(const double* x, double* out) const;
+
+    /** Turn the scores of a row into class probabilities. */
+    void probabilities(const double* scores, double* out) const;
+    static double output(const RegressionTree& tree, const double* x);
+};
+
+#endif //DECISIONTREE_BOOSTING_HPP
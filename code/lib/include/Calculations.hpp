@@ -12,12 +12,18 @@
 #include <string>
 #include <unordered_map>
 #include <boost/timer/timer.hpp>
+#include "BinnedColumns.hpp"
+#include "ColumnStore.hpp"
 #include "Question.hpp"
 #include "Utils.hpp"
 
 using ClassCounter = std::unordered_map<std::string, int>;
 using ClassCounterPerCategory = std::unordered_map<std::string, ClassCounter>;  // map<featureValue, classCounter>
 
+using Rows = std::vector<uint32_t>;           // indices of rows in a ColumnStore
+using Weights = std::vector<uint16_t>;        // multiplicity of every row, empty means all 1
+using ClassHistogram = std::vector<double>;   // (weighted) count per class code
+
 
 namespace Calculations {
 
@@ -27,7 +33,7 @@ const double gini(const ClassCounter& counts, double N);
 
 float info_gain(const ClassCounter &true_counts, const ClassCounter &false_counts, double &true_size, double &false_size, float current_uncertainty);
 
-std::tuple<const double, const Question> find_best_split(const Data &rows, const MetaData &meta);
+std::tuple<const double, const Question> find_best_split(const Data &rows, const MetaData &meta, bool parallel = true);
 
 std::tuple<std::string, double> determine_best_threshold_numeric(const Data &data, int col);
 
@@ -43,6 +49,119 @@ void reduce_classcounter(ClassCounter& output, ClassCounter& input);
 
 void reduce_classcatcounter(ClassCounterPerCategory& output, ClassCounterPerCategory& input);
 
+/*
+ * Kernels of the tree learner. They work on a subset of the rows of a
+ * column store, every row counted as many times as its weight, so bootstrap
+ * samples and other subsets never need a copy of the data.
+ */
+
+inline double weight(const Weights& weights, uint32_t row) {
+  return weights.empty() ? 1.0 : weights[row];
+}
+
+ClassHistogram classCounts(const ColumnStore& store, const Rows& rows, const Weights& weights);
+
+double gini(const ClassHistogram& counts, double N);
+
+/**
+ * Best test `x >= threshold` on a numeric column. Returns the threshold
+ * and its information gain; the gain is 0 if the column can not split the
+ * rows. Thresholds that leave less than `minLeaf` rows (by weight) on
+ * either side are not considered, as in CART.
+ */
+std::tuple<double, double> determine_best_threshold_numeric(const ColumnStore& store, const Rows& rows,
+                                                            const Weights& weights, size_t col,
+                                                            double minLeaf = 1);
+
+/**
+ * Best test `x == value` on a categorical column, of the values that leave
+ * at least `minLeaf` rows on either side. Returns the code of the value and
+ * its information gain.
+ */
+std::tuple<uint32_t, double> determine_best_threshold_cat(const ColumnStore& store, const Rows& rows,
+                                                          const Weights& weights, size_t col,
+                                                          double minLeaf = 1);
+
+/**
+ * Extra-Trees test `x >= threshold` on a numeric column, with the threshold
+ * drawn between the smallest and largest value of the rows by `draw`, a
+ * number in [0, 1). Needs a single pass over the rows and no sort. Returns
+ * the threshold and its information gain, which is 0 if either side has
+ * less than `minLeaf` rows.
+ */
+std::tuple<double, double> random_threshold_numeric(const ColumnStore& store, const Rows& rows,
+                                                    const Weights& weights, size_t col, double draw,
+                                                    double minLeaf = 1);
+
+/**
+ * Best split over all columns, of those that leave at least `minLeaf` rows
+ * (by weight) on either side.
+ */
+std::tuple<const double, const Question> find_best_split(const ColumnStore& store, const Rows& rows,
+                                                         const Weights& weights, bool parallel = true,
+                                                         double minLeaf = 1);
+
+/**
+ * Split search over the given columns only. If `draws` is not empty, it
+ * holds one number in [0, 1) per column and numeric columns are split on a
+ * random threshold (see random_threshold_numeric) instead of the best one.
+ */
+std::tuple<const double, const Question> find_best_split(const ColumnStore& store, const Rows& rows,
+                                                         const Weights& weights,
+                                                         const std::vector<uint32_t>& columns,
+                                                         const std::vector<double>& draws, bool parallel = true,
+                                                         double minLeaf = 1);
+
+void partition(const ColumnStore& store, const Rows& rows, const Question& q, Rows& trueRows, Rows& falseRows);
+
+/**
+ * Best split of a binned column (see BinnedColumns) from its class counts
+ * per bin, stored class-major: the count of class k in bin b is at
+ * `k * numBins + b`, for every class of `parent`. `parent` holds the class counts of all rows, those
+ * with a missing value included. Splits that leave fewer than `minLeaf`
+ * rows on either side are skipped. Returns the bin and its information gain.
+ */
+std::tuple<uint32_t, double> best_histogram_split(const double* histogram, size_t numBins, bool numeric,
+                                                  const ClassHistogram& parent, double minLeaf = 1);
+
+/** Class counts with class names, as stored in a Leaf. */
+ClassCounter toClassCounter(const ClassHistogram& counts, const Schema& schema);
+
+/*
+ * Kernels of the gradient boosting learner. They work on binned columns and
+ * per-row gradients and hessians of the loss.
+ */
+
+/** Sum of the gradients and hessians of a set of rows. */
+struct GradientSum {
+  double gradient = 0.0;
+  double hessian = 0.0;
+
+  inline GradientSum& operator+=(const GradientSum& other) {
+    gradient += other.gradient;
+    hessian += other.hessian;
+    return *this;
+  }
+  inline GradientSum operator-(const GradientSum& other) const {
+    return GradientSum{gradient - other.gradient, hessian - other.hessian};
+  }
+};
+
+/** Add the gradients of `rows` to the histogram of one column, one sum per bin. */
+void gradient_histogram(const BinnedColumns& bins, const Rows& rows, const std::vector<double>& gradients,
+                        const std::vector<double>& hessians, size_t col, GradientSum* histogram);
+
+/**
+ * Best split of a column given its histogram and the sum over all rows.
+ * The gain is the decrease of the second order approximation of the loss
+ * with L2 regularisation `lambda` on the leaf values; both sides need a
+ * hessian of at least `minHessian`. Returns the bin to split on (see
+ * BinnedColumns) and the gain, which is 0 if the column can not split.
+ */
+std::tuple<uint32_t, double> best_gradient_split(const BinnedColumns& bins, size_t col,
+                                                 const GradientSum* histogram, const GradientSum& total,
+                                                 double lambda, double minHessian);
+
 } // namespace Calculations
 
 #endif //DECISIONTREE_CALCULATIONS_HPP
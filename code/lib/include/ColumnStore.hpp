@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_COLUMNSTORE_HPP
+#define DECISIONTREE_COLUMNSTORE_HPP
+
+#include <cstdint>
+#include <vector>
+#include "QuantileSketch.hpp"
+#include "Schema.hpp"
+#include "Utils.hpp"
+
+/**
+ * Column-wise, parsed copy of a data set used by the tree learner.
+ *
+ * Every feature column is stored as doubles as produced by
+ * `Schema::encode`: numeric values are parsed once, categorical values are
+ * replaced by their code. Class values are stored as class codes. Values
+ * and classes that are missing from the header are added to the schema.
+ * Every numeric column also gets a quantile sketch, filled as rows are
+ * appended, from which histogram bin boundaries are read without sorting.
+ */
+class ColumnStore {
+  public:
+    // ranks of the sketch quantiles are off by at most 0.3% of the rows
+    static constexpr size_t sketchK = 1000;
+
+    ColumnStore() = default;
+    ColumnStore(const Data& data, const MetaData& meta);
+    /** A store without rows, to be filled chunk by chunk with `append`. */
+    explicit ColumnStore(const MetaData& meta);
+
+    /**
+     * Encode `rows` and add them after the rows in the store. Filling a
+     * store chunk by chunk gives the same codes as encoding all rows at
+     * once.
+     */
+    void append(const Data& rows);
+
+    inline const Schema& schema() const { return schema_; }
+    inline size_t numRows() const { return labels_.size(); }
+    inline size_t numFeatures() const { return columns_.size(); }
+    inline size_t numClasses() const { return schema_.numClasses(); }
+    inline bool isNumeric(size_t col) const {
+      return schema_.types()[col] == Schema::ColumnType::Numeric;
+    }
+
+    inline const std::vector<double>& column(size_t col) const { return columns_[col]; }
+    inline const std::vector<uint32_t>& labels() const { return labels_; }
+    /** Sketch of the values of a numeric column; empty for categorical ones. */
+    inline const QuantileSketch& sketch(size_t col) const { return sketches_[col]; }
+
+  private:
+    Schema schema_{};
+    std::vector<std::vector<double>> columns_{};
+    std::vector<uint32_t> labels_{};
+    std::vector<QuantileSketch> sketches_{};
+};
+
+#endif //DECISIONTREE_COLUMNSTORE_HPP
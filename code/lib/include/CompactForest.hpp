@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_COMPACTFOREST_HPP
+#define DECISIONTREE_COMPACTFOREST_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Forest.hpp"
+#include "Metrics.hpp"
+#include "Schema.hpp"
+#include "Utils.hpp"
+
+/**
+ * Node of a compressed forest, 12 bytes instead of the 24 of a FlatNode.
+ *
+ * `feature` holds the column, with `categoricalBit` set for an equality
+ * test, or `leafFeature` for a leaf. The value of a numeric test is the
+ * index of its threshold in the codebook of the column; that of a
+ * categorical test is the category code. For a leaf, `value` is the
+ * majority class and `left` the offset of its class distribution.
+ */
+struct CompactNode {
+  static constexpr uint16_t categoricalBit = 0x8000;
+  static constexpr uint16_t leafFeature = 0xFFFF;
+
+  uint32_t left;
+  uint32_t right;
+  uint16_t feature;
+  uint16_t value;
+
+  inline bool isLeaf() const { return feature == leafFeature; }
+};
+
+static_assert(sizeof(CompactNode) == 12, "CompactNode is part of the model file format");
+
+/**
+ * A forest compressed for inference: all trees share one pool of nodes in
+ * which every distinct subtree is stored once (hash-consing), so subtrees
+ * that recur within and across trees cost nothing extra. A test whose two
+ * children turn out identical is dropped.
+ *
+ * Thresholds are replaced by 16-bit indices into a sorted codebook per
+ * column. A row is encoded once into the rank of each value among the
+ * codebook, after which every tree only compares small integers. While a
+ * column has at most `maxThresholds` distinct thresholds this is exact;
+ * beyond that thresholds are merged with their neighbours and
+ * `thresholdError()` bounds how far any threshold moved, so only values
+ * that close to a threshold can be routed differently.
+ *
+ * Leaf class distributions are stored as 16-bit fractions of 65535 with
+ * the majority class kept exactly, so votes are unchanged and every
+ * probability is off by at most `distributionError()`. Votes are counted
+ * with early exit, as in Forest.
+ */
+class CompactForest {
+  public:
+    static constexpr size_t maxThresholds = 0xFFFF;
+    static constexpr double distributionScale = 65535.0;
+
+    CompactForest() = default;
+    explicit CompactForest(const Forest& forest, size_t maxThresholds = CompactForest::maxThresholds);
+
+    /** Build from decoded model file parts, see ModelIO. */
+    CompactForest(Schema schema, std::vector<std::vector<double>> codebooks, std::vector<uint32_t> roots,
+                  std::vector<CompactNode> nodes, std::vector<uint16_t> distributions, uint64_t seed,
+                  double thresholdError, double distributionError);
+
+    /** Predicted class index of an encoded row (see Schema::encode). */
+    uint32_t predict(const double* x) const;
+    std::string predict(const VecS& row) const;
+    std::vector<uint32_t> predictBatch(const Data& rows) const;
+    Metrics evaluate(const Data& rows) const;
+
+    /** Trees with the quantized thresholds and the leaf distributions scaled to counts of 65535. */
+    Forest decompress() const;
+
+    inline const Schema& schema() const { return schema_; }
+    inline size_t numTrees() const { return roots_.size(); }
+    inline uint64_t seed() const { return seed_; }
+    inline const std::vector<std::vector<double>>& codebooks() const { return codebooks_; }
+    inline const std::vector<uint32_t>& roots() const { return roots_; }
+    inline const std::vector<CompactNode>& nodes() const { return nodes_; }
+    inline const std::vector<uint16_t>& distributions() const { return distributions_; }
+
+    /** Largest distance between a threshold and its codebook entry. */
+    inline double thresholdError() const { return thresholdError_; }
+    inline double distributionError() const { return distributionError_; }
+
+    /** Bytes of the node pool, codebooks and distributions. */
+    size_t modelBytes() const;
+
+  private:
+    // Batches check which rows are settled after every this many trees.
+    static constexpr size_t earlyExitGroup = 8;
+
+    Schema schema_{};
+    std::vector<std::vector<double>> codebooks_{};   // sorted thresholds per numeric column
+    std::vector<uint32_t> roots_{};
+    std::vector<CompactNode> nodes_{};
+    std::vector<uint16_t> distributions_{};          // numClasses per distinct leaf distribution
+    uint64_t seed_ = 0;
+    double thresholdError_ = 0.0;
+    double distributionError_ = 0.0;
+
+    /** Rank of every numeric value in its codebook, code of every categorical one. */
+    void encode(const double* x, uint32_t* ranks) const;
+    /** Predict `n` consecutive encoded rows. */
+    void predictRanks(const uint32_t* ranks, size_t n, uint32_t* predictions) const;
+};
+
+#endif //DECISIONTREE_COMPACTFOREST_HPP
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_CROSSVALIDATOR_HPP
+#define DECISIONTREE_CROSSVALIDATOR_HPP
+
+#include <memory>
+#include <vector>
+#include "Calculations.hpp"
+#include "DataReader.hpp"
+#include "Metrics.hpp"
+#include "TreeConfig.hpp"
+
+/** Metrics of every fold and of all folds together. */
+struct CrossValidationResult {
+  std::vector<Metrics> folds{};
+  Metrics total{};          // every training row predicted once, by the model that did not see it
+  double meanAccuracy = 0.0;
+  double stddevAccuracy = 0.0;
+};
+
+/**
+ * Stratified k-fold cross-validation on the training set of a data set.
+ *
+ * The rows are assigned to folds once, per class in a random order, so
+ * every fold has about the same size and class distribution. Every fold
+ * model is trained on the one shared, already encoded column store; the
+ * rows of its own fold get weight 0, so no rows are copied. The k models
+ * are trained at the same time on the shared thread pool, each on one
+ * thread, and every model predicts its held-out rows as soon as it is
+ * done. A run costs about k trainings on (k - 1) / k of the rows.
+ */
+class CrossValidator {
+  public:
+    CrossValidator() = delete;
+    CrossValidator(std::shared_ptr<const DataReader> dr, size_t k, uint64_t seed = 1234);
+
+    CrossValidationResult run(const TreeConfig& config = TreeConfig()) const;
+
+    inline size_t numFolds() const { return folds_.size(); }
+    /** Training rows of fold `f`, in increasing order. */
+    inline const Rows& fold(size_t f) const { return folds_[f]; }
+
+  private:
+    std::shared_ptr<const DataReader> dr_;
+    std::vector<Rows> folds_;
+
+    Metrics evaluateFold(size_t f, const TreeConfig& config) const;
+};
+
+#endif //DECISIONTREE_CROSSVALIDATOR_HPP
@@ -7,10 +7,15 @@
 #ifndef DECISIONTREE_ARFFREADER_HPP
 #define DECISIONTREE_ARFFREADER_HPP
 
+#include <atomic>
 #include <iostream>
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <boost/algorithm/string.hpp>
+#include "ColumnStore.hpp"
 #include "Dataset.hpp"
 #include "Utils.hpp"
 
@@ -24,6 +29,12 @@
  * some changes to enable faster decision tree learning. The definition of the
  * public methods (including the constructor) can not be altered. All private 
  * methods can be modified as you which.
+ *
+ * The training file is parsed in chunks of rows; every chunk is encoded
+ * into the column store on a second thread while the next one is parsed,
+ * so the store is ready as soon as the last line is read. The test file is
+ * only loaded by the first call of `testData`, and copies of a reader share
+ * it.
  */
 class DataReader
 {
@@ -32,23 +43,53 @@ class DataReader
     DataReader(const Dataset& d);
 
     inline const Data& trainData() const { return trainData_; }
-    inline const Data& testData() const { return testData_; }
+    const Data& testData() const;
     inline const MetaData& metaData() const { return trainMetaData_; }
 
+    /** The training data parsed into columns, as used by the tree learner. */
+    inline const ColumnStore& trainColumns() const { return trainColumns_; }
+
+    /** Whether `testData` was called, and loaded the test file. */
+    inline bool testDataLoaded() const { return test_->loaded.load(std::memory_order_acquire); }
+
   private:
-    void processFile(const std::string& strings, Data& data, MetaData &meta);
-    void moveClassDataToBack(VecS &line, const VecS &labels) const;
+    struct TestSet {
+      std::string filename{};
+      std::once_flag once{};
+      std::atomic<bool> loaded{false};
+      Data data{};
+      MetaData meta{};
+    };
+
+    // rows parsed before they are handed to the encoder
+    static constexpr size_t chunkRows = 4096;
+    // chunks parsed ahead of the encoder, at most
+    static constexpr size_t maxQueuedChunks = 4;
+
+    void loadTrainingFile(const std::string& filename);
+    void loadTestFile() const;
+
+    /**
+     * Parse `filename`: the header into `meta`, after which `onHeader` is
+     * called, and the rows in chunks that are passed to `onChunk`. Blank
+     * lines and `%` comments are skipped. Returns false if the file can't be
+     * opened; throws std::runtime_error, with the line number, on a row with
+     * the wrong number of values.
+     */
+    bool processFile(const std::string& filename, MetaData& meta, const std::function<void()>& onHeader,
+                     const std::function<void(Data&&)>& onChunk) const;
+    void moveClassDataToBack(VecS &line, long classIndex) const;
     void moveClassLabelToBack();
-    void trimWhiteSpaces(VecS &line);
+    void trimWhiteSpaces(VecS &line) const;
 
-    bool parseHeaderLine(const std::string& line, MetaData &meta, bool &header_loaded);
-    bool parseDataLine(const std::string& line, Data &data, MetaData &meta);
+    bool parseHeaderLine(const std::string& line, MetaData &meta, bool &header_loaded) const;
+    bool parseDataLine(const std::string& line, Data &data, long classIndex) const;
 
     const std::string classLabel_;
     Data trainData_;
-    Data testData_;
     MetaData trainMetaData_;
-    MetaData testMetaData_;
+    ColumnStore trainColumns_;
+    std::shared_ptr<TestSet> test_;
 
 };
 
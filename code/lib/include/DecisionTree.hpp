@@ -9,28 +9,112 @@
 
 #include "Calculations.hpp"
 #include "DataReader.hpp"
+#include "Forest.hpp"
+#include "Memory.hpp"
 #include "Node.hpp"
+#include "Pruning.hpp"
+#include "TreeConfig.hpp"
 #include "TreeTest.hpp"
+#include "TreeUpdater.hpp"
 #include "Utils.hpp"
 
+/** Size of a tree before and after pruning, in nodes. */
+struct PruneResult {
+  size_t nodesBefore = 0;
+  size_t nodesAfter = 0;
+};
+
 class DecisionTree {
   public:
     DecisionTree() = delete;
     explicit DecisionTree(const DataReader& dr);
     explicit DecisionTree(const DataReader& dr, const std::vector<size_t>& samples);
 
+    /**
+     * Build a tree on a data set that is shared with other learners; the
+     * tree keeps a reference to it instead of a copy. Every training row
+     * counts `weights[row]` times (bootstrap multiplicities), rows with
+     * weight 0 are left out. Empty weights use every row once.
+     */
+    DecisionTree(std::shared_ptr<const DataReader> dr, const Weights& weights, const TreeConfig& config);
+
+    /** Wrap a tree that was trained before, e.g. one loaded from a model file. */
+    DecisionTree(std::shared_ptr<const DataReader> dr, Node root, const TreeConfig& config = TreeConfig());
+
+    /** Copies get their own copy of the update statistics, see `update`. */
+    DecisionTree(const DecisionTree& other);
+    DecisionTree& operator=(const DecisionTree& other);
+    DecisionTree(DecisionTree&&) = default;
+    DecisionTree& operator=(DecisionTree&&) = default;
+
+    /** Multiplicity of every row in a sample drawn with replacement. */
+    static Weights bootstrapWeights(size_t numRows, const std::vector<size_t>& samples);
+
     void print() const;
-    void test() const;
+    Metrics test() const;
+
+    /**
+     * Add new training rows and update the tree: subtrees whose best split
+     * now gains more than `tolerance` over their current split are
+     * retrained, all other nodes are kept and only their leaf counts
+     * change. The first update collects per-node statistics with one pass
+     * over the training rows, later updates cost time in proportion to the
+     * new rows (see TreeUpdater). Assumes the tree was trained on all
+     * training rows of its data set, unweighted. Returns the number of
+     * subtrees that were retrained.
+     */
+    size_t update(const Data& rows, double tolerance = 0.01);
 
-    inline Data testData() { return dr_.testData(); }
+    /**
+     * Minimal cost-complexity pruning with complexity parameter `alpha`,
+     * see Pruning::costComplexity.
+     */
+    PruneResult pruneCostComplexity(double alpha);
+
+    /** Reduced-error pruning on a validation set, see Pruning::reducedError. */
+    PruneResult pruneReducedError(const Data& validation);
+
+    /**
+     * Compact copy of the tree for batch prediction and storage, see
+     * `Forest` and `ModelIO`.
+     */
+    Forest flatten() const;
+    void save(const std::string& filename) const;
+
+    /**
+     * Bytes held by the tree and its data set, and the peak scratch space
+     * of the split search so far, see Memory.
+     */
+    MemoryUsage memoryUsage() const;
+
+    /**
+     * Rough bound on the memory it takes to grow a tree on `numRows` rows,
+     * checked against the memory budget before training.
+     */
+    static size_t trainingEstimate(size_t numRows);
+
+    inline Data testData() { return dr_->testData(); }
     inline std::shared_ptr<Node> root() { return std::make_shared<Node>(root_); }
 
     Node root_;
   private:
-    DataReader dr_;
+    std::shared_ptr<const DataReader> dr_;
+    TreeConfig config_;
+    std::unique_ptr<TreeUpdater> updater_;   // made by the first update; copied with the tree
+
+    // splits that gain less than this are numerical noise
+    static constexpr double minGain = 1e-12;
+    // subtrees retrained by `update` are built in parallel from this size on
+    static constexpr size_t minParallelRows = 10000;
 
-    const Node buildTree(const Data& rows, const MetaData &meta);
-		const Node buildTreeStandard(const Data& rows, const MetaData& meta, int depth);
+    PruneResult replaceRoot(Node root);
+    Rows allRows(const Weights& weights) const;
+    std::tuple<const double, const Question> findSplit(const ColumnStore& store, const Rows& rows,
+                                                       const Weights& weights, bool parallel, uint64_t node) const;
+    // `node` numbers the nodes of the tree: the root is 1, the children of n are 2n and 2n + 1;
+    // the top `parallelLevels` levels of the subtree are built in parallel
+    const Node buildTree(const ColumnStore& store, const Rows& rows, const Weights& weights, int depth,
+                         uint64_t node, int parallelLevels) const;
 		void print(const std::shared_ptr<Node> root, std::string spacing="") const;
 
 };
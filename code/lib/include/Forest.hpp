@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_FOREST_HPP
+#define DECISIONTREE_FOREST_HPP
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "ColumnStore.hpp"
+#include "Metrics.hpp"
+#include "Node.hpp"
+#include "Schema.hpp"
+#include "Utils.hpp"
+
+/**
+ * Node of a flattened tree. Nodes of one tree are stored in a contiguous
+ * array in pre-order, the root at index 0. The layout is the on-disk layout
+ * of the model format, so a mapped model file can be used in place.
+ *
+ * For a test node, `left` and `right` are the indices of the true and false
+ * child. For a leaf, `left` is the offset of its class counts in the leaf
+ * count array of the tree and `right` is the majority class.
+ */
+struct FlatNode {
+  enum Kind : uint32_t { Numeric = 0, Categorical = 1, Leaf = 2 };
+
+  uint32_t feature;
+  uint32_t kind;
+  double value;   // threshold (x >= value) or category code (x == value)
+  uint32_t left;
+  uint32_t right;
+};
+
+static_assert(sizeof(FlatNode) == 24, "FlatNode is part of the model file format");
+static_assert(std::is_standard_layout<FlatNode>::value && std::is_trivially_copyable<FlatNode>::value,
+              "FlatNode must be mappable");
+
+/**
+ * Read-only view on the nodes and leaf counts of one flattened tree. The
+ * memory is owned by the `Forest` the view belongs to.
+ */
+struct FlatTree {
+  const FlatNode* nodes;
+  uint32_t numNodes;
+  const uint32_t* leafCounts;   // numClasses counts per leaf
+  uint32_t numLeafCounts;
+
+  inline const FlatNode& leaf(const double* x) const {
+    const FlatNode* node = nodes;
+    while (node->kind != FlatNode::Leaf) {
+      const double v = x[node->feature];
+      const bool goTrue = node->kind == FlatNode::Numeric ? v >= node->value : v == node->value;
+      node = nodes + (goTrue ? node->left : node->right);
+    }
+    return *node;
+  }
+
+  inline uint32_t predict(const double* x) const { return leaf(x).right; }
+};
+
+/**
+ * A compact, pointer-free representation of one or more trained trees that
+ * predicts by majority vote. This is the representation that is stored in
+ * model files (see ModelIO) and used for batch prediction.
+ */
+class Forest {
+  public:
+    Forest() = default;
+
+    /**
+     * Flatten trained trees. The schema is completed with any categorical
+     * value or class that occurs in the trees but not in the header.
+     */
+    static Forest fromNodes(const std::vector<const Node*>& roots, const MetaData& meta, uint64_t seed = 0);
+
+    /**
+     * Flatten trained trees on top of an existing schema, so that feature
+     * and class codes agree with data encoded by that schema.
+     */
+    static Forest fromNodes(const std::vector<const Node*>& roots, const Schema& schema, uint64_t seed = 0);
+
+    /**
+     * Build a forest on top of memory owned by `storage`, used when loading
+     * models.
+     */
+    Forest(Schema schema, std::vector<FlatTree> trees, std::shared_ptr<const void> storage, uint64_t seed);
+
+    /**
+     * Rebuild the trees as Nodes, e.g. to continue training a model that was
+     * loaded from file. Leaves get the class counts stored in the model.
+     */
+    std::vector<Node> toNodes() const;
+
+    inline const Schema& schema() const { return schema_; }
+    inline const std::vector<FlatTree>& trees() const { return trees_; }
+    inline size_t numTrees() const { return trees_.size(); }
+    inline uint64_t seed() const { return seed_; }
+
+    /**
+     * Early-exit voting, on by default: stop evaluating trees for a row as
+     * soon as the leading class can no longer be caught up by the trees
+     * that are left. Predictions are the same as with a full vote. Trees
+     * built by `fromNodes` are ordered by confidence, the share of their
+     * training rows that fall in a leaf of their own class, so the most
+     * decisive trees vote first.
+     */
+    inline void setEarlyExit(bool earlyExit) { earlyExit_ = earlyExit; }
+    inline bool earlyExit() const { return earlyExit_; }
+
+    /** Predicted class index of an encoded row. */
+    uint32_t predict(const double* x) const;
+    std::string predict(const VecS& row) const;
+
+    /**
+     * Encode and predict a batch of rows. Large batches are split over the
+     * shared thread pool.
+     */
+    std::vector<uint32_t> predictBatch(const Data& rows) const;
+
+    /**
+     * Predict the given rows of a data set that is already encoded with the
+     * schema of this forest, without parsing anything.
+     */
+    std::vector<uint32_t> predictBatch(const ColumnStore& store, const std::vector<uint32_t>& rows) const;
+    Metrics evaluate(const Data& rows) const;
+
+    /** Whether the leader of `votes` stays ahead whatever `remaining` trees vote. */
+    static bool decided(const uint32_t* votes, size_t numClasses, size_t remaining);
+
+  private:
+    // Batches check which rows are settled after every this many trees.
+    static constexpr size_t earlyExitGroup = 8;
+
+    static double confidence(const FlatTree& tree, size_t numClasses);
+
+    /** Predict `n` consecutive encoded rows. */
+    void predictEncoded(const double* encoded, size_t n, uint32_t* predictions) const;
+
+    Schema schema_{};
+    std::vector<FlatTree> trees_{};
+    std::shared_ptr<const void> storage_{};
+    uint64_t seed_ = 0;
+    bool earlyExit_ = true;
+};
+
+#endif //DECISIONTREE_FOREST_HPP
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_HOEFFDINGTREE_HPP
+#define DECISIONTREE_HOEFFDINGTREE_HPP
+
+#include <string>
+#include <vector>
+#include "Calculations.hpp"
+#include "Forest.hpp"
+#include "Metrics.hpp"
+#include "Node.hpp"
+#include "Schema.hpp"
+#include "Utils.hpp"
+
+/**
+ * Settings of the streaming tree learner.
+ */
+struct HoeffdingConfig {
+  // Probability that a split is not the one the full stream would choose.
+  double delta = 1e-7;
+
+  // Split anyway once the Hoeffding bound drops below this, as the two best
+  // splits are then about equally good.
+  double tieThreshold = 0.05;
+
+  // Number of rows a leaf sees between two split attempts.
+  size_t gracePeriod = 200;
+
+  // Number of candidate thresholds per numeric feature.
+  size_t numThresholds = 16;
+
+  // Upper bound on the number of leaves. When it is reached the statistics
+  // of all leaves are released and the tree only updates its leaf counts.
+  size_t maxLeaves = 1 << 14;
+};
+
+/**
+ * Very fast decision tree (VFDT): a tree learned from a stream that sees
+ * every row once.
+ *
+ * Every leaf keeps the class counts of the rows that reached it, per value
+ * of every categorical feature and as a normal distribution per class of
+ * every numeric feature. Every `gracePeriod` rows the leaf scores its
+ * candidate splits on these statistics, with the same gini gain as the
+ * batch learner, and splits when the Hoeffding bound guarantees that the
+ * best split is better than the runner-up. The statistics of a leaf have a
+ * fixed size, so learning a row costs the same however long the stream is,
+ * and the memory is bounded by `maxLeaves`.
+ */
+class HoeffdingTree {
+  public:
+    HoeffdingTree() = delete;
+
+    /** Rows must follow the columns of `meta`, with the class label last. */
+    explicit HoeffdingTree(const MetaData& meta, const HoeffdingConfig& config = HoeffdingConfig());
+
+    /**
+     * Learn from one row. Rows with a class that is not declared in the
+     * meta data are rejected with an exception.
+     */
+    void learn(const VecS& row);
+    void learn(const Data& rows);
+
+    /**
+     * Learn from a row encoded by `schema()` with the class code `label`;
+     * throws std::invalid_argument if there is no class `label`.
+     */
+    void learn(const double* x, uint32_t label);
+
+    std::string predict(const VecS& row) const;
+    Metrics evaluate(const Data& rows) const;
+
+    /** The tree as it is now, as a Node tree and as a compact Forest. */
+    Node root() const;
+    Forest flatten() const;
+
+    inline const Schema& schema() const { return schema_; }
+    inline size_t numRows() const { return numRows_; }
+    inline size_t numLeaves() const { return leaves_.size(); }
+    inline size_t numNodes() const { return nodes_.size(); }
+
+  private:
+    /** Running mean and variance of a numeric feature for one class. */
+    struct Gaussian {
+      double count = 0.0;
+      double mean = 0.0;
+      double m2 = 0.0;
+      double min = std::numeric_limits<double>::infinity();
+      double max = -std::numeric_limits<double>::infinity();
+
+      void add(double x);
+      /** Estimated number of values >= `threshold`. */
+      double countAbove(double threshold) const;
+    };
+
+    struct LeafStats {
+      ClassHistogram counts{};
+      ClassHistogram observed{};        // class counts of the rows in the statistics
+      size_t seen = 0;
+      size_t lastAttempt = 0;
+      // class-major counts per code of every categorical feature, at offsets_
+      std::vector<double> categorical{};
+      std::vector<Gaussian> numeric{};  // numClasses per numeric feature
+    };
+
+    struct Candidate {
+      double gain = 0.0;
+      uint32_t feature = 0;
+      uint32_t kind = FlatNode::Leaf;
+      double value = 0.0;
+      ClassHistogram trueCounts{};
+    };
+
+    Schema schema_;
+    HoeffdingConfig config_;
+    size_t numClasses_;
+    std::vector<size_t> offsets_;       // of every feature in its kind of statistics
+    std::vector<FlatNode> nodes_;       // leaves point to their statistics with `left`
+    std::vector<LeafStats> leaves_;
+    bool growing_;
+    size_t numRows_;
+    std::vector<double> encoded_;
+
+    void reset(LeafStats& leaf) const;
+    uint32_t leafOf(const double* x) const;
+    Candidate bestSplit(const LeafStats& leaf, Candidate& runnerUp) const;
+    void attemptSplit(uint32_t node);
+    double bound(double n) const;
+    Node toNode(uint32_t index) const;
+};
+
+#endif //DECISIONTREE_HOEFFDINGTREE_HPP
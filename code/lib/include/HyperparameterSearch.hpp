@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_HYPERPARAMETERSEARCH_HPP
+#define DECISIONTREE_HYPERPARAMETERSEARCH_HPP
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Calculations.hpp"
+#include "DataReader.hpp"
+#include "Metrics.hpp"
+#include "TreeConfig.hpp"
+
+/**
+ * One configuration to try: a single tree, or a bagged ensemble of `trees`
+ * trees grown with the same settings.
+ */
+struct Hyperparameters {
+  TreeConfig tree{};
+  int trees = 1;
+
+  std::string toString() const;
+};
+
+/**
+ * Values to try for every setting. A grid search tries every combination,
+ * a random search draws combinations.
+ */
+struct SearchSpace {
+  std::vector<int> maxDepth{0};
+  std::vector<size_t> minLeaf{1};
+  std::vector<size_t> mtry{0};
+  // Best threshold per numeric feature, or a random one (Extra-Trees).
+  std::vector<bool> randomThresholds{false};
+  std::vector<int> trees{1};
+};
+
+struct SearchOptions {
+  // One of this many stratified folds of the training set is held out to
+  // score the configurations, the others are trained on.
+  size_t validationFolds = 5;
+
+  // Successive halving keeps the best 1 / eta of the configurations of a
+  // round, and gives the next round eta times as many training rows.
+  double eta = 3.0;
+
+  // Training rows of the first round, at least.
+  size_t minRows = 1000;
+
+  uint64_t seed = 1234;
+};
+
+/** Score of a configuration in the last round it took part in. */
+struct SearchResult {
+  Hyperparameters params{};
+  size_t round = 0;
+  size_t rows = 0;        // training rows of that round
+  Metrics metrics{};      // on the held-out rows
+  double seconds = 0.0;   // wall time of training and scoring
+  double cost = 0.0;      // estimated relative cost on all training rows
+};
+
+/**
+ * Hyperparameter search by successive halving over one shared data set.
+ *
+ * The data set is parsed and encoded once. Every configuration trains on
+ * a subset of its rows, selected by weights on the shared column store,
+ * so nothing is copied. The first round scores all configurations on
+ * `minRows` rows. Every next round keeps the best 1 / eta and trains them
+ * on eta times as many rows, until the last round uses the whole training
+ * part. Poor configurations are dropped after a cheap round.
+ *
+ * The configurations of a round are trained concurrently on the shared
+ * thread pool, one per worker, and are queued from the cheapest estimated
+ * cost up: the cost grows with the number of trees, the features examined
+ * per split and the depth, and is lower for random thresholds. Cheap
+ * configurations finish first, so their workers move on to the next job
+ * while the expensive ones are still running. Between configurations with
+ * the same accuracy, the cheaper one ranks higher.
+ */
+class HyperparameterSearch {
+  public:
+    HyperparameterSearch() = delete;
+    explicit HyperparameterSearch(std::shared_ptr<const DataReader> dr,
+                                  const SearchOptions& options = SearchOptions());
+
+    static std::vector<Hyperparameters> grid(const SearchSpace& space);
+    /** `count` distinct combinations, drawn at random; fewer if the space is smaller. */
+    static std::vector<Hyperparameters> sample(const SearchSpace& space, size_t count, uint64_t seed = 1234);
+
+    /**
+     * Run successive halving on `candidates`. The results are ranked: the
+     * configurations that reached the last round first, each round by
+     * accuracy on the held-out rows.
+     */
+    std::vector<SearchResult> run(const std::vector<Hyperparameters>& candidates) const;
+
+    static void printReport(std::ostream& out, const std::vector<SearchResult>& results);
+
+  private:
+    std::shared_ptr<const DataReader> dr_;
+    SearchOptions options_;
+    Rows train_;        // in random order, a round trains on a prefix
+    Rows validation_;
+
+    double cost(const Hyperparameters& params) const;
+    SearchResult evaluate(const Hyperparameters& params, size_t rows) const;
+};
+
+#endif //DECISIONTREE_HYPERPARAMETERSEARCH_HPP
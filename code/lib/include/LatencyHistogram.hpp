@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_LATENCYHISTOGRAM_HPP
+#define DECISIONTREE_LATENCYHISTOGRAM_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Lock-free histogram of latencies in nanoseconds.
+ *
+ * Values are bucketed log-linearly: every power of two is split into 32
+ * buckets, so a reported percentile is within about 3% of the true value.
+ * Any thread may record; reading while recording gives a consistent enough
+ * snapshot for monitoring.
+ */
+class LatencyHistogram {
+  public:
+    LatencyHistogram();
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(uint64_t nanoseconds);
+    void reset();
+
+    uint64_t count() const;
+    uint64_t max() const;
+    double mean() const;
+
+    /** Upper bound of the bucket holding the given quantile (0 to 1). */
+    uint64_t percentile(double q) const;
+
+  private:
+    static constexpr int subBits = 5;
+    static constexpr size_t numBuckets = (64 - subBits + 1) << subBits;
+
+    static size_t bucketOf(uint64_t value);
+    static uint64_t upperBound(size_t bucket);
+
+    std::array<std::atomic<uint64_t>, numBuckets> buckets_;
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+};
+
+#endif //DECISIONTREE_LATENCYHISTOGRAM_HPP
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_MEMORY_HPP
+#define DECISIONTREE_MEMORY_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Leaf.hpp"
+#include "Utils.hpp"
+
+class ColumnStore;
+class DataReader;
+class Forest;
+class Node;
+class QuantileSketch;
+class Schema;
+
+/**
+ * Bytes held by a model and the data it was trained on.
+ */
+struct MemoryUsage {
+  size_t dataset = 0;             // rows, meta data and column store
+  size_t scratch = 0;             // peak of the split search scratch space, see Memory::Scratch
+  size_t nodes = 0;               // test nodes
+  size_t leaves = 0;              // leaves and their class counts
+  size_t other = 0;               // e.g. out-of-bag votes
+  std::vector<size_t> members{};  // nodes and leaves of every ensemble member
+
+  inline size_t total() const { return dataset + scratch + nodes + leaves + other; }
+};
+
+/**
+ * Memory accounting: the bytes held by data sets and trees, the scratch
+ * space of the split search, the peak resident set size of every phase of
+ * a run, and a budget that makes training fail fast instead of being
+ * killed by the OOM killer.
+ *
+ * The byte counts are estimates of the heap memory of the containers,
+ * including the overhead of strings, hash maps and shared pointers; they
+ * are computed by walking the structures, so call them between phases.
+ */
+namespace Memory {
+
+/** Heap bytes of the structures, including the object itself. */
+size_t bytes(const std::string& s);
+size_t bytes(const Data& data);
+size_t bytes(const MetaData& meta);
+size_t bytes(const Schema& schema);
+size_t bytes(const QuantileSketch& sketch);
+size_t bytes(const ColumnStore& store);
+size_t bytes(const DataReader& dr);
+size_t bytes(const Forest& forest);
+
+/**
+ * Add the test nodes and the leaves of the tree under `root` to `usage`.
+ * Subtrees shared by several nodes are counted once. Returns the bytes of
+ * the tree.
+ */
+size_t addTree(const Node& root, MemoryUsage& usage);
+
+void print(std::ostream& out, const MemoryUsage& usage);
+
+/**
+ * Scratch space of the split search, counted while the guard lives. The
+ * peak over all threads is kept until `resetScratchPeak`.
+ */
+class Scratch {
+  public:
+    explicit Scratch(size_t bytes);
+    Scratch(const Scratch&) = delete;
+    Scratch& operator=(const Scratch&) = delete;
+    ~Scratch();
+
+  private:
+    size_t bytes_;
+};
+
+size_t scratchInUse();
+size_t scratchPeak();
+void resetScratchPeak();
+
+/** Resident set size of the process in bytes, 0 where it is unknown. */
+size_t currentRss();
+/** Largest resident set size since the process started or `resetPeakRss`. */
+size_t peakRss();
+/** Start a new peak measurement; Linux supports this since 4.0. */
+void resetPeakRss();
+
+/**
+ * Records the peak resident set size while it lives under `name`. Phases
+ * may nest and overlap, but only the outermost one resets the peak, so a
+ * nested phase reports the peak since its outermost phase started.
+ */
+class Phase {
+  public:
+    explicit Phase(std::string name);
+    Phase(const Phase&) = delete;
+    Phase& operator=(const Phase&) = delete;
+    ~Phase();
+
+  private:
+    std::string name_;
+};
+
+struct PhasePeak {
+  std::string name;
+  size_t calls;
+  size_t peakRss;   // bytes, the largest over all calls
+};
+
+/** Peaks of all phases in the order they were first entered. */
+std::vector<PhasePeak> phasePeaks();
+void clearPhases();
+void printPhases(std::ostream& out);
+
+class BudgetExceeded : public std::runtime_error {
+  public:
+    explicit BudgetExceeded(const std::string& what) : std::runtime_error(what) {}
+};
+
+/** Limit the resident set size to `bytes`, 0 for no limit. */
+void setBudget(size_t bytes);
+size_t budget();
+
+/**
+ * Throw BudgetExceeded if the resident set size plus the `additional`
+ * bytes about to be allocated for `what` exceed the budget.
+ */
+void checkBudget(const std::string& what, size_t additional = 0);
+
+} // namespace Memory
+
+#endif //DECISIONTREE_MEMORY_HPP
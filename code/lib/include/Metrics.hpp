@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_METRICS_HPP
+#define DECISIONTREE_METRICS_HPP
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Utils.hpp"
+
+/**
+ * Evaluation results of a classifier on a labelled data set.
+ *
+ * Holds a confusion matrix (rows: actual class, columns: predicted class)
+ * from which accuracy and per-class precision and recall are derived.
+ * Metrics computed on disjoint parts of a data set can be combined with
+ * `merge`, which is how the parallel evaluation builds its result.
+ */
+class Metrics {
+  public:
+    Metrics() = default;
+    explicit Metrics(const VecS& classes);
+
+    /**
+     * Record one example. Labels that were not known yet are appended to
+     * the list of classes.
+     */
+    void add(const std::string& actual, const std::string& predicted);
+    void add(size_t actual, size_t predicted);
+    void merge(const Metrics& other);
+
+    size_t classIndex(const std::string& label);
+
+    inline const VecS& classes() const { return classes_; }
+    inline size_t total() const { return total_; }
+    inline size_t correct() const { return correct_; }
+    inline size_t count(size_t actual, size_t predicted) const {
+      return confusion_[actual * classes_.size() + predicted];
+    }
+
+    double accuracy() const;
+    double precision(size_t c) const;
+    double recall(size_t c) const;
+
+    /** Fraction of the examples of class `c` that were misclassified. */
+    double error(size_t c) const;
+
+    void print(std::ostream& os = std::cout) const;
+
+  private:
+    VecS classes_{};
+    std::unordered_map<std::string, size_t> index_{};
+    std::vector<size_t> confusion_{};
+    size_t total_ = 0;
+    size_t correct_ = 0;
+};
+
+#endif //DECISIONTREE_METRICS_HPP
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_MICROBATCHER_HPP
+#define DECISIONTREE_MICROBATCHER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "LatencyHistogram.hpp"
+#include "Utils.hpp"
+
+/**
+ * Groups single-row prediction requests into batches for an online scorer.
+ *
+ * A batch is handed to the predictor as soon as it holds `maxBatchSize`
+ * rows, or when the oldest row in it has waited `maxWait`. Answers are
+ * delivered through the callback of each request, in submission order, on
+ * the batching thread. Latency is measured from `submit` until the callback
+ * is invoked.
+ */
+class MicroBatcher {
+  public:
+    using Predictor = std::function<void(const Data& rows, VecS& predictions)>;
+    using Callback = std::function<void(const std::string& prediction)>;
+    using Clock = std::chrono::steady_clock;
+
+    MicroBatcher(Predictor predictor, size_t maxBatchSize, std::chrono::microseconds maxWait);
+    MicroBatcher(const MicroBatcher&) = delete;
+    MicroBatcher& operator=(const MicroBatcher&) = delete;
+
+    /** Answers all pending requests before returning. */
+    ~MicroBatcher();
+
+    void submit(VecS row, Callback done);
+
+    /** Block until every request submitted so far has been answered. */
+    void drain();
+
+    inline const LatencyHistogram& latency() const { return latency_; }
+    inline uint64_t requests() const { return requests_.load(); }
+    inline uint64_t batches() const { return batches_.load(); }
+    inline double uptime() const {
+      return std::chrono::duration<double>(Clock::now() - started_).count();
+    }
+
+    /** One-line summary of counters, throughput and latency percentiles. */
+    std::string summary() const;
+
+  private:
+    struct Request {
+      VecS row;
+      Callback done;
+      Clock::time_point arrived;
+    };
+
+    void run();
+
+    Predictor predictor_;
+    const size_t maxBatchSize_;
+    const std::chrono::microseconds maxWait_;
+
+    std::deque<Request> pending_;
+    std::mutex mutex_;
+    std::condition_variable available_;
+    std::condition_variable idle_;
+    bool busy_;
+    bool stopping_;
+
+    LatencyHistogram latency_;
+    std::atomic<uint64_t> requests_;
+    std::atomic<uint64_t> batches_;
+    const Clock::time_point started_;
+    std::thread worker_;
+};
+
+#endif //DECISIONTREE_MICROBATCHER_HPP
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_MODELIO_HPP
+#define DECISIONTREE_MODELIO_HPP
+
+#include <string>
+#include "CompactForest.hpp"
+#include "Forest.hpp"
+
+/**
+ * Binary model files for single trees and ensembles.
+ *
+ * All integers and doubles are stored little-endian. The file layout is:
+ *
+ *   header       magic "FCARTMDL", u32 version, u32 flags, u32 numTrees,
+ *                u32 numClasses, u32 numFeatures, u32 reserved, u64 seed,
+ *                u64 schemaOffset, u64 schemaSize, u64 treeTableOffset,
+ *                u64 fileSize
+ *   schema       class label, per feature: u8 type, name and domain,
+ *                followed by the class values (strings are u32 length +
+ *                bytes)
+ *   tree table   per tree: u64 nodesOffset, u64 countsOffset,
+ *                u32 numNodes, u32 numCounts, u64 reserved
+ *   trees        FlatNode arrays and u32 leaf count arrays, 8-byte aligned
+ *
+ * On little-endian hosts `load` maps the file and the node arrays are used
+ * in place; only the (small) schema is parsed.
+ *
+ * Compressed forests (see CompactForest) have their own format, read
+ * sequentially into memory:
+ *
+ *   header       magic "FCARTCMP", u32 version, u32 numTrees,
+ *                u32 numClasses, u32 numFeatures, u64 seed,
+ *                f64 thresholdError, f64 distributionError
+ *   schema       as above
+ *   codebooks    per feature: u32 size and the f64 thresholds
+ *   roots        u32 node index per tree
+ *   nodes        u32 count, per node: u32 left, u32 right, u16 feature,
+ *                u16 value
+ *   leaves       u32 count and the u16 class distributions
+ */
+namespace ModelIO {
+
+constexpr uint32_t version = 1;
+
+/**
+ * Write the model to `filename`.tmp and rename it over `filename`, so a
+ * process serving the old file from its mapping is not affected.
+ */
+void save(const Forest& forest, const std::string& filename);
+
+/**
+ * Map a model file. With `verify` set, every node is checked to only
+ * reference nodes and leaf counts of its own tree, and features and
+ * category codes of the schema, which touches the whole file; otherwise
+ * only the header, schema and tree table are validated.
+ */
+Forest load(const std::string& filename, bool verify = false);
+
+constexpr uint32_t compactVersion = 1;
+
+void saveCompact(const CompactForest& forest, const std::string& filename);
+
+/** Read a compressed model file. Every node is checked, as the file is read whole anyway. */
+CompactForest loadCompact(const std::string& filename);
+
+} // namespace ModelIO
+
+#endif //DECISIONTREE_MODELIO_HPP
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_MODELREGISTRY_HPP
+#define DECISIONTREE_MODELREGISTRY_HPP
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Forest.hpp"
+
+/**
+ * Holds the live model of a serving process and lets it be replaced while
+ * predictions are running.
+ *
+ * Readers pin the current model with `acquire`, which never blocks: it
+ * publishes the model pointer in one of `maxReaders` hazard slots and
+ * re-checks that it is still current. A writer swaps the pointer atomically
+ * with `publish` and keeps the old model on a retired list until no slot
+ * refers to it any more. Retired models are only freed by the writer, on
+ * the next publish or by `reclaim`; releasing a handle just clears its slot.
+ */
+class ModelRegistry {
+  public:
+    static constexpr size_t maxReaders = 256;
+
+  private:
+    struct alignas(64) Slot {
+      std::atomic<const Forest*> hazard{nullptr};
+      std::atomic<bool> used{false};
+    };
+
+  public:
+    /**
+     * A pinned model. The model stays valid for the lifetime of the handle,
+     * even if it is replaced in the meantime.
+     */
+    class Handle {
+      public:
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+        Handle(Handle&& other) noexcept;
+        ~Handle();
+
+        inline const Forest& operator*() const { return *model_; }
+        inline const Forest* operator->() const { return model_; }
+        inline const Forest* get() const { return model_; }
+        inline explicit operator bool() const { return model_ != nullptr; }
+
+      private:
+        friend class ModelRegistry;
+        Handle(Slot* slot, const Forest* model);
+
+        Slot* slot_;
+        const Forest* model_;
+    };
+
+    ModelRegistry();
+    explicit ModelRegistry(std::shared_ptr<const Forest> model);
+    ModelRegistry(const ModelRegistry&) = delete;
+    ModelRegistry& operator=(const ModelRegistry&) = delete;
+
+    /** All handles must have been released before the registry goes away. */
+    ~ModelRegistry() = default;
+
+    /**
+     * Pin the live model. Throws std::runtime_error if `maxReaders` handles
+     * are live already.
+     */
+    Handle acquire() const;
+
+    /** Make `model` the live model and retire the previous one. */
+    void publish(std::shared_ptr<const Forest> model);
+
+    /**
+     * Free retired models that are no longer pinned by any reader. Meant for
+     * the writer: it waits for a running publish.
+     */
+    void reclaim() const;
+
+    inline uint64_t version() const { return version_.load(); }
+    inline size_t retired() const { return numRetired_.load(); }
+
+  private:
+    Slot* claimSlot() const;
+    void reclaimLocked() const;
+
+    mutable std::array<Slot, maxReaders> slots_;
+    std::atomic<const Forest*> current_;
+    std::atomic<uint64_t> version_;
+
+    mutable std::mutex writer_;
+    std::shared_ptr<const Forest> owner_;
+    mutable std::vector<std::shared_ptr<const Forest>> retired_;
+    mutable std::atomic<size_t> numRetired_;
+};
+
+#endif //DECISIONTREE_MODELREGISTRY_HPP
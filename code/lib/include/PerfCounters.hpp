@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_PERFCOUNTERS_HPP
+#define DECISIONTREE_PERFCOUNTERS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+/**
+ * Hardware performance counters per traced phase and per tree depth.
+ *
+ * When enabled, every Trace::Span also reads the cycles, instructions, L1
+ * data cache misses, last level cache misses and branch misses of its
+ * thread (Linux perf_event_open, user space only) and adds the difference
+ * to the totals of its phase at the depth of the node being built. The
+ * totals of a span leave out the spans nested in it on the same thread, so
+ * build_node counts the work of a node outside its find_best_split and
+ * partition, and the rows add up to all traced work. Work a span hands to
+ * other threads, such as the OpenMP loop over columns near the root, is not
+ * counted.
+ *
+ * A counter the kernel or container refuses is left out, and with none at
+ * all only calls and time are collected; `status` tells which counters
+ * work. Reading the counters is a system call per span end, so this is
+ * for profiling runs only.
+ */
+namespace PerfCounters {
+
+enum Counter { Cycles, Instructions, L1Misses, LlcMisses, BranchMisses, numCounters };
+
+/** Values of all counters; a counter that is not available reads 0. */
+using Sample = std::array<uint64_t, numCounters>;
+
+// Totals of spans outside any tree node are kept under this depth.
+constexpr int64_t noDepth = -1;
+
+namespace detail {
+  extern std::atomic<bool> enabled;
+}
+
+inline bool enabled() { return detail::enabled.load(std::memory_order_relaxed); }
+
+/**
+ * Start or stop collecting. Returns whether any hardware counter could be
+ * opened on the calling thread; the others open theirs on first use.
+ */
+bool enable(bool on = true);
+
+/** Whether `counter` could be opened, and if not, why. */
+bool available(Counter counter);
+std::string status();
+
+/** Drop all totals. */
+void reset();
+
+/** Tables of the totals per phase and per phase and depth. */
+void printSummary(std::ostream& out);
+
+/**
+ * Counters of a span, used by Trace::Span. `begin` enters depth `depth`
+ * (or keeps the current one for noDepth) and `end` adds the totals of the
+ * span to `name`.
+ */
+class Scope {
+  public:
+    void begin(int64_t depth);
+    void end(const char* name, uint64_t nanoseconds);
+
+  private:
+    Sample start_{};
+    Sample nested_{};                 // counts of the spans nested in this one
+    uint64_t nestedNanoseconds_ = 0;
+    Scope* outer_ = nullptr;
+    int64_t outerDepth_ = noDepth;
+};
+
+} // namespace PerfCounters
+
+#endif //DECISIONTREE_PERFCOUNTERS_HPP
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_PRUNING_HPP
+#define DECISIONTREE_PRUNING_HPP
+
+#include "Node.hpp"
+#include "Schema.hpp"
+#include "Utils.hpp"
+
+/**
+ * Post-pruning of trained trees. A pruned subtree becomes a leaf with the
+ * summed class counts of the leaves below it, so it predicts the majority
+ * class of the training rows that reached it, ties going to the first
+ * class of `schema` as in a Forest. The input tree is not changed; the
+ * pruned tree shares every subtree that was kept with it.
+ */
+namespace Pruning {
+
+/** Number of nodes of a tree, leaves included. */
+size_t countNodes(const Node& root);
+
+/**
+ * Minimal cost-complexity pruning (CART): the smallest subtree that
+ * minimises R(T) + alpha * |leaves(T)|, with R(T) the fraction of the
+ * training rows that T misclassifies. alpha = 0 only removes splits that
+ * do not reduce the training error; every increase of alpha by 1 / N
+ * (N training rows) is worth one misclassified row per leaf removed.
+ */
+Node costComplexity(const Node& root, const Schema& schema, double alpha);
+
+/**
+ * Reduced-error pruning: a subtree is replaced by a leaf, bottom-up, if
+ * that leaf makes no more mistakes on the validation rows that reach it
+ * than the subtree does. Subtrees that no validation row reaches are
+ * replaced as well.
+ */
+Node reducedError(const Node& root, const Schema& schema, const Data& validation);
+
+}
+
+#endif //DECISIONTREE_PRUNING_HPP
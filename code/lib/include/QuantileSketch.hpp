@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_QUANTILESKETCH_HPP
+#define DECISIONTREE_QUANTILESKETCH_HPP
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Mergeable quantile sketch of a stream of doubles (KLL, Karnin, Lang and
+ * Liberty, 2016), used to find histogram bin boundaries in a single pass.
+ *
+ * Values are kept in compactors, one per level; a value at level h stands
+ * for 2^h values of the stream. When the sketch is full, the lowest full
+ * compactor is sorted and every other value, starting at a random one of
+ * the first two, moves up a level. Capacities shrink by a factor 2/3 from
+ * the top level down, so the sketch holds about 3k values whatever the
+ * length of the stream, and is exact while it has seen fewer than k.
+ *
+ * The rank of a value returned by `quantile` is within `rankError() * n`
+ * of the requested rank with a probability of 99%, where n is the number
+ * of values added. Sketches built with the same k on separate threads or
+ * processes can be merged with the same guarantee; `serialize` turns a
+ * sketch into bytes to ship it between processes. NaN values are ignored.
+ */
+class QuantileSketch {
+  public:
+    static constexpr size_t defaultK = 200;
+
+    explicit QuantileSketch(size_t k = defaultK, uint64_t seed = 1234);
+
+    void add(double value);
+    /** Add all values of `other`, which must have the same k. */
+    void merge(const QuantileSketch& other);
+
+    inline size_t k() const { return k_; }
+    /** Number of values added, merged sketches included. */
+    inline uint64_t count() const { return count_; }
+    inline bool empty() const { return count_ == 0; }
+    /** Smallest and largest value added, exact. */
+    inline double min() const { return min_; }
+    inline double max() const { return max_; }
+
+    /** Values held, the sketch's size in memory. */
+    size_t numRetained() const;
+
+    /**
+     * Normalized rank error of the sketch at 99% confidence: ranks are off
+     * by at most this fraction of `count`. It only depends on k, e.g. 1.3%
+     * for k = 200 and 0.3% for k = 1000.
+     */
+    double rankError() const;
+    static double rankError(size_t k);
+
+    /** Value whose rank is about `q * count` (0 <= q <= 1); NaN for an empty sketch. */
+    double quantile(double q) const;
+
+    /**
+     * Lower bounds of `numBins` bins of about equal size: the values at
+     * ranks b * count / numBins, for b = 0 .. numBins - 1. The first is the
+     * exact minimum. Values repeated more than a bin's share of the stream
+     * show up as equal bounds.
+     */
+    std::vector<double> boundaries(size_t numBins) const;
+
+    std::string serialize() const;
+    /** Throws std::runtime_error if `bytes` is not a serialized sketch. */
+    static QuantileSketch deserialize(const std::string& bytes, uint64_t seed = 1234);
+
+  private:
+    size_t k_;
+    uint64_t count_ = 0;
+    double min_;
+    double max_;
+    size_t size_ = 0;       // values held, over all levels
+    size_t maxSize_ = 0;    // total capacity of the levels
+    std::vector<std::vector<double>> levels_{};
+    std::mt19937_64 random_number_generator_;
+
+    size_t capacity(size_t level) const;
+    void grow();
+    void compress();
+    /** Held values with their weights, by increasing value. */
+    std::vector<std::pair<double, uint64_t>> weighted() const;
+};
+
+#endif //DECISIONTREE_QUANTILESKETCH_HPP
@@ -21,14 +21,24 @@ class Question {
   public:
     Question();
     Question(const int column, const std::string value);
+    Question(const int column, const std::string value, const bool numeric);
 
-    const bool solve(VecS example) const;
+    /**
+     * Numeric test `x >= threshold`. The value is the shortest decimal that
+     * parses back to the same double, so tests on strings agree with tests
+     * on parsed values.
+     */
+    Question(const int column, const double threshold);
+
+    const bool solve(const VecS& example) const;
     const bool isNumeric(std::string value) const;
     const bool isNumeric(void) const;
     const std::string toString(const VecS& labels) const;
 
     int column_;
     std::string value_;
+    bool numeric_;      // threshold test (>=) instead of equality test
+    double threshold_;  // value_ parsed, for numeric questions
 };
 
 #endif //DECISIONTREE_QUESTION_HPP
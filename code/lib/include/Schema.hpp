@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_SCHEMA_HPP
+#define DECISIONTREE_SCHEMA_HPP
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Utils.hpp"
+
+/**
+ * Column layout of the examples a model was trained on.
+ *
+ * The schema turns a row of strings into a row of doubles: numeric columns
+ * are parsed, categorical columns are replaced by the index of the value in
+ * the column domain. Values that can not be parsed or are not in the domain
+ * become NaN, which sends them down the false branch of every test, just as
+ * `Question::solve` does.
+ */
+class Schema {
+  public:
+    enum class ColumnType : uint8_t { Numeric = 0, Categorical = 1 };
+
+    Schema() = default;
+    explicit Schema(const MetaData& meta);
+
+    inline size_t numFeatures() const { return names_.size(); }
+    inline size_t numClasses() const { return classes_.size(); }
+    inline const VecS& names() const { return names_; }
+    inline const std::vector<ColumnType>& types() const { return types_; }
+    inline const std::vector<VecS>& domains() const { return domains_; }
+    inline const VecS& classes() const { return classes_; }
+    inline const std::string& classLabel() const { return classLabel_; }
+
+    /** Index of a categorical value or class, `npos` if it is unknown. */
+    uint32_t code(size_t column, const std::string& value) const;
+    uint32_t classCode(const std::string& label) const;
+
+    /** Index of a categorical value or class, added if it is unknown. */
+    uint32_t addCode(size_t column, const std::string& value);
+    uint32_t addClass(const std::string& label);
+
+    void encode(const VecS& row, double* out) const;
+
+    void addColumn(std::string name, ColumnType type, VecS domain);
+    void setClasses(std::string label, VecS classes);
+
+    static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+  private:
+    VecS names_{};
+    std::vector<ColumnType> types_{};
+    std::vector<VecS> domains_{};
+    std::vector<std::unordered_map<std::string, uint32_t>> codes_{};
+    std::string classLabel_{};
+    VecS classes_{};
+    std::unordered_map<std::string, uint32_t> classCodes_{};
+};
+
+#endif //DECISIONTREE_SCHEMA_HPP
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_THREADPOOL_HPP
+#define DECISIONTREE_THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed-size pool of worker threads with a shared FIFO task queue.
+ *
+ * Tasks are submitted with `submit`, which returns a future for the result.
+ * `parallelFor` splits an index range in chunks; the calling thread works on
+ * chunks as well, so it is safe to call from within a task running on the
+ * same pool.
+ */
+class ThreadPool {
+  public:
+    explicit ThreadPool(size_t numThreads = std::thread::hardware_concurrency());
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    /**
+     * The process-wide pool, sized to the number of hardware threads.
+     */
+    static ThreadPool& shared();
+
+    inline size_t size() const { return workers_.size(); }
+
+    template<typename F>
+    auto submit(F&& task) -> std::future<decltype(task())>;
+
+    /**
+     * Calls `body(begin, end)` for consecutive chunks of [first, last) of at
+     * most `grain` indices and blocks until all chunks are processed.
+     */
+    void parallelFor(size_t first, size_t last, size_t grain,
+                     const std::function<void(size_t, size_t)>& body);
+
+  private:
+    void enqueue(std::function<void()> job);
+    void workerLoop();
+
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> jobs_;
+    std::mutex mutex_;
+    std::condition_variable available_;
+    bool stopping_;
+};
+
+template<typename F>
+auto ThreadPool::submit(F&& task) -> std::future<decltype(task())> {
+  using R = decltype(task());
+  auto packaged = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+  std::future<R> result = packaged->get_future();
+  enqueue([packaged]() { (*packaged)(); });
+  return result;
+}
+
+#endif //DECISIONTREE_THREADPOOL_HPP
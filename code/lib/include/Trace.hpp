@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_TRACE_HPP
+#define DECISIONTREE_TRACE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "PerfCounters.hpp"
+
+// Trace points are compiled in unless this is defined to 0, see TRACE_SPAN.
+#ifndef DECISIONTREE_TRACING
+#define DECISIONTREE_TRACING 1
+#endif
+
+/**
+ * Low-overhead tracing of the phases of training and prediction.
+ *
+ * A span records its name, start and duration, and optionally one integer
+ * argument such as the depth of a node, into a ring buffer of the thread
+ * that ran it. Nothing is locked or allocated on the hot path: a thread
+ * registers its buffer once, and when a buffer is full the oldest events
+ * are overwritten. Tracing is off until `enable` is called, and then a
+ * span costs two clock reads; with DECISIONTREE_TRACING set to 0 the trace
+ * points compile to nothing.
+ *
+ * `writeChromeTrace` exports the buffers of all threads in the Chrome trace
+ * event format, for chrome://tracing or Perfetto. Export while no traced
+ * work is running.
+ *
+ * Spans also collect hardware counters while PerfCounters is enabled,
+ * whether or not tracing is.
+ */
+namespace Trace {
+
+// Events kept per thread; older events are overwritten.
+constexpr size_t bufferSize = 1 << 16;
+
+namespace detail {
+  extern std::atomic<bool> enabled;
+}
+
+inline bool enabled() { return detail::enabled.load(std::memory_order_relaxed); }
+void enable(bool on = true);
+
+/** Drop all recorded events. */
+void clear();
+
+/** Events that were overwritten because a buffer was full. */
+uint64_t dropped();
+
+void writeChromeTrace(const std::string& filename);
+
+/** Monotonic clock in nanoseconds. */
+uint64_t now();
+
+/**
+ * Records the time from construction to destruction. `name` and `argName`
+ * must be string literals or otherwise outlive the trace. A span with the
+ * argument "depth" sets the tree depth for the counters of the spans it
+ * contains.
+ */
+class Span {
+  public:
+    explicit Span(const char* name, const char* argName = nullptr, int64_t arg = 0) :
+      name_(name), argName_(argName), arg_(arg), start_(0), counting_(false), counters_() {
+      if (enabled() || PerfCounters::enabled())
+        begin();
+    }
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+    ~Span() {
+      if (start_ != 0)
+        end();
+    }
+
+  private:
+    const char* name_;
+    const char* argName_;
+    int64_t arg_;
+    uint64_t start_;
+    bool counting_;
+    PerfCounters::Scope counters_;
+
+    void begin();
+    void end();
+};
+
+} // namespace Trace
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#if DECISIONTREE_TRACING
+#define TRACE_SPAN(...) const Trace::Span TRACE_CONCAT(traceSpan, __LINE__)(__VA_ARGS__)
+#else
+#define TRACE_SPAN(...) do {} while (false)
+#endif
+
+#endif //DECISIONTREE_TRACE_HPP
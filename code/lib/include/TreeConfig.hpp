@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_TREECONFIG_HPP
+#define DECISIONTREE_TREECONFIG_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Settings of the tree learner.
+ */
+struct TreeConfig {
+  // The two subtrees of a node are built concurrently down to this depth,
+  // and the split search of those nodes scans the columns in parallel. Use 0
+  // to build a tree on the calling thread only, e.g. when many trees are
+  // built at the same time.
+  int parallelDepth = 3;
+
+  // Number of randomly chosen features that is examined at every split, as
+  // in a random forest. 0 examines all features.
+  size_t mtry = 0;
+
+  // Extra-Trees: split numeric features on a random threshold between the
+  // smallest and largest value at the node instead of the best threshold.
+  bool randomThresholds = false;
+
+  // Nodes at this depth become leaves, the root is at depth 0. 0 grows the
+  // tree until no split improves it.
+  int maxDepth = 0;
+
+  // Splits that leave fewer rows than this on either side, counted with
+  // their weights, are skipped in the split search, as in CART: the node
+  // takes the best of the other splits.
+  size_t minLeaf = 1;
+
+  // Seed of the random choices above.
+  uint64_t seed = 0;
+};
+
+#endif //DECISIONTREE_TREECONFIG_HPP
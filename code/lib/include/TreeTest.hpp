@@ -7,6 +7,7 @@
 #ifndef DECISIONTREE_TREETEST_HPP
 #define DECISIONTREE_TREETEST_HPP
 
+#include "Metrics.hpp"
 #include "Node.hpp"
 #include "Utils.hpp"
 
@@ -15,14 +16,18 @@ using ClassCounterScaled = std::unordered_map<std::string, std::string>;
 class TreeTest {
   public:
     TreeTest() = default;
-    TreeTest(const Data& testData, const MetaData& meta, const Node &root);
     ~TreeTest() = default;
 
     const ClassCounter classify(const VecS& row, std::shared_ptr<Node> node) const;
 
-  private:
+    /**
+     * Evaluate a tree on the given data set. The rows are split over the
+     * shared thread pool; each chunk fills its own confusion matrix and the
+     * matrices are merged once all chunks are done.
+     */
+    Metrics test(const Data& testData, const MetaData& meta, const Node &root) const;
+
     void printLeaf(ClassCounter counts) const;
-    void test(const Data& testing_data, const VecS& labels, std::shared_ptr<Node> tree) const;
 };
 
 #endif //DECISIONTREE_TREETEST_HPP
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#ifndef DECISIONTREE_TREEUPDATER_HPP
+#define DECISIONTREE_TREEUPDATER_HPP
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include "BinnedColumns.hpp"
+#include "Calculations.hpp"
+#include "DataReader.hpp"
+#include "Node.hpp"
+#include "Schema.hpp"
+#include "TreeConfig.hpp"
+
+/**
+ * Keeps a trained tree up to date as new rows arrive, without retraining it
+ * from scratch.
+ *
+ * Every node keeps the class counts per bin of every feature of the rows
+ * that reached it (its histogram), every leaf keeps the ids of its rows.
+ * New rows are routed down the tree and added to the statistics on their
+ * path. Then only nodes on those paths are checked: a node whose best
+ * split, scored on its histogram, now beats its current split by more than
+ * a tolerance is retrained with the exact learner on the rows below it.
+ * Leaves count as splits without gain, so a leaf is only retrained when a
+ * split of it gains more than the tolerance; leaves at `maxDepth` never
+ * are, and splits that violate `minLeaf` don't count. Everything else
+ * keeps its split and only gets new class counts, so an update costs time
+ * in proportion to the new rows, the depth of the tree and the subtrees
+ * that actually change, not to the rows seen before.
+ *
+ * Histograms hold 32-bit counts, and a node only keeps one once it has
+ * seen `histogramFactor` binned values per histogram cell; from then on it
+ * is kept up to date row by row. So the histograms of one level of the
+ * tree take no more memory than the binned training set (a byte per
+ * value). A smaller node counts its histogram from the rows below it when
+ * it is checked, which by the same bound costs at most `histogramFactor`
+ * times a scan of a histogram. Leaves keep 4 bytes per row. The added rows
+ * themselves are kept as long as the updater lives, as retraining a
+ * subtree needs all rows below it: drop the updater (as DecisionTree does
+ * when it is pruned) to release them.
+ */
+class TreeUpdater {
+  public:
+    /**
+     * Trains a subtree on the given rows of a store, in place of the node at
+     * `depth` with number `node` (the root is 1, the children of n are 2n
+     * and 2n + 1).
+     */
+    using Builder = std::function<Node(const ColumnStore& store, const Rows& rows, int depth, uint64_t node)>;
+
+    // Resolution of the split statistics of numeric features.
+    static constexpr size_t numBins = 32;
+    // Binned values per histogram cell from which a node keeps its histogram.
+    static constexpr size_t histogramFactor = 4;
+
+    /**
+     * Collect the statistics of `root` from the training rows of `dr`,
+     * which must be the rows the tree was trained on with `config`. Costs
+     * one pass over the training set.
+     */
+    TreeUpdater(std::shared_ptr<const DataReader> dr, const Node& root, const TreeConfig& config);
+
+    /** Deep copy, for a copy of the tree that is updated on its own. */
+    TreeUpdater(const TreeUpdater& other);
+    TreeUpdater& operator=(const TreeUpdater&) = delete;
+
+    /** Add `rows` to the data and return the updated tree. */
+    Node update(const Node& root, const Data& rows, double tolerance, const Builder& build);
+
+    inline size_t numRows() const { return dr_->trainData().size() + added_.size(); }
+
+    /** Number of subtrees that were retrained by the last update. */
+    inline size_t rebuilt() const { return rebuilt_; }
+
+  private:
+    struct Stats {
+      ClassHistogram counts{};
+      std::vector<uint32_t> histogram{};                // nodes with enough rows, see `offsets_`
+      Rows rows{};                                      // leaves only
+      size_t size = 0;                                  // rows that reached the node
+      bool dirty = false;
+      int depth = 0;
+      uint64_t node = 1;
+      std::unique_ptr<Stats> trueChild{};
+      std::unique_ptr<Stats> falseChild{};
+    };
+
+    std::shared_ptr<const DataReader> dr_;
+    TreeConfig config_;
+    Schema schema_;
+    BinnedColumns bins_;
+    // The histogram of a node holds the class-major counts per bin of every
+    // column (see Calculations::best_histogram_split), column c at offsets_[c].
+    // Classes that were not known at training time are not counted in them.
+    size_t numClasses_;
+    std::vector<size_t> offsets_;
+    Data added_;
+    std::vector<uint32_t> addedLabels_;
+    std::unique_ptr<Stats> root_;
+    size_t rebuilt_;
+
+    const VecS& row(uint32_t id) const;
+    uint32_t label(uint32_t id) const;
+    void binRow(uint32_t id, uint8_t* bins) const;
+    void count(std::vector<uint32_t>& histogram, uint32_t classCode, const uint8_t* bins) const;
+    bool keepsHistogram(size_t size) const;
+    /** Histogram of the rows below a node, counted from their bins. */
+    std::vector<uint32_t> histogramOf(const Stats& stats) const;
+
+    static std::unique_ptr<Stats> clone(const Stats& stats);
+    std::unique_ptr<Stats> collect(const Node& node, const Rows& ids, int depth, uint64_t number) const;
+    void add(const Node& node, Stats& stats, uint32_t id, const uint8_t* bins, bool dirty) const;
+    void gather(const Stats& stats, Rows& ids) const;
+    double bestGain(const Stats& stats) const;
+    Node refresh(const Node& node, Stats& stats, double tolerance, const Builder& build);
+    Node rebuild(Stats& stats, const Builder& build);
+};
+
+#endif //DECISIONTREE_TREEUPDATER_HPP
@@ -29,7 +29,11 @@ struct MetaData {
   
   // column types for easier looping later on
   VecS columnTypes;   // types include 'categorical', 'ordinal', 'numeric'
-  
+
+  // nominal values of each column as declared in the header, empty for
+  // numeric columns; the last entry holds the class values
+  std::vector<VecS> domains;
+
 };
 
 
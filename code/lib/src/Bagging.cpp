@@ -4,60 +4,183 @@
  * Written by Pieter Robberechts, 2019
  */
 
+#include <cmath>
+#include <optional>
 #include "Bagging.hpp"
 #include "DecisionTree.hpp"
+#include "ThreadPool.hpp"
+#include "Memory.hpp"
+#include "ModelIO.hpp"
 
 using std::make_shared;
 using std::shared_ptr;
 using std::string;
 using boost::timer::cpu_timer;
 
-Bagging::Bagging(const DataReader& dr, const int ensembleSize, uint seed) : 
-  dr_(dr), 
+Bagging::Bagging(const DataReader& dr, const int ensembleSize, uint seed) :
+  Bagging(make_shared<const DataReader>(dr), ensembleSize, seed) {}
+
+Bagging::Bagging(shared_ptr<const DataReader> dr, const int ensembleSize, uint seed) :
+  Bagging(std::move(dr), ensembleSize, TreeConfig(), seed) {}
+
+Bagging::Bagging(shared_ptr<const DataReader> dr, const int ensembleSize, const TreeConfig& config, uint seed) :
+  dr_(std::move(dr)),
   ensembleSize_(ensembleSize),
-  learners_({}) {
-  random_number_generator.seed(seed);
-  buildBag();
+  seed_(seed),
+  config_(config),
+  learners_({}),
+  outOfBagVotes_(),
+  outOfBag_() {
+  buildBag(0, ensembleSize);
+}
+
+Bagging::Bagging(shared_ptr<const DataReader> dr, const Forest& model, const TreeConfig& config) :
+  dr_(std::move(dr)),
+  ensembleSize_(static_cast<int>(model.numTrees())),
+  seed_(static_cast<uint>(model.seed())),
+  config_(config),
+  learners_({}),
+  outOfBagVotes_(),
+  outOfBag_() {
+  for (auto& root: model.toNodes())
+    learners_.emplace_back(dr_, std::move(root), config_);
+}
+
+void Bagging::addTrees(int count) {
+  buildBag(ensembleSize_, count);
+  ensembleSize_ += count;
+}
+
+namespace {
+
+  size_t defaultMtry(const DataReader& dr, size_t mtry) {
+    if (mtry > 0)
+      return mtry;
+    const auto numFeatures = static_cast<double>(dr.trainColumns().numFeatures());
+    return std::max<size_t>(1, static_cast<size_t>(std::lround(std::sqrt(numFeatures))));
+  }
+
+}
+
+Bagging Bagging::randomForest(shared_ptr<const DataReader> dr, const int ensembleSize, size_t mtry, uint seed) {
+  TreeConfig config;
+  config.mtry = defaultMtry(*dr, mtry);
+  return Bagging(std::move(dr), ensembleSize, config, seed);
+}
+
+Bagging Bagging::extraTrees(shared_ptr<const DataReader> dr, const int ensembleSize, size_t mtry, uint seed) {
+  TreeConfig config;
+  config.mtry = defaultMtry(*dr, mtry);
+  config.randomThresholds = true;
+  return Bagging(std::move(dr), ensembleSize, config, seed);
 }
 
+/**
+ * Every learner draws its bootstrap sample from its own random stream,
+ * seeded with the ensemble seed and the index of the learner, so the
+ * ensemble does not depend on how many trees are built at the same time.
+ * The rows left out of the sample are predicted right away.
+ */
+Bagging::Learner Bagging::buildLearner(size_t index) const {
+  std::seed_seq seq{static_cast<uint64_t>(seed_), static_cast<uint64_t>(index)};
+  std::mt19937_64 random_number_generator(seq);
+  const size_t n = dr_->trainData().size();
+  std::uniform_int_distribution<size_t> uniform_sampler(0, n - 1);
+  // The sample is kept as a multiplicity per row, no rows are copied.
+  Weights weights(n, 0);
+  for (size_t i = 0; i < n; i++)
+    weights[uniform_sampler(random_number_generator)]++;
 
-void Bagging::buildBag() {
+  // The ensemble already keeps every core busy, so each tree is built serially.
+  TreeConfig config = config_;
+  config.parallelDepth = 0;
+  config.seed = random_number_generator();
+  DecisionTree tree(dr_, weights, config);
+
+  Rows outOfBag;
+  for (uint32_t row = 0; row < n; row++)
+    if (weights[row] == 0)
+      outOfBag.push_back(row);
+  const ColumnStore& store = dr_->trainColumns();
+  const auto predictions = Forest::fromNodes({&tree.root_}, store.schema()).predictBatch(store, outOfBag);
+  return Learner{std::move(tree), std::move(outOfBag), predictions};
+}
+
+void Bagging::buildBag(int first, int count) {
+  std::cout << "Start building " << count << " trees." << std::endl;
   cpu_timer timer;
-  std::vector<double> timings; 
-  for (int i = 0; i < ensembleSize_; i++) {
-		timer.start();
-		std::uniform_int_distribution<int> uniform_sampler(0, dr_.trainData().size() - 1);
-			std::vector<size_t> samples;
-			samples.reserve(dr_.trainData().size());
-			for (int i = 0; i < dr_.trainData().size(); i++) {
-				samples.emplace_back(std::move(uniform_sampler(random_number_generator)));
-			}
-			DecisionTree dt = DecisionTree(dr_, samples);
-    learners_.push_back(dt);
-    auto nanoseconds = boost::chrono::nanoseconds(timer.elapsed().wall);
-    auto seconds = boost::chrono::duration_cast<boost::chrono::seconds>(nanoseconds);
-    timings.push_back(seconds.count());
+  const Memory::Phase phase("bag");
+  // Trees like the ones built so far, plus the weights and scratch space of
+  // the learners that are built at the same time.
+  const size_t n = dr_->trainColumns().numRows();
+  const size_t concurrent = std::min<size_t>(count, ThreadPool::shared().size());
+  size_t perTree = 0;
+  if (!learners_.empty()) {
+    const auto usage = memoryUsage();
+    perTree = (usage.nodes + usage.leaves) / learners_.size();
+  }
+  Memory::checkBudget("building " + std::to_string(count) + " trees",
+                      count * perTree + concurrent * (n * sizeof(Weights::value_type)
+                                                      + DecisionTree::trainingEstimate(n)));
+  // The calling thread builds trees as well, so a bag can be built from a
+  // task running on the shared pool.
+  std::vector<std::optional<Learner>> built(count);
+  ThreadPool::shared().parallelFor(0, count, 1, [this, first, &built](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++)
+      built[i] = buildLearner(first + static_cast<int>(i));
+  });
+
+  const ColumnStore& store = dr_->trainColumns();
+  const size_t numClasses = store.numClasses();
+  outOfBagVotes_.resize(store.numRows() * numClasses, 0);
+  learners_.reserve(learners_.size() + count);
+  for (auto& learner: built) {
+    for (size_t i = 0; i < learner->outOfBag.size(); i++)
+      outOfBagVotes_[learner->outOfBag[i] * numClasses + learner->predictions[i]]++;
+    learners_.push_back(std::move(learner->tree));
   }
-  float avg_timing = Utils::iterators::average(std::begin(timings), std::begin(timings) + std::min(5, ensembleSize_));
-  std::cout << "Average timing: " << avg_timing << std::endl;
-}
-
-void Bagging::test() const {
-  TreeTest t;
-  float accuracy = 0;
-  for (const auto& row: dr_.testData()) {
-    static size_t last = row.size() - 1;
-    std::vector<std::string> decisions;
-    for (int i = 0; i < ensembleSize_; i++) {
-      const std::shared_ptr<Node> root = std::make_shared<Node>(learners_.at(i).root_);
-      const auto& classification = t.classify(row, root);
-      decisions.push_back(Utils::tree::getMax(classification));
-    }
-    std::string prediction = Utils::iterators::mostCommon(decisions.begin(), decisions.end());
-    if (prediction == row[last])
-      accuracy += 1;
+
+  outOfBag_ = Metrics(store.schema().classes());
+  for (size_t row = 0; row < store.numRows(); row++) {
+    const auto first = outOfBagVotes_.begin() + row * numClasses;
+    const auto best = std::max_element(first, first + numClasses);
+    if (*best > 0)
+      outOfBag_.add(store.labels()[row], static_cast<size_t>(best - first));
   }
-  std::cout << "Total accuracy: " << (accuracy / dr_.testData().size()) << std::endl;
+  std::cout << "Done. " << timer.format() << std::endl;
 }
 
+MemoryUsage Bagging::memoryUsage() const {
+  MemoryUsage usage;
+  usage.dataset = Memory::bytes(*dr_);
+  usage.scratch = Memory::scratchPeak();
+  for (const auto& learner: learners_)
+    usage.members.push_back(Memory::addTree(learner.root_, usage));
+  usage.other = outOfBagVotes_.capacity() * sizeof(uint32_t);
+  return usage;
+}
 
+Metrics Bagging::test() const {
+  return flatten().evaluate(dr_->testData());
+}
+
+PruneResult Bagging::prune(double alpha) {
+  PruneResult total;
+  for (auto& learner: learners_) {
+    const auto result = learner.pruneCostComplexity(alpha);
+    total.nodesBefore += result.nodesBefore;
+    total.nodesAfter += result.nodesAfter;
+  }
+  return total;
+}
+
+Forest Bagging::flatten() const {
+  std::vector<const Node*> roots;
+  for (const auto& learner: learners_)
+    roots.push_back(&learner.root_);
+  return Forest::fromNodes(roots, dr_->metaData(), seed_);
+}
+
+void Bagging::save(const std::string& filename) const {
+  ModelIO::save(flatten(), filename);
+}
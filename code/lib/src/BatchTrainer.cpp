@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include "BatchTrainer.hpp"
+#include "Memory.hpp"
+#include "Trace.hpp"
+
+using std::vector;
+
+namespace {
+
+  size_t jobRows(const TrainingJob& job) {
+    if (job.weights.empty())
+      return job.data->trainColumns().numRows();
+    return std::accumulate(job.weights.begin(), job.weights.end(), size_t{0});
+  }
+
+}
+
+BatchTrainer::BatchTrainer(ThreadPool& pool) : pool_(pool) {}
+
+BatchResult BatchTrainer::train(const vector<TrainingJob>& jobs) const {
+  TRACE_SPAN("train_batch", "jobs", static_cast<int64_t>(jobs.size()));
+  const Memory::Phase phase("train_batch");
+  const auto start = std::chrono::steady_clock::now();
+
+  vector<size_t> rows(jobs.size());
+  for (size_t j = 0; j < jobs.size(); j++) {
+    if (!jobs[j].data)
+      throw std::invalid_argument("Training job " + std::to_string(j) + " has no data set");
+    rows[j] = jobRows(jobs[j]);
+  }
+  // Largest first, so the last jobs to be claimed are the short ones.
+  vector<size_t> order(jobs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&rows](size_t a, size_t b) { return rows[a] > rows[b]; });
+  if (!jobs.empty()) {
+    const size_t largest = jobs[order.front()].data->trainColumns().numRows();
+    Memory::checkBudget("training " + std::to_string(jobs.size()) + " trees",
+                        std::min(jobs.size(), pool_.size() + 1) * DecisionTree::trainingEstimate(largest));
+  }
+
+  vector<std::optional<DecisionTree>> trees(jobs.size());
+  pool_.parallelFor(0, jobs.size(), 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      const TrainingJob& job = jobs[order[i]];
+      TreeConfig config = job.config;
+      config.parallelDepth = 0;
+      trees[order[i]].emplace(job.data, job.weights, config);
+    }
+  });
+
+  BatchResult result;
+  result.trees.reserve(jobs.size());
+  for (auto& tree: trees)
+    result.trees.push_back(std::move(*tree));
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return result;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "BinnedColumns.hpp"
+
+BinnedColumns::BinnedColumns(const ColumnStore& store, size_t maxBins) : numRows_(store.numRows()) {
+  maxBins = std::min(std::max<size_t>(maxBins, 1), BinnedColumns::maxBins);
+  const size_t numFeatures = store.numFeatures();
+  numeric_.resize(numFeatures);
+  bins_.assign(numFeatures, std::vector<uint8_t>(numRows_, 0));
+  thresholds_.resize(numFeatures);
+
+  for (size_t col = 0; col < numFeatures; col++) {
+    const auto& values = store.column(col);
+    auto& bins = bins_[col];
+    auto& thresholds = thresholds_[col];
+    numeric_[col] = store.isNumeric(col);
+    thresholds.push_back(std::nan(""));
+
+    if (!numeric_[col]) {
+      const size_t numCodes = std::min(store.schema().domains()[col].size(), maxBins);
+      for (size_t code = 0; code < numCodes; code++)
+        thresholds.push_back(code);
+      for (size_t r = 0; r < numRows_; r++)
+        bins[r] = binOf(col, values[r]);
+      continue;
+    }
+
+    // A column with no more distinct values than bins gets a bin per value,
+    // so splits on it are as exact as those of the learner.
+    std::vector<double> distinct;
+    for (size_t r = 0; r < numRows_ && distinct.size() <= maxBins; r++) {
+      const auto pos = std::lower_bound(distinct.begin(), distinct.end(), values[r]);
+      if (!std::isnan(values[r]) && (pos == distinct.end() || *pos != values[r]))
+        distinct.insert(pos, values[r]);
+    }
+    if (distinct.size() <= maxBins) {
+      thresholds.insert(thresholds.end(), distinct.begin(), distinct.end());
+      for (size_t r = 0; r < numRows_; r++)
+        bins[r] = binOf(col, values[r]);
+      continue;
+    }
+
+    const QuantileSketch& sketch = store.sketch(col);
+    if (sketch.empty())
+      continue;
+
+    // Lower bounds at evenly spaced quantiles, read from the sketch the store
+    // filled while it was loaded; a value that is repeated more than a bin's
+    // share takes a bin of its own.
+    for (const auto bound: sketch.boundaries(maxBins))
+      if (thresholds.size() == 1 || bound > thresholds.back())
+        thresholds.push_back(bound);
+    for (size_t r = 0; r < numRows_; r++)
+      bins[r] = binOf(col, values[r]);
+  }
+}
+
+uint8_t BinnedColumns::binOf(size_t col, double value) const {
+  const auto& thresholds = thresholds_[col];
+  if (std::isnan(value) || thresholds.size() < 2)
+    return 0;
+  if (!numeric_[col])
+    return value >= 0 && value < thresholds.size() - 1 ? static_cast<uint8_t>(value + 1) : 0;
+  // Values below the first bound, unseen when binning, go to the lowest bin.
+  const auto bin = std::upper_bound(thresholds.begin() + 1, thresholds.end(), value) - thresholds.begin() - 1;
+  return static_cast<uint8_t>(std::max<long>(bin, 1));
+}
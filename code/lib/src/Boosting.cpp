@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <boost/timer/timer.hpp>
+#include "Boosting.hpp"
+#include "Calculations.hpp"
+#include "Memory.hpp"
+#include "ThreadPool.hpp"
+
+using std::make_shared;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using boost::timer::cpu_timer;
+using Calculations::GradientSum;
+
+namespace {
+
+  // splits that gain less than this are numerical noise
+  constexpr double minGain = 1e-12;
+
+  /**
+   * Grows one regression tree on the gradients and hessians of one output
+   * and adds the output of every leaf to the training scores of its rows.
+   */
+  class TreeGrower {
+    public:
+      TreeGrower(const BinnedColumns& bins, const BoostingConfig& config,
+                 const vector<double>& gradients, const vector<double>& hessians,
+                 double* scores, size_t stride) :
+        bins_(bins), config_(config), gradients_(gradients), hessians_(hessians),
+        scores_(scores), stride_(stride), offsets_(), tree_() {
+        size_t offset = 0;
+        for (size_t col = 0; col < bins.numFeatures(); col++) {
+          offsets_.push_back(offset);
+          offset += bins.numBins(col);
+        }
+        offsets_.push_back(offset);
+      }
+
+      TreeGrower(const TreeGrower&) = delete;
+      TreeGrower& operator=(const TreeGrower&) = delete;
+
+      vector<FlatNode> grow(const Rows& rows) {
+        tree_.clear();
+        GradientSum total;
+        for (const auto row: rows)
+          total += GradientSum{gradients_[row], hessians_[row]};
+        vector<GradientSum> histogram;
+        if (config_.maxDepth > 0)
+          histogram = buildHistogram(rows);
+        grow(rows, histogram, total, 0);
+        return std::move(tree_);
+      }
+
+    private:
+      const BinnedColumns& bins_;
+      const BoostingConfig& config_;
+      const vector<double>& gradients_;
+      const vector<double>& hessians_;
+      double* scores_;
+      const size_t stride_;
+      vector<size_t> offsets_;       // start of every column in a histogram
+      vector<FlatNode> tree_;
+
+      vector<GradientSum> buildHistogram(const Rows& rows) const {
+        vector<GradientSum> histogram(offsets_.back());
+        const size_t numFeatures = bins_.numFeatures();
+        // Columns are independent; small nodes are not worth the hand-off.
+        const size_t grain = rows.size() < 4096 ? numFeatures : 1;
+        ThreadPool::shared().parallelFor(0, numFeatures, std::max<size_t>(grain, 1), [&](size_t begin, size_t end) {
+          for (size_t col = begin; col < end; col++)
+            Calculations::gradient_histogram(bins_, rows, gradients_, hessians_, col, histogram.data() + offsets_[col]);
+        });
+        return histogram;
+      }
+
+      void makeLeaf(const Rows& rows, const GradientSum& total, size_t index) {
+        const double value = -config_.learningRate * total.gradient / (total.hessian + config_.lambda);
+        tree_[index] = FlatNode{0, FlatNode::Leaf, value, 0, 0};
+        for (const auto row: rows)
+          scores_[row * stride_] += value;
+      }
+
+      void grow(const Rows& rows, const vector<GradientSum>& histogram, const GradientSum& total, int depth) {
+        const size_t index = tree_.size();
+        tree_.push_back(FlatNode{0, FlatNode::Leaf, 0.0, 0, 0});
+        if (depth >= config_.maxDepth || rows.size() < 2) {
+          makeLeaf(rows, total, index);
+          return;
+        }
+
+        // Ties go to the first column.
+        double bestGain = 0.0;
+        size_t bestCol = 0;
+        uint32_t bestBin = 0;
+        for (size_t col = 0; col < bins_.numFeatures(); col++) {
+          const auto [bin, gain] = Calculations::best_gradient_split(bins_, col, histogram.data() + offsets_[col],
+                                                                     total, config_.lambda, config_.minHessian);
+          if (gain > bestGain) {
+            bestGain = gain;
+            bestCol = col;
+            bestBin = bin;
+          }
+        }
+        if (!(bestGain > minGain)) {
+          makeLeaf(rows, total, index);
+          return;
+        }
+
+        const auto& column = bins_.bins(bestCol);
+        const bool numeric = bins_.isNumeric(bestCol);
+        Rows trueRows;
+        Rows falseRows;
+        GradientSum trueSum;
+        for (const auto row: rows) {
+          const bool goTrue = numeric ? column[row] >= bestBin : column[row] == bestBin;
+          if (goTrue) {
+            trueRows.push_back(row);
+            trueSum += GradientSum{gradients_[row], hessians_[row]};
+          } else {
+            falseRows.push_back(row);
+          }
+        }
+        const GradientSum falseSum = total - trueSum;
+
+        // Only the smaller child is counted, the other one is the difference.
+        vector<GradientSum> trueHistogram;
+        vector<GradientSum> falseHistogram;
+        if (depth + 1 < config_.maxDepth) {
+          const bool trueSmaller = trueRows.size() <= falseRows.size();
+          auto& small = trueSmaller ? trueHistogram : falseHistogram;
+          auto& large = trueSmaller ? falseHistogram : trueHistogram;
+          small = buildHistogram(trueSmaller ? trueRows : falseRows);
+          large.resize(histogram.size());
+          for (size_t i = 0; i < histogram.size(); i++)
+            large[i] = histogram[i] - small[i];
+        }
+
+        const uint32_t kind = numeric ? FlatNode::Numeric : FlatNode::Categorical;
+        FlatNode node{static_cast<uint32_t>(bestCol), kind, bins_.threshold(bestCol, bestBin), 0, 0};
+        node.left = static_cast<uint32_t>(tree_.size());
+        grow(trueRows, trueHistogram, trueSum, depth + 1);
+        node.right = static_cast<uint32_t>(tree_.size());
+        grow(falseRows, falseHistogram, falseSum, depth + 1);
+        tree_[index] = node;
+      }
+  };
+
+}
+
+Boosting::Boosting(const DataReader& dr, const BoostingConfig& config, const Data& validation) :
+  Boosting(make_shared<const DataReader>(dr), config, validation) {}
+
+Boosting::Boosting(shared_ptr<const DataReader> dr, const BoostingConfig& config, const Data& validation) :
+  Boosting(std::move(dr), Weights(), config, validation) {}
+
+Boosting::Boosting(shared_ptr<const DataReader> dr, const Weights& weights, const BoostingConfig& config,
+                   const Data& validation) :
+  dr_(std::move(dr)),
+  config_(config),
+  numOutputs_(1),
+  baseScores_(),
+  trees_(),
+  validationLoss_() {
+  boost(weights, validation);
+}
+
+double Boosting::output(const RegressionTree& tree, const double* x) {
+  return FlatTree{tree.data(), static_cast<uint32_t>(tree.size()), nullptr, 0}.leaf(x).value;
+}
+
+void Boosting::scores(const double* x, double* out) const {
+  std::copy(baseScores_.begin(), baseScores_.end(), out);
+  for (size_t t = 0; t < trees_.size(); t++)
+    out[t % numOutputs_] += output(trees_[t], x);
+}
+
+void Boosting::probabilities(const double* scores, double* out) const {
+  const size_t numClasses = schema().numClasses();
+  if (numOutputs_ == 1 && numClasses == 2) {
+    out[1] = 1.0 / (1.0 + std::exp(-scores[0]));
+    out[0] = 1.0 - out[1];
+    return;
+  }
+  const double highest = *std::max_element(scores, scores + numOutputs_);
+  double sum = 0.0;
+  for (size_t k = 0; k < numOutputs_; k++)
+    sum += out[k] = std::exp(scores[k] - highest);
+  for (size_t k = 0; k < numOutputs_; k++)
+    out[k] /= sum;
+}
+
+void Boosting::boost(const Weights& weights, const Data& validation) {
+  std::cout << "Start boosting " << config_.rounds << " rounds." << std::endl;
+  cpu_timer timer;
+  const Memory::Phase phase("boost");
+
+  const ColumnStore& store = dr_->trainColumns();
+  const Schema& schema = store.schema();
+  const size_t n = store.numRows();
+  if (!weights.empty() && weights.size() != n)
+    throw std::invalid_argument("Expected " + std::to_string(n) + " weights, got " + std::to_string(weights.size()));
+  const auto weight = [&weights](size_t r) { return weights.empty() ? 1.0 : static_cast<double>(weights[r]); };
+  const size_t numClasses = schema.numClasses();
+  const BinnedColumns bins(store, config_.maxBins);
+  const bool logistic = numClasses == 2;
+  numOutputs_ = logistic ? 1 : std::max<size_t>(numClasses, 1);
+
+  // Start from the log odds (logistic) or log priors (softmax) of the classes.
+  vector<double> prior(numClasses, 1.0);
+  double total = 0.0;
+  for (size_t r = 0; r < n; r++) {
+    prior[store.labels()[r]] += weight(r);
+    total += weight(r);
+  }
+  baseScores_.assign(numOutputs_, 0.0);
+  if (logistic)
+    baseScores_[0] = std::log(prior[1] / prior[0]);
+  else
+    for (size_t k = 0; k < numOutputs_ && k < numClasses; k++)
+      baseScores_[k] = std::log(prior[k] / (total + numClasses));
+
+  Rows rows;
+  for (size_t r = 0; r < n; r++)
+    if (weight(r) > 0)
+      rows.push_back(static_cast<uint32_t>(r));
+  vector<double> trainScores(n * numOutputs_);
+  for (size_t r = 0; r < n; r++)
+    std::copy(baseScores_.begin(), baseScores_.end(), trainScores.begin() + r * numOutputs_);
+
+  // The validation set is encoded once and scored incrementally.
+  const size_t numFeatures = schema.numFeatures();
+  vector<double> validationRows;
+  vector<uint32_t> validationLabels;
+  for (const auto& row: validation) {
+    const uint32_t label = schema.classCode(row.back());
+    if (label == Schema::npos)
+      continue;
+    validationRows.resize(validationRows.size() + numFeatures);
+    schema.encode(row, validationRows.data() + validationRows.size() - numFeatures);
+    validationLabels.push_back(label);
+  }
+  const size_t numValidation = validationLabels.size();
+  vector<double> validationScores(numValidation * numOutputs_);
+  for (size_t r = 0; r < numValidation; r++)
+    std::copy(baseScores_.begin(), baseScores_.end(), validationScores.begin() + r * numOutputs_);
+  const bool earlyStopping = config_.earlyStoppingRounds > 0 && numValidation > 0;
+  size_t bestRound = 0;
+
+  ThreadPool& pool = ThreadPool::shared();
+  const size_t grain = std::max<size_t>(1024, n / (4 * pool.size()) + 1);
+  vector<vector<double>> gradients(numOutputs_, vector<double>(n));
+  vector<vector<double>> hessians(numOutputs_, vector<double>(n));
+  for (size_t round = 0; round < static_cast<size_t>(std::max(config_.rounds, 0)); round++) {
+    Memory::checkBudget("boosting round " + std::to_string(round));
+    pool.parallelFor(0, n, grain, [&](size_t begin, size_t end) {
+      vector<double> p(std::max<size_t>(numClasses, 2));
+      for (size_t r = begin; r < end; r++) {
+        probabilities(trainScores.data() + r * numOutputs_, p.data());
+        for (size_t k = 0; k < numOutputs_; k++) {
+          // The logistic loss has a single output, the score of class 1.
+          const size_t c = logistic ? 1 : k;
+          const double pk = p[c];
+          const double target = store.labels()[r] == c;
+          gradients[k][r] = weight(r) * (pk - target);
+          hessians[k][r] = weight(r) * std::max(pk * (1.0 - pk), 1e-16);
+        }
+      }
+    });
+
+    for (size_t k = 0; k < numOutputs_; k++) {
+      TreeGrower grower(bins, config_, gradients[k], hessians[k], trainScores.data() + k, numOutputs_);
+      trees_.push_back(grower.grow(rows));
+      for (size_t r = 0; r < numValidation; r++)
+        validationScores[r * numOutputs_ + k] += output(trees_.back(), validationRows.data() + r * numFeatures);
+    }
+
+    if (numValidation == 0)
+      continue;
+    double loss = 0.0;
+    vector<double> p(std::max<size_t>(numClasses, 2));
+    for (size_t r = 0; r < numValidation; r++) {
+      probabilities(validationScores.data() + r * numOutputs_, p.data());
+      loss -= std::log(std::max(p[validationLabels[r]], 1e-15));
+    }
+    validationLoss_.push_back(loss / numValidation);
+    if (validationLoss_.back() < validationLoss_[bestRound])
+      bestRound = round;
+    if (earlyStopping && round - bestRound >= static_cast<size_t>(config_.earlyStoppingRounds)) {
+      trees_.resize((bestRound + 1) * numOutputs_);
+      break;
+    }
+  }
+  std::cout << "Done after " << rounds() << " rounds. " << timer.format() << std::endl;
+}
+
+vector<uint32_t> Boosting::predictBatch(const Data& rows) const {
+  vector<uint32_t> predictions(rows.size());
+  const Schema& schema = this->schema();
+  ThreadPool& pool = ThreadPool::shared();
+  const size_t grain = std::max<size_t>(512, rows.size() / (4 * pool.size()) + 1);
+
+  pool.parallelFor(0, rows.size(), grain, [&](size_t begin, size_t end) {
+    vector<double> x(schema.numFeatures());
+    vector<double> s(numOutputs_);
+    vector<double> p(std::max<size_t>(schema.numClasses(), 2));
+    for (size_t r = begin; r < end; r++) {
+      schema.encode(rows[r], x.data());
+      scores(x.data(), s.data());
+      probabilities(s.data(), p.data());
+      predictions[r] = static_cast<uint32_t>(std::max_element(p.begin(), p.begin() + schema.numClasses()) - p.begin());
+    }
+  });
+  return predictions;
+}
+
+string Boosting::predict(const VecS& row) const {
+  return schema().classes()[predictBatch(Data{row}).front()];
+}
+
+Metrics Boosting::test() const {
+  const Data& testData = dr_->testData();
+  const auto predictions = predictBatch(testData);
+  Metrics metrics(schema().classes());
+  for (size_t r = 0; r < testData.size(); r++)
+    metrics.add(testData[r].back(), schema().classes()[predictions[r]]);
+  return metrics;
+}
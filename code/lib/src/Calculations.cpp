@@ -5,10 +5,16 @@
  */
 
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <algorithm>
 #include <iterator>
+#include <limits>
+#include <numeric>
 #include <omp.h>
 #include "Calculations.hpp"
+#include "Memory.hpp"
+#include "Trace.hpp"
 #include "Utils.hpp"
 
 using std::tuple;
@@ -42,7 +48,7 @@ void Calculations::partition(const Data &data, const Question &q, Data &trueData
     }
 }
 
-tuple<const double, const Question> Calculations::find_best_split(const Data& rows, const MetaData& meta) {
+tuple<const double, const Question> Calculations::find_best_split(const Data& rows, const MetaData& meta, bool parallel) {
   double bestGain = 0.0;  // keep track of the best information gain
   auto bestQuestion = Question();  //keep track of the feature / value that produced it
   //std::cout << "Whoop whoop INIT" << std::endl;
@@ -50,7 +56,7 @@ tuple<const double, const Question> Calculations::find_best_split(const Data& ro
   //const float current_uncertainty = gini(overall_counts, rows.size());
 	size_t n_features = rows.back().size() - 1;  //number of columns
 	
-	#pragma omp parallel for num_threads(5)
+	#pragma omp parallel for num_threads(5) if(parallel)
 	for (size_t column = 0; column < n_features; column++) {
 		std::string colType = meta.columnTypes[column];
 		
@@ -62,7 +68,6 @@ tuple<const double, const Question> Calculations::find_best_split(const Data& ro
 		//ClassCounter candidateTrueCounts = overall_counts;
 		//ClassCounter candidateFalseCounts = overall_counts;
 		//tuple<std::string, double> bestThreshAndLoss;
-		std::cout << "Here I go" << std::endl;
 		if (colType.compare("categorical") == 0) {
 			auto[candidateThresh, candidateGain] = determine_best_threshold_cat(rows, column);
 			//if (candidateTrueSize == 0 || candidateFalseSize == 0)
@@ -73,7 +78,6 @@ tuple<const double, const Question> Calculations::find_best_split(const Data& ro
 			#pragma omp critical
 			{
 				if (candidateGain >= bestGain) {
-					std::cout << "Here I go killing again" << std::endl;
 					const Question q(column, candidateThresh);
 					bestGain = candidateGain;
 					bestQuestion = q;
@@ -90,7 +94,6 @@ tuple<const double, const Question> Calculations::find_best_split(const Data& ro
 			#pragma omp critical
 			{
 				if (candidateGain >= bestGain) {
-					std::cout << "Here I go killing again" << std::endl;
 					const Question q(column, candidateThresh);
 					bestGain = candidateGain;
 					bestQuestion = q;
@@ -141,8 +144,8 @@ std::tuple<std::string, double> Calculations::determine_best_threshold_numeric(c
   }
 	
 	//tracker variables 
-	double bestTrueSize;
-	double bestFalseSize;
+	double bestTrueSize = 0;
+	double bestFalseSize = 0;
 	ClassCounter bestTrueCounts;
 	ClassCounter bestFalseCounts;
 	std::string currentFeatureValue = sortedData.front().at(0);
@@ -162,7 +165,8 @@ std::tuple<std::string, double> Calculations::determine_best_threshold_numeric(c
 
 			if (currentGini < bestLoss) {
 					bestLoss = currentGini;
-					bestThresh = row.at(0);
+					// rows seen so far are >= the current value, so that is the threshold
+					bestThresh = currentFeatureValue;
 					bestTrueSize = totalTrue;
 					bestFalseSize = (totalSize-totalTrue);
 					bestTrueCounts = incrementalTrueClassCounts;
@@ -174,12 +178,15 @@ std::tuple<std::string, double> Calculations::determine_best_threshold_numeric(c
 			// then add to the class counter where relevant
 			incrementalTrueClassCounts.at(row.back())++;
 			incrementalFalseClassCounts.at(row.back())--;	
+			totalTrue += 1;
 
 			// update the current feature value being tracked against
 			currentFeatureValue = row.at(0);
         }
   }
 	//std::cout << "Whoop whoop6" << std::endl;	
+  if (bestThresh.empty())
+    return forward_as_tuple(bestThresh, 0.0);
   const float p = static_cast<float>(bestTrueSize) / (bestTrueSize + bestFalseSize);
   bestLoss = current_uncertainty - p * gini(bestTrueCounts, bestTrueSize) - (1 - p) * gini(bestFalseCounts, bestFalseSize);
 
@@ -247,8 +254,8 @@ std::tuple<std::string, double> Calculations::determine_best_threshold_cat(const
 		incrementalFalseClassCounts[decision] = freq;
 	}
 	//tracker variables 
-	double bestTrueSize;
-	double bestFalseSize;
+	double bestTrueSize = 0;
+	double bestFalseSize = 0;
 	ClassCounter bestTrueCounts;
 	ClassCounter bestFalseCounts;
 	#pragma omp parallel for reduction(reduce_classcounter:incrementalCategoryCounts) reduction(reduce_classcatcounter:incrementalTrueClassCountsPerCategory, incrementalFalseClassCountsPerCategory)
@@ -299,6 +306,8 @@ std::tuple<std::string, double> Calculations::determine_best_threshold_cat(const
 		}
 	}
 	//std::cout << "Whoop whoop5" << std::endl;
+  if (bestFalseSize == 0)
+    return forward_as_tuple(bestThresh, 0.0);
   const float p = static_cast<float>(bestTrueSize) / (bestTrueSize + bestFalseSize);
   bestLoss = current_uncertainty - p * gini(bestTrueCounts, bestTrueSize) - (1 - p) * gini(bestFalseCounts, bestFalseSize);
 
@@ -339,12 +348,336 @@ const Data Calculations::sort_numeric_data(const Data &data, int col) {
 
 /**
  * Comparator assuming that the index of a vector (first element) is the sort index
- * Comparator assumes comparison of ordinal/numeric data points. Uses std::stoi to convert to integer values.
+ * Comparator assumes comparison of ordinal/numeric data points. Uses std::stod to convert to floating point values.
  *
  * @param row1: vector row to compare with row2
  * @param row2: vector row to compare with row1
  */
 bool Calculations::comparator(VecS &row1, VecS &row2) {
-    return std::stoi(row1.front()) > std::stoi(row2.front());
+    return std::stod(row1.front()) > std::stod(row2.front());
+}
+
+
+ClassHistogram Calculations::classCounts(const ColumnStore& store, const Rows& rows, const Weights& weights) {
+  ClassHistogram counts(store.numClasses(), 0.0);
+  const auto& labels = store.labels();
+  for (const auto row: rows)
+    counts[labels[row]] += weight(weights, row);
+  return counts;
+}
+
+double Calculations::gini(const ClassHistogram& counts, double N) {
+  if (N <= 0)
+    return 0.0;
+  double impurity = 1.0;
+  for (const auto freq: counts) {
+    const double prob_of_lbl = freq / N;
+    impurity -= prob_of_lbl * prob_of_lbl;
+  }
+  return impurity;
 }
 
+namespace {
+
+  double total(const ClassHistogram& counts) {
+    return std::accumulate(counts.begin(), counts.end(), 0.0);
+  }
+
+  /**
+   * Information gain of splitting `parent` into `trueCounts` and the rest.
+   */
+  double splitGain(const ClassHistogram& parent, double parentSize, double parentGini,
+                   const ClassHistogram& trueCounts, double trueSize, ClassHistogram& scratch) {
+    const double falseSize = parentSize - trueSize;
+    if (trueSize <= 0 || falseSize <= 0)
+      return 0.0;
+    for (size_t c = 0; c < parent.size(); c++)
+      scratch[c] = parent[c] - trueCounts[c];
+    const double p = trueSize / parentSize;
+    return parentGini - p * Calculations::gini(trueCounts, trueSize) - (1 - p) * Calculations::gini(scratch, falseSize);
+  }
+
+  // Entries of the per-thread sort buffer kept between calls, 1 MB.
+  constexpr size_t maxRetainedSortBuffer = (1 << 20) / sizeof(std::pair<double, uint32_t>);
+
+}
+
+tuple<double, double> Calculations::determine_best_threshold_numeric(const ColumnStore& store, const Rows& rows,
+                                                                     const Weights& weights, size_t col,
+                                                                     double minLeaf) {
+  const auto& values = store.column(col);
+  const auto& labels = store.labels();
+
+  // Missing values never pass a threshold test, so they stay on the false side.
+  // The buffer is kept per thread and reused by every node and every tree the
+  // thread builds, so a worker that trains many small trees allocates it once.
+  thread_local vector<std::pair<double, uint32_t>> sorted;
+  sorted.clear();
+  sorted.reserve(rows.size());
+  const Memory::Scratch sortedBytes(rows.size() * sizeof(sorted[0]));
+  for (const auto row: rows)
+    if (!std::isnan(values[row]))
+      sorted.emplace_back(values[row], row);
+  std::sort(sorted.begin(), sorted.end());
+
+  const ClassHistogram parent = classCounts(store, rows, weights);
+  const double parentSize = total(parent);
+  const double parentGini = gini(parent, parentSize);
+
+  // Walk from the largest value down, growing the true side (x >= value).
+  ClassHistogram trueCounts(parent.size(), 0.0);
+  ClassHistogram scratch(parent.size(), 0.0);
+  double trueSize = 0;
+  double bestGain = 0.0;
+  double bestThreshold = 0.0;
+  for (size_t i = sorted.size(); i-- > 0;) {
+    const double w = weight(weights, sorted[i].second);
+    trueCounts[labels[sorted[i].second]] += w;
+    trueSize += w;
+    if (i > 0 && sorted[i - 1].first == sorted[i].first)
+      continue;
+    // The false side only shrinks from here on.
+    if (parentSize - trueSize < minLeaf)
+      break;
+    if (trueSize < minLeaf)
+      continue;
+    const double gain = splitGain(parent, parentSize, parentGini, trueCounts, trueSize, scratch);
+    if (gain > bestGain) {
+      bestGain = gain;
+      bestThreshold = sorted[i].first;
+    }
+  }
+  // Large buffers are only needed near the root of large trees.
+  if (sorted.capacity() > maxRetainedSortBuffer)
+    vector<std::pair<double, uint32_t>>().swap(sorted);
+  return std::make_tuple(bestThreshold, bestGain);
+}
+
+tuple<double, double> Calculations::random_threshold_numeric(const ColumnStore& store, const Rows& rows,
+                                                             const Weights& weights, size_t col, double draw,
+                                                             double minLeaf) {
+  const auto& values = store.column(col);
+  double lowest = std::numeric_limits<double>::infinity();
+  double highest = -std::numeric_limits<double>::infinity();
+  for (const auto row: rows) {
+    if (std::isnan(values[row]))
+      continue;
+    lowest = std::min(lowest, values[row]);
+    highest = std::max(highest, values[row]);
+  }
+  if (!(lowest < highest))
+    return std::make_tuple(0.0, 0.0);
+
+  // A threshold in (lowest, highest] leaves rows on both sides.
+  double threshold = highest - draw * (highest - lowest);
+  if (threshold <= lowest)
+    threshold = highest;
+
+  const auto& labels = store.labels();
+  ClassHistogram parent(store.numClasses(), 0.0);
+  ClassHistogram trueCounts(store.numClasses(), 0.0);
+  ClassHistogram scratch(store.numClasses(), 0.0);
+  double trueSize = 0;
+  for (const auto row: rows) {
+    const double w = weight(weights, row);
+    parent[labels[row]] += w;
+    if (values[row] >= threshold) {
+      trueCounts[labels[row]] += w;
+      trueSize += w;
+    }
+  }
+  const double parentSize = total(parent);
+  if (trueSize < minLeaf || parentSize - trueSize < minLeaf)
+    return std::make_tuple(threshold, 0.0);
+  const double gain = splitGain(parent, parentSize, gini(parent, parentSize), trueCounts, trueSize, scratch);
+  return std::make_tuple(threshold, gain);
+}
+
+tuple<uint32_t, double> Calculations::determine_best_threshold_cat(const ColumnStore& store, const Rows& rows,
+                                                                   const Weights& weights, size_t col,
+                                                                   double minLeaf) {
+  const auto& values = store.column(col);
+  const auto& labels = store.labels();
+  const size_t numClasses = store.numClasses();
+  const size_t numValues = store.schema().domains()[col].size();
+
+  ClassHistogram parent(numClasses, 0.0);
+  vector<double> perValue(numValues * numClasses, 0.0);
+  vector<double> valueSize(numValues, 0.0);
+  const Memory::Scratch countsBytes((perValue.size() + valueSize.size()) * sizeof(double));
+  for (const auto row: rows) {
+    const double w = weight(weights, row);
+    parent[labels[row]] += w;
+    if (std::isnan(values[row]))
+      continue;
+    const auto code = static_cast<size_t>(values[row]);
+    perValue[code * numClasses + labels[row]] += w;
+    valueSize[code] += w;
+  }
+  const double parentSize = total(parent);
+  const double parentGini = gini(parent, parentSize);
+
+  ClassHistogram trueCounts(numClasses);
+  ClassHistogram scratch(numClasses);
+  double bestGain = 0.0;
+  uint32_t bestCode = 0;
+  for (size_t code = 0; code < numValues; code++) {
+    if (valueSize[code] <= 0 || valueSize[code] < minLeaf || parentSize - valueSize[code] < minLeaf)
+      continue;
+    std::copy_n(perValue.begin() + code * numClasses, numClasses, trueCounts.begin());
+    const double gain = splitGain(parent, parentSize, parentGini, trueCounts, valueSize[code], scratch);
+    if (gain > bestGain) {
+      bestGain = gain;
+      bestCode = static_cast<uint32_t>(code);
+    }
+  }
+  return std::make_tuple(bestCode, bestGain);
+}
+
+tuple<const double, const Question> Calculations::find_best_split(const ColumnStore& store, const Rows& rows,
+                                                                  const Weights& weights, bool parallel,
+                                                                  double minLeaf) {
+  vector<uint32_t> columns(store.numFeatures());
+  std::iota(columns.begin(), columns.end(), 0);
+  return find_best_split(store, rows, weights, columns, vector<double>(), parallel, minLeaf);
+}
+
+tuple<const double, const Question> Calculations::find_best_split(const ColumnStore& store, const Rows& rows,
+                                                                  const Weights& weights,
+                                                                  const vector<uint32_t>& columns,
+                                                                  const vector<double>& draws, bool parallel,
+                                                                  double minLeaf) {
+  TRACE_SPAN("find_best_split", "rows", static_cast<int64_t>(rows.size()));
+  const auto numColumns = static_cast<long>(columns.size());
+  vector<double> gains(numColumns, 0.0);
+  vector<double> thresholds(numColumns, 0.0);
+
+  #pragma omp parallel for schedule(dynamic) if(parallel)
+  for (long i = 0; i < numColumns; i++) {
+    const size_t col = columns[i];
+    if (store.isNumeric(col) && !draws.empty()) {
+      std::tie(thresholds[i], gains[i]) = random_threshold_numeric(store, rows, weights, col, draws[i], minLeaf);
+    } else if (store.isNumeric(col)) {
+      std::tie(thresholds[i], gains[i]) = determine_best_threshold_numeric(store, rows, weights, col, minLeaf);
+    } else {
+      const auto [code, gain] = determine_best_threshold_cat(store, rows, weights, col, minLeaf);
+      thresholds[i] = code;
+      gains[i] = gain;
+    }
+  }
+
+  // Ties go to the first column, whatever the order columns finished in.
+  const auto best = std::max_element(gains.begin(), gains.end()) - gains.begin();
+  if (numColumns == 0 || gains[best] <= 0.0)
+    return forward_as_tuple(0.0, Question());
+
+  const auto col = static_cast<int>(columns[best]);
+  if (store.isNumeric(col))
+    return std::make_tuple(gains[best], Question(col, thresholds[best]));
+  const auto& value = store.schema().domains()[col][static_cast<size_t>(thresholds[best])];
+  return std::make_tuple(gains[best], Question(col, value, false));
+}
+
+void Calculations::partition(const ColumnStore& store, const Rows& rows, const Question& q, Rows& trueRows, Rows& falseRows) {
+  TRACE_SPAN("partition", "rows", static_cast<int64_t>(rows.size()));
+  const auto& values = store.column(q.column_);
+  if (q.numeric_) {
+    for (const auto row: rows)
+      (values[row] >= q.threshold_ ? trueRows : falseRows).push_back(row);
+  } else {
+    const double code = store.schema().code(q.column_, q.value_);
+    for (const auto row: rows)
+      (values[row] == code ? trueRows : falseRows).push_back(row);
+  }
+}
+
+tuple<uint32_t, double> Calculations::best_histogram_split(const double* histogram, size_t numBins, bool numeric,
+                                                           const ClassHistogram& parent, double minLeaf) {
+  const size_t numClasses = parent.size();
+  const double parentSize = total(parent);
+  const double parentGini = gini(parent, parentSize);
+
+  ClassHistogram trueCounts(numClasses, 0.0);
+  ClassHistogram scratch(numClasses, 0.0);
+  double bestGain = 0.0;
+  uint32_t bestBin = 0;
+  for (size_t bin = numBins; bin-- > 1;) {
+    // Numeric columns accumulate from the highest bin down (x >= threshold).
+    // An empty bin gives no new split; deep nodes have mostly empty bins.
+    double binSize = 0.0;
+    for (size_t k = 0; k < numClasses; k++)
+      binSize += histogram[k * numBins + bin];
+    if (binSize <= 0)
+      continue;
+    if (!numeric)
+      std::fill(trueCounts.begin(), trueCounts.end(), 0.0);
+    for (size_t k = 0; k < numClasses; k++)
+      trueCounts[k] += histogram[k * numBins + bin];
+    const double trueSize = total(trueCounts);
+    if (trueSize < minLeaf || parentSize - trueSize < minLeaf)
+      continue;
+    const double gain = splitGain(parent, parentSize, parentGini, trueCounts, trueSize, scratch);
+    if (gain > bestGain) {
+      bestGain = gain;
+      bestBin = static_cast<uint32_t>(bin);
+    }
+  }
+  return std::make_tuple(bestBin, bestGain);
+}
+
+ClassCounter Calculations::toClassCounter(const ClassHistogram& counts, const Schema& schema) {
+  ClassCounter counter;
+  for (size_t c = 0; c < counts.size(); c++)
+    if (counts[c] > 0)
+      counter[schema.classes()[c]] = static_cast<int>(std::lround(counts[c]));
+  return counter;
+}
+
+void Calculations::gradient_histogram(const BinnedColumns& bins, const Rows& rows, const vector<double>& gradients,
+                                      const vector<double>& hessians, size_t col, GradientSum* histogram) {
+  const auto& column = bins.bins(col);
+  for (const auto row: rows) {
+    GradientSum& sum = histogram[column[row]];
+    sum.gradient += gradients[row];
+    sum.hessian += hessians[row];
+  }
+}
+
+namespace {
+
+  inline double leafScore(const Calculations::GradientSum& sum, double lambda) {
+    return sum.gradient * sum.gradient / (sum.hessian + lambda);
+  }
+
+}
+
+tuple<uint32_t, double> Calculations::best_gradient_split(const BinnedColumns& bins, size_t col,
+                                                          const GradientSum* histogram, const GradientSum& total,
+                                                          double lambda, double minHessian) {
+  const double parentScore = leafScore(total, lambda);
+  double bestGain = 0.0;
+  uint32_t bestBin = 0;
+  auto consider = [&](const GradientSum& trueSum, size_t bin) {
+    const GradientSum falseSum = total - trueSum;
+    if (trueSum.hessian < minHessian || falseSum.hessian < minHessian)
+      return;
+    const double gain = 0.5 * (leafScore(trueSum, lambda) + leafScore(falseSum, lambda) - parentScore);
+    if (gain > bestGain) {
+      bestGain = gain;
+      bestBin = static_cast<uint32_t>(bin);
+    }
+  };
+
+  if (bins.isNumeric(col)) {
+    // Walk from the highest bin down, growing the true side (x >= threshold).
+    GradientSum trueSum;
+    for (size_t bin = bins.numBins(col); bin-- > 1;) {
+      trueSum += histogram[bin];
+      consider(trueSum, bin);
+    }
+  } else {
+    for (size_t bin = 1; bin < bins.numBins(col); bin++)
+      consider(histogram[bin], bin);
+  }
+  return std::make_tuple(bestBin, bestGain);
+}
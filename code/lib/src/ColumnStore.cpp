@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include "ColumnStore.hpp"
+
+ColumnStore::ColumnStore(const Data& data, const MetaData& meta) : ColumnStore(meta) {
+  append(data);
+}
+
+ColumnStore::ColumnStore(const MetaData& meta) :
+  schema_(meta), columns_(schema_.numFeatures()), labels_(), sketches_() {
+  for (size_t col = 0; col < schema_.numFeatures(); col++)
+    sketches_.emplace_back(isNumeric(col) ? sketchK : 2, col);
+}
+
+void ColumnStore::append(const Data& rows) {
+  const size_t numFeatures = schema_.numFeatures();
+  for (size_t col = 0; col < numFeatures; col++) {
+    if (isNumeric(col))
+      continue;
+    for (const auto& row: rows)
+      schema_.addCode(col, row[col]);
+  }
+
+  const size_t first = labels_.size();
+  for (auto& column: columns_)
+    column.resize(first + rows.size());
+  std::vector<double> encoded(numFeatures);
+  for (size_t r = 0; r < rows.size(); r++) {
+    schema_.encode(rows[r], encoded.data());
+    for (size_t col = 0; col < numFeatures; col++) {
+      columns_[col][first + r] = encoded[col];
+      if (isNumeric(col))
+        sketches_[col].add(encoded[col]);
+    }
+    labels_.push_back(schema_.addClass(rows[r].back()));
+  }
+}
@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+#include "CompactForest.hpp"
+#include "ThreadPool.hpp"
+
+using std::string;
+using std::vector;
+
+namespace {
+
+  struct NodeKey {
+    uint64_t children;
+    uint32_t test;
+
+    bool operator==(const NodeKey& other) const { return children == other.children && test == other.test; }
+  };
+
+  struct NodeKeyHash {
+    size_t operator()(const NodeKey& key) const {
+      uint64_t h = key.children * 0x9E3779B97F4A7C15ull ^ key.test;
+      h ^= h >> 29;
+      return static_cast<size_t>(h * 0xBF58476D1CE4E5B9ull);
+    }
+  };
+
+  struct DistributionHash {
+    size_t operator()(const vector<uint16_t>& distribution) const {
+      uint64_t h = 0xCBF29CE484222325ull;
+      for (const auto p: distribution)
+        h = (h ^ p) * 0x100000001B3ull;
+      return static_cast<size_t>(h);
+    }
+  };
+
+  /** Index of the entry of a sorted codebook that is closest to `value`. */
+  size_t nearest(const vector<double>& codebook, double value) {
+    const size_t i = std::lower_bound(codebook.begin(), codebook.end(), value) - codebook.begin();
+    if (i == codebook.size() || (i > 0 && value - codebook[i - 1] < codebook[i] - value))
+      return i - 1;
+    return i;
+  }
+
+  /** Builds the shared node pool, storing every distinct subtree once. */
+  class Interner {
+    public:
+      Interner(const Schema& schema, const vector<vector<double>>& codebooks, vector<CompactNode>& nodes,
+               vector<uint16_t>& distributions) :
+        schema_(schema), codebooks_(codebooks), nodes_(nodes),
+        distributions_(distributions), nodeIndex_(), distributionIndex_(), distributionError_(0.0) {}
+
+      uint32_t intern(const FlatTree& tree, uint32_t index) {
+        const FlatNode& node = tree.nodes[index];
+        if (node.kind == FlatNode::Leaf) {
+          const uint32_t offset = distribution(tree.leafCounts + node.left);
+          return add(CompactNode{offset, 0, CompactNode::leafFeature, static_cast<uint16_t>(node.right)});
+        }
+        const uint32_t left = intern(tree, node.left);
+        const uint32_t right = intern(tree, node.right);
+        // Both answers lead to the same subtree, so the test is redundant.
+        if (left == right)
+          return left;
+        CompactNode compact{left, right, static_cast<uint16_t>(node.feature), 0};
+        if (node.kind == FlatNode::Categorical) {
+          compact.feature |= CompactNode::categoricalBit;
+          compact.value = static_cast<uint16_t>(node.value);
+        } else {
+          compact.value = static_cast<uint16_t>(nearest(codebooks_[node.feature], node.value));
+        }
+        return add(compact);
+      }
+
+      inline double distributionError() const { return distributionError_; }
+
+    private:
+      const Schema& schema_;
+      const vector<vector<double>>& codebooks_;
+      vector<CompactNode>& nodes_;
+      vector<uint16_t>& distributions_;
+      std::unordered_map<NodeKey, uint32_t, NodeKeyHash> nodeIndex_;
+      std::unordered_map<vector<uint16_t>, uint32_t, DistributionHash> distributionIndex_;
+      double distributionError_;
+
+      uint32_t distribution(const uint32_t* counts) {
+        const size_t numClasses = schema_.numClasses();
+        const double total = std::accumulate(counts, counts + numClasses, 0.0);
+        vector<uint16_t> quantized(numClasses, 0);
+        for (size_t c = 0; c < numClasses && total > 0; c++) {
+          const double p = counts[c] / total;
+          quantized[c] = static_cast<uint16_t>(std::lround(p * CompactForest::distributionScale));
+          distributionError_ = std::max(distributionError_,
+                                        std::fabs(quantized[c] / CompactForest::distributionScale - p));
+        }
+        const auto [it, added] = distributionIndex_.emplace(std::move(quantized),
+                                                            static_cast<uint32_t>(distributions_.size()));
+        if (added)
+          distributions_.insert(distributions_.end(), it->first.begin(), it->first.end());
+        return it->second;
+      }
+
+      uint32_t add(const CompactNode& node) {
+        const NodeKey key{(uint64_t(node.left) << 32) | node.right, (uint32_t(node.feature) << 16) | node.value};
+        const auto [it, added] = nodeIndex_.emplace(key, static_cast<uint32_t>(nodes_.size()));
+        if (added)
+          nodes_.push_back(node);
+        return it->second;
+      }
+  };
+
+}
+
+CompactForest::CompactForest(const Forest& forest, size_t maxThresholds) :
+  schema_(forest.schema()),
+  codebooks_(schema_.numFeatures()),
+  roots_(),
+  nodes_(),
+  distributions_(),
+  seed_(forest.seed()),
+  thresholdError_(0.0),
+  distributionError_(0.0) {
+  if (schema_.numFeatures() >= CompactNode::categoricalBit || schema_.numClasses() > 0xFFFF)
+    throw std::invalid_argument("Too many features or classes for a compact forest");
+  for (const auto& domain: schema_.domains())
+    if (domain.size() > 0xFFFF)
+      throw std::invalid_argument("Too many categories for a compact forest");
+  maxThresholds = std::min(std::max<size_t>(maxThresholds, 1), CompactForest::maxThresholds);
+
+  vector<vector<double>> thresholds(schema_.numFeatures());
+  for (const auto& tree: forest.trees())
+    for (uint32_t i = 0; i < tree.numNodes; i++)
+      if (tree.nodes[i].kind == FlatNode::Numeric)
+        thresholds[tree.nodes[i].feature].push_back(tree.nodes[i].value);
+
+  for (size_t col = 0; col < thresholds.size(); col++) {
+    auto& values = thresholds[col];
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    auto& codebook = codebooks_[col];
+    if (values.size() <= maxThresholds) {
+      codebook = values;
+      continue;
+    }
+    // Keep evenly spaced entries of the sorted thresholds and move every
+    // threshold to the closest one that was kept.
+    for (size_t i = 0; i < maxThresholds; i++)
+      codebook.push_back(values[i * values.size() / maxThresholds]);
+    for (const auto value: values)
+      thresholdError_ = std::max(thresholdError_, std::fabs(codebook[nearest(codebook, value)] - value));
+  }
+
+  Interner interner(schema_, codebooks_, nodes_, distributions_);
+  for (const auto& tree: forest.trees())
+    roots_.push_back(interner.intern(tree, 0));
+  distributionError_ = interner.distributionError();
+}
+
+CompactForest::CompactForest(Schema schema, vector<vector<double>> codebooks, vector<uint32_t> roots,
+                             vector<CompactNode> nodes, vector<uint16_t> distributions, uint64_t seed,
+                             double thresholdError, double distributionError) :
+  schema_(std::move(schema)),
+  codebooks_(std::move(codebooks)),
+  roots_(std::move(roots)),
+  nodes_(std::move(nodes)),
+  distributions_(std::move(distributions)),
+  seed_(seed),
+  thresholdError_(thresholdError),
+  distributionError_(distributionError) {}
+
+void CompactForest::encode(const double* x, uint32_t* ranks) const {
+  for (size_t col = 0; col < schema_.numFeatures(); col++) {
+    if (std::isnan(x[col])) {
+      // Fails every test: no rank exceeds a threshold index, no code matches.
+      ranks[col] = schema_.types()[col] == Schema::ColumnType::Categorical ? Schema::npos : 0;
+    } else if (schema_.types()[col] == Schema::ColumnType::Categorical) {
+      ranks[col] = static_cast<uint32_t>(x[col]);
+    } else {
+      // x >= codebook[k] holds exactly when more than k entries are <= x.
+      const auto& codebook = codebooks_[col];
+      ranks[col] = static_cast<uint32_t>(std::upper_bound(codebook.begin(), codebook.end(), x[col])
+                                         - codebook.begin());
+    }
+  }
+}
+
+void CompactForest::predictRanks(const uint32_t* ranks, size_t n, uint32_t* predictions) const {
+  const size_t numFeatures = schema_.numFeatures();
+  const size_t numClasses = schema_.numClasses();
+  // Tree-major with early exit after every group of trees, as in Forest.
+  vector<uint32_t> votes(n * numClasses, 0);
+  vector<uint32_t> active(n);
+  std::iota(active.begin(), active.end(), 0);
+  for (size_t first = 0; first < roots_.size() && !active.empty(); first += earlyExitGroup) {
+    const size_t last = std::min(first + earlyExitGroup, roots_.size());
+    for (size_t t = first; t < last; t++) {
+      for (const auto r: active) {
+        const uint32_t* row = ranks + r * numFeatures;
+        const CompactNode* node = &nodes_[roots_[t]];
+        while (!node->isLeaf()) {
+          const uint32_t rank = row[node->feature & ~CompactNode::categoricalBit];
+          const bool goTrue = node->feature & CompactNode::categoricalBit ? rank == node->value : rank > node->value;
+          node = &nodes_[goTrue ? node->left : node->right];
+        }
+        votes[r * numClasses + node->value]++;
+      }
+    }
+    if (last == roots_.size())
+      break;
+    active.erase(std::remove_if(active.begin(), active.end(), [&](uint32_t r) {
+      return Forest::decided(votes.data() + r * numClasses, numClasses, roots_.size() - last);
+    }), active.end());
+  }
+  for (size_t r = 0; r < n; r++) {
+    const auto first = votes.begin() + r * numClasses;
+    predictions[r] = static_cast<uint32_t>(std::max_element(first, first + numClasses) - first);
+  }
+}
+
+uint32_t CompactForest::predict(const double* x) const {
+  vector<uint32_t> ranks(schema_.numFeatures());
+  encode(x, ranks.data());
+  uint32_t prediction = 0;
+  predictRanks(ranks.data(), 1, &prediction);
+  return prediction;
+}
+
+string CompactForest::predict(const VecS& row) const {
+  vector<double> x(schema_.numFeatures());
+  schema_.encode(row, x.data());
+  return schema_.classes()[predict(x.data())];
+}
+
+vector<uint32_t> CompactForest::predictBatch(const Data& rows) const {
+  vector<uint32_t> predictions(rows.size());
+  const size_t numFeatures = schema_.numFeatures();
+  ThreadPool& pool = ThreadPool::shared();
+  const size_t grain = std::max<size_t>(512, rows.size() / (4 * pool.size()) + 1);
+
+  pool.parallelFor(0, rows.size(), grain, [&](size_t begin, size_t end) {
+    vector<double> x(numFeatures);
+    vector<uint32_t> ranks((end - begin) * numFeatures);
+    for (size_t r = begin; r < end; r++) {
+      schema_.encode(rows[r], x.data());
+      encode(x.data(), ranks.data() + (r - begin) * numFeatures);
+    }
+    predictRanks(ranks.data(), end - begin, predictions.data() + begin);
+  });
+  return predictions;
+}
+
+Metrics CompactForest::evaluate(const Data& rows) const {
+  const auto predictions = predictBatch(rows);
+  Metrics metrics(schema_.classes());
+  for (size_t r = 0; r < rows.size(); r++)
+    metrics.add(rows[r].back(), schema_.classes()[predictions[r]]);
+  return metrics;
+}
+
+namespace {
+
+  void expand(const CompactForest& model, uint32_t index, vector<FlatNode>& nodes, vector<uint32_t>& counts) {
+    const CompactNode& node = model.nodes()[index];
+    const size_t at = nodes.size();
+    nodes.push_back(FlatNode{0, FlatNode::Leaf, 0.0, 0, 0});
+    if (node.isLeaf()) {
+      const size_t numClasses = model.schema().numClasses();
+      const auto first = model.distributions().begin() + node.left;
+      nodes[at].left = static_cast<uint32_t>(counts.size());
+      nodes[at].right = node.value;
+      counts.insert(counts.end(), first, first + numClasses);
+      return;
+    }
+    const uint32_t feature = node.feature & ~CompactNode::categoricalBit;
+    FlatNode flat{feature, FlatNode::Numeric, 0.0, 0, 0};
+    if (node.feature & CompactNode::categoricalBit) {
+      flat.kind = FlatNode::Categorical;
+      flat.value = node.value;
+    } else {
+      flat.value = model.codebooks()[feature][node.value];
+    }
+    flat.left = static_cast<uint32_t>(nodes.size());
+    expand(model, node.left, nodes, counts);
+    flat.right = static_cast<uint32_t>(nodes.size());
+    expand(model, node.right, nodes, counts);
+    nodes[at] = flat;
+  }
+
+}
+
+Forest CompactForest::decompress() const {
+  auto owned = std::make_shared<std::pair<vector<vector<FlatNode>>, vector<vector<uint32_t>>>>();
+  owned->first.resize(roots_.size());
+  owned->second.resize(roots_.size());
+  vector<FlatTree> trees;
+  for (size_t t = 0; t < roots_.size(); t++) {
+    expand(*this, roots_[t], owned->first[t], owned->second[t]);
+    trees.push_back(FlatTree{owned->first[t].data(), static_cast<uint32_t>(owned->first[t].size()),
+                             owned->second[t].data(), static_cast<uint32_t>(owned->second[t].size())});
+  }
+  return Forest(schema_, std::move(trees), std::move(owned), seed_);
+}
+
+size_t CompactForest::modelBytes() const {
+  size_t bytes = roots_.size() * sizeof(uint32_t) + nodes_.size() * sizeof(CompactNode)
+                 + distributions_.size() * sizeof(uint16_t);
+  for (const auto& codebook: codebooks_)
+    bytes += codebook.size() * sizeof(double);
+  return bytes;
+}
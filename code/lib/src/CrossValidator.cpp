@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include "CrossValidator.hpp"
+#include "DecisionTree.hpp"
+#include "Forest.hpp"
+#include "Memory.hpp"
+#include "ThreadPool.hpp"
+#include "Trace.hpp"
+
+using std::shared_ptr;
+using std::vector;
+
+CrossValidator::CrossValidator(shared_ptr<const DataReader> dr, size_t k, uint64_t seed) :
+  dr_(std::move(dr)),
+  folds_(k) {
+  const ColumnStore& store = dr_->trainColumns();
+  if (k < 2 || k > store.numRows())
+    throw std::invalid_argument("Cross-validation needs 2 to " + std::to_string(store.numRows())
+                                + " folds, not " + std::to_string(k));
+
+  vector<Rows> byClass(store.numClasses());
+  for (uint32_t row = 0; row < store.numRows(); row++)
+    byClass[store.labels()[row]].push_back(row);
+
+  // Deal the rows of every class over the folds in a random order, carrying
+  // on with the next fold after each class so the fold sizes stay even.
+  std::mt19937_64 random_number_generator(seed);
+  size_t next = 0;
+  for (auto& rows: byClass) {
+    std::shuffle(rows.begin(), rows.end(), random_number_generator);
+    for (const auto row: rows)
+      folds_[next++ % k].push_back(row);
+  }
+  for (auto& fold: folds_)
+    std::sort(fold.begin(), fold.end());
+}
+
+Metrics CrossValidator::evaluateFold(size_t f, const TreeConfig& config) const {
+  const ColumnStore& store = dr_->trainColumns();
+  Weights weights(store.numRows(), 1);
+  for (const auto row: folds_[f])
+    weights[row] = 0;
+  const DecisionTree tree(dr_, weights, config);
+
+  const auto predictions = Forest::fromNodes({&tree.root_}, store.schema()).predictBatch(store, folds_[f]);
+  Metrics metrics(store.schema().classes());
+  for (size_t i = 0; i < folds_[f].size(); i++)
+    metrics.add(store.labels()[folds_[f][i]], predictions[i]);
+  return metrics;
+}
+
+CrossValidationResult CrossValidator::run(const TreeConfig& config) const {
+  TRACE_SPAN("cross_validate", "folds", static_cast<int64_t>(folds_.size()));
+  const Memory::Phase phase("cross_validate");
+  ThreadPool& pool = ThreadPool::shared();
+  const size_t n = dr_->trainColumns().numRows();
+  Memory::checkBudget("cross-validating " + std::to_string(folds_.size()) + " folds",
+                      std::min(folds_.size(), pool.size())
+                      * (n * sizeof(Weights::value_type) + DecisionTree::trainingEstimate(n)));
+
+  // With a model per core, every model is built on a single thread.
+  TreeConfig foldConfig = config;
+  if (folds_.size() >= pool.size())
+    foldConfig.parallelDepth = 0;
+
+  // The calling thread evaluates folds as well, so this can run in a task
+  // on the same pool, e.g. in a hyperparameter search.
+  CrossValidationResult result;
+  result.folds.resize(folds_.size());
+  pool.parallelFor(0, folds_.size(), 1, [this, &result, &foldConfig](size_t begin, size_t end) {
+    for (size_t f = begin; f < end; f++)
+      result.folds[f] = evaluateFold(f, foldConfig);
+  });
+  result.total = Metrics(dr_->trainColumns().schema().classes());
+  for (const auto& fold: result.folds)
+    result.total.merge(fold);
+
+  for (const auto& fold: result.folds)
+    result.meanAccuracy += fold.accuracy() / static_cast<double>(result.folds.size());
+  double squares = 0.0;
+  for (const auto& fold: result.folds)
+    squares += (fold.accuracy() - result.meanAccuracy) * (fold.accuracy() - result.meanAccuracy);
+  result.stddevAccuracy = std::sqrt(squares / static_cast<double>(result.folds.size() - 1));
+  return result;
+}
@@ -4,60 +4,208 @@
  * Written by Pieter Robberechts, 2019
  */
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <thread>
 #include "DataReader.hpp"
+#include "Memory.hpp"
+#include "Trace.hpp"
 
 using boost::algorithm::split;
 using boost::timer::cpu_timer;
 
+namespace {
+
+  size_t fileSize(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    return file ? static_cast<size_t>(file.tellg()) : 0;
+  }
+
+  /** Parsed chunks on their way from the parser to the encoder. */
+  class ChunkQueue {
+    public:
+      explicit ChunkQueue(size_t capacity) : capacity_(capacity) {}
+
+      /** Blocks while the queue is full. */
+      void push(Data&& chunk) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notFull_.wait(lock, [this]() { return chunks_.size() < capacity_; });
+        chunks_.push_back(std::move(chunk));
+        notEmpty_.notify_one();
+      }
+
+      /** Blocks until there is a chunk; false once the queue is closed and empty. */
+      bool pop(Data& chunk) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notEmpty_.wait(lock, [this]() { return closed_ || !chunks_.empty(); });
+        if (chunks_.empty())
+          return false;
+        chunk = std::move(chunks_.front());
+        chunks_.pop_front();
+        notFull_.notify_one();
+        return true;
+      }
+
+      void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        notEmpty_.notify_all();
+      }
+
+    private:
+      const size_t capacity_;
+      std::deque<Data> chunks_{};
+      bool closed_ = false;
+      std::mutex mutex_{};
+      std::condition_variable notEmpty_{};
+      std::condition_variable notFull_{};
+  };
+
+}
+
 DataReader::DataReader(const Dataset& dataset) :
     classLabel_(dataset.classLabel),
     trainData_({}),
-    testData_({}),
     trainMetaData_({}),
-    testMetaData_({}) {
+    trainColumns_(),
+    test_(std::make_shared<TestSet>()) {
   std::cout << "Start reading data set." << std::endl; cpu_timer timer;
-  std::thread readTestingData([this, &dataset]() {
-    return processFile(dataset.train.filename, trainData_, trainMetaData_);
-  });
-
-  std::thread readTrainingData([this, &dataset]() {
-    return processFile(dataset.test.filename, testData_, testMetaData_);
-  });
-
-  readTrainingData.join();
-  readTestingData.join();
+  TRACE_SPAN("load");
+  const Memory::Phase phase("load");
+  test_->filename = dataset.test.filename;
+  // Parsed rows take at least as much memory as the text they come from.
+  Memory::checkBudget("loading " + dataset.train.filename, fileSize(dataset.train.filename));
+  loadTrainingFile(dataset.train.filename);
   std::cout << "Done. " << timer.format() << std::endl;
 
-  if (!classLabel_.empty())
-    moveClassLabelToBack();
-
   if (trainData_.empty())
     throw std::runtime_error("Can't open file: " + dataset.train.filename);
+}
+
+void DataReader::loadTrainingFile(const std::string& filename) {
+  ChunkQueue queue(maxQueuedChunks);
+  std::exception_ptr error;
+  // Set by the encoder when it fails, so the parser stops at its next chunk
+  // instead of reading the rest of the file.
+  std::atomic<bool> failed{false};
+  std::thread encoder;
+  auto encode = [this, &filename, &queue, &error, &failed]() {
+    Data chunk;
+    while (queue.pop(chunk)) {
+      if (error)
+        continue;   // drain, so the parser never blocks
+      try {
+        TRACE_SPAN("encode", "rows", static_cast<int64_t>(chunk.size()));
+        Memory::checkBudget("encoding " + filename,
+                            chunk.size() * (trainMetaData_.columnTypes.size() * sizeof(double) + sizeof(uint32_t)));
+        trainColumns_.append(chunk);
+        trainData_.insert(trainData_.end(), std::make_move_iterator(chunk.begin()),
+                          std::make_move_iterator(chunk.end()));
+      } catch (...) {
+        error = std::current_exception();
+        failed.store(true, std::memory_order_release);
+      }
+    }
+  };
+  auto startEncoder = [this, &encoder, &encode]() {
+    // The schema needs the header with the class last; the rows follow.
+    if (!classLabel_.empty())
+      moveClassLabelToBack();
+    trainColumns_ = ColumnStore(trainMetaData_);
+    encoder = std::thread(encode);
+  };
+
+  try {
+    processFile(filename, trainMetaData_, startEncoder, [&queue, &failed](Data&& chunk) {
+      if (failed.load(std::memory_order_acquire))
+        throw std::runtime_error("Encoding stopped");
+      queue.push(std::move(chunk));
+    });
+  } catch (...) {
+    queue.close();
+    if (encoder.joinable())
+      encoder.join();
+    // The encoder's error is the cause of the parser's.
+    if (error)
+      std::rethrow_exception(error);
+    throw;
+  }
+  queue.close();
+  if (encoder.joinable())
+    encoder.join();
+  if (error)
+    std::rethrow_exception(error);
+}
 
-  if (testData_.empty())
-    throw std::runtime_error("Can't open file: " + dataset.test.filename);
+const Data& DataReader::testData() const {
+  std::call_once(test_->once, [this]() { loadTestFile(); });
+  return test_->data;
 }
 
-void DataReader::processFile(const std::string& filename, Data& data, MetaData &meta) {
+void DataReader::loadTestFile() const {
+  TRACE_SPAN("load_test");
+  const Memory::Phase phase("load");
+  TestSet& test = *test_;
+  Memory::checkBudget("loading " + test.filename, fileSize(test.filename));
+  Data data;
+  processFile(test.filename, test.meta, []() {}, [&data](Data&& chunk) {
+    data.insert(data.end(), std::make_move_iterator(chunk.begin()), std::make_move_iterator(chunk.end()));
+  });
+  if (data.empty())
+    throw std::runtime_error("Can't open file: " + test.filename);
+  test.data = std::move(data);
+  test.loaded.store(true, std::memory_order_release);
+}
+
+bool DataReader::processFile(const std::string& filename, MetaData& meta, const std::function<void()>& onHeader,
+                             const std::function<void(Data&&)>& onChunk) const {
   std::ifstream file(filename);
   if (!file)
-    return;
+    return false;
 
   std::string line;
+  size_t lineNumber = 0;
   bool header_loaded = false;
+  long classIndex = -1;
+  Data chunk;
+  chunk.reserve(chunkRows);
 
   while (getline(file, line)) {
+    lineNumber++;
     if (!header_loaded) {
       parseHeaderLine(line, meta, header_loaded);
+      if (!header_loaded)
+        continue;
+      // The position of the class column in the file, before it is moved.
+      const auto result = std::find(meta.labels.begin(), meta.labels.end(), classLabel_);
+      if (!classLabel_.empty() && result != meta.labels.end())
+        classIndex = std::distance(meta.labels.begin(), result);
+      onHeader();
     } else {
-      parseDataLine(line, data, meta);
+      const auto first = line.find_first_not_of(" \t\r");
+      if (first == std::string::npos || line[first] == '%')
+        continue;
+      parseDataLine(line, chunk, classIndex);
+      if (chunk.back().size() != meta.labels.size())
+        throw std::runtime_error(filename + ", line " + std::to_string(lineNumber) + ": "
+                                 + std::to_string(chunk.back().size()) + " values instead of "
+                                 + std::to_string(meta.labels.size()));
+      if (chunk.size() == chunkRows) {
+        onChunk(std::move(chunk));
+        chunk = Data();
+        chunk.reserve(chunkRows);
+      }
     }
   }
+  if (!chunk.empty())
+    onChunk(std::move(chunk));
   file.close();
+  return true;
 }
 
-bool DataReader::parseHeaderLine(const std::string &line, MetaData &meta, bool &header_loaded) {
+bool DataReader::parseHeaderLine(const std::string &line, MetaData &meta, bool &header_loaded) const {
   if (line.size() == 0) {
     return true;
   }
@@ -92,6 +240,7 @@ bool DataReader::parseHeaderLine(const std::string &line, MetaData &meta, bool &
       s = s.substr(0, s.size() - len);
       meta.labels.push_back(s);
 	  meta.columnTypes.push_back("ordinal");
+      meta.domains.emplace_back();
       return true;
     }
 
@@ -101,14 +250,20 @@ bool DataReader::parseHeaderLine(const std::string &line, MetaData &meta, bool &
       s = s.substr(0, s.size() - len);
       meta.labels.push_back(s);
 	  meta.columnTypes.push_back("numeric");
+      meta.domains.emplace_back();
       return true;
     }
 
     {
       int pos = s.find_last_of("{");
+      VecS domain;
+      const std::string values = s.substr(pos + 1, s.find_last_of("}") - pos - 1);
+      split(domain, values, boost::is_any_of(","));
+      trimWhiteSpaces(domain);
       s = s.substr(0, pos);
       meta.labels.push_back(s);
 	  meta.columnTypes.push_back("categorical");
+      meta.domains.push_back(std::move(domain));
       return true;
     }
     return true;
@@ -129,36 +284,34 @@ bool DataReader::parseHeaderLine(const std::string &line, MetaData &meta, bool &
   return true;
 }
 
-bool DataReader::parseDataLine(const std::string &line, Data &data, MetaData &meta) {
+bool DataReader::parseDataLine(const std::string &line, Data &data, long classIndex) const {
   std::vector<std::string> vec;
   split(vec, line, boost::is_any_of(","));
   trimWhiteSpaces(vec);
 
-  if (classLabel_.empty()) {
-    data.emplace_back(std::move(vec));
-  } else {
-    moveClassDataToBack(vec, meta.labels);
-    data.emplace_back(std::move(vec));
-  }
+  if (classIndex >= 0)
+    moveClassDataToBack(vec, classIndex);
+  data.emplace_back(std::move(vec));
 
   return true;
 }
 
 void DataReader::moveClassLabelToBack() {
   const auto result = std::find(std::begin(trainMetaData_.labels), std::end(trainMetaData_.labels), classLabel_);
-  if (result != std::end(metaData().labels))
+  if (result != std::end(metaData().labels)) {
+    const auto index = std::distance(std::begin(trainMetaData_.labels), result);
     std::iter_swap(result, std::end(trainMetaData_.labels)-1);
+    std::iter_swap(std::begin(trainMetaData_.columnTypes)+index, std::end(trainMetaData_.columnTypes)-1);
+    std::iter_swap(std::begin(trainMetaData_.domains)+index, std::end(trainMetaData_.domains)-1);
+  }
 }
 
-void DataReader::moveClassDataToBack(VecS &line, const VecS &labels) const{
-  static const auto result = std::find(std::begin(labels), std::end(labels), classLabel_);
-  if (result != std::end(labels)) {
-    static const auto result_index = std::distance(std::begin(labels), result);
-    std::iter_swap(std::begin(line)+result_index, std::end(line)-1);
-  }
+void DataReader::moveClassDataToBack(VecS &line, long classIndex) const {
+  if (static_cast<size_t>(classIndex) < line.size())
+    std::iter_swap(std::begin(line) + classIndex, std::end(line) - 1);
 }
 
-void DataReader::trimWhiteSpaces(VecS &line) {
+void DataReader::trimWhiteSpaces(VecS &line) const {
   for (auto& val: line)
     boost::trim(val);
 }
@@ -6,7 +6,12 @@
 
 #include "DecisionTree.hpp"
 #include "Utils.hpp"
+#include "Memory.hpp"
+#include "ModelIO.hpp"
+#include "Trace.hpp"
 #include <future>
+#include <numeric>
+#include <random>
 //#include <boost/thread.hpp>
 #include <tuple>
 
@@ -16,85 +21,177 @@ using std::string;
 using boost::timer::cpu_timer;
 
 
-DecisionTree::DecisionTree(const DataReader& dr) : root_(Node()), dr_(dr) {
+DecisionTree::DecisionTree(const DataReader& dr) :
+  root_(Node()), dr_(make_shared<const DataReader>(dr)), config_(), updater_() {
   std::cout << "Start building tree." << std::endl; cpu_timer timer;
+  const Memory::Phase phase("train");
+  Memory::checkBudget("training a tree", trainingEstimate(dr_->trainColumns().numRows()));
 	unsigned int numThreads = std::thread::hardware_concurrency();
 	std::cout << "Number of threads: " << numThreads << std::endl;
-  root_ = buildTree(dr_.trainData(), dr_.metaData());
+  root_ = buildTree(dr_->trainColumns(), allRows(Weights()), Weights(), 0, 1, config_.parallelDepth);
   std::cout << "Done. " << timer.format() << std::endl;
 }
 
-DecisionTree::DecisionTree(const DataReader &dr, const std::vector<size_t> &samples) : root_(Node()), dr_(dr) {
-    std::cout << "Start building tree as part of bagging...." << std::endl;
-    cpu_timer timer;
+DecisionTree::DecisionTree(const DataReader &dr, const std::vector<size_t> &samples) :
+  DecisionTree(make_shared<const DataReader>(dr), bootstrapWeights(dr.trainData().size(), samples), TreeConfig()) {}
 
-    Data sample_data;
-    sample_data.reserve(samples.size());
-    for (auto index : samples) {
-        sample_data.emplace_back(std::move(dr_.trainData().at(index)));
+DecisionTree::DecisionTree(shared_ptr<const DataReader> dr, const Weights& weights, const TreeConfig& config) :
+  root_(Node()),
+  dr_(std::move(dr)),
+  config_(config),
+  updater_() {
+    TRACE_SPAN("train_tree");
+    Memory::checkBudget("training a tree", trainingEstimate(dr_->trainColumns().numRows()));
+    root_ = buildTree(dr_->trainColumns(), allRows(weights), weights, 0, 1, config_.parallelDepth);
+}
+
+DecisionTree::DecisionTree(shared_ptr<const DataReader> dr, Node root, const TreeConfig& config) :
+  root_(std::move(root)),
+  dr_(std::move(dr)),
+  config_(config),
+  updater_() {}
+
+DecisionTree::DecisionTree(const DecisionTree& other) :
+  root_(other.root_),
+  dr_(other.dr_),
+  config_(other.config_),
+  updater_(other.updater_ ? std::make_unique<TreeUpdater>(*other.updater_) : nullptr) {}
+
+DecisionTree& DecisionTree::operator=(const DecisionTree& other) {
+  if (this != &other) {
+    root_ = other.root_;
+    dr_ = other.dr_;
+    config_ = other.config_;
+    updater_ = other.updater_ ? std::make_unique<TreeUpdater>(*other.updater_) : nullptr;
+  }
+  return *this;
+}
+
+size_t DecisionTree::trainingEstimate(size_t numRows) {
+  // The row lists of the nodes on a path, the sort buffer of the split search
+  // and, at worst, a leaf per row.
+  return numRows * (2 * sizeof(uint32_t) + sizeof(std::pair<double, uint32_t>) + sizeof(Node));
+}
+
+MemoryUsage DecisionTree::memoryUsage() const {
+  MemoryUsage usage;
+  usage.dataset = Memory::bytes(*dr_);
+  usage.scratch = Memory::scratchPeak();
+  Memory::addTree(root_, usage);
+  return usage;
+}
+
+Weights DecisionTree::bootstrapWeights(size_t numRows, const std::vector<size_t>& samples) {
+  Weights weights(numRows, 0);
+  for (const auto index: samples)
+    weights.at(index)++;
+  return weights;
+}
+
+Rows DecisionTree::allRows(const Weights& weights) const {
+  const auto n = static_cast<uint32_t>(dr_->trainColumns().numRows());
+  Rows rows;
+  rows.reserve(n);
+  for (uint32_t row = 0; row < n; row++)
+    if (weights.empty() || weights[row] > 0)
+      rows.push_back(row);
+  return rows;
+}
+
+/**
+ * Every node draws its feature sample and thresholds from its own random
+ * stream, identified by its position in the tree, so the tree does not
+ * depend on the order in which subtrees are built. If none of the sampled
+ * features splits the rows, further features are drawn, mtry at a time,
+ * until one does or all were tried, as in scikit-learn.
+ */
+std::tuple<const double, const Question> DecisionTree::findSplit(const ColumnStore& store, const Rows& rows,
+                                                                 const Weights& weights, bool parallel,
+                                                                 uint64_t node) const {
+  const auto minLeaf = static_cast<double>(config_.minLeaf);
+  if (config_.mtry == 0 && !config_.randomThresholds)
+    return Calculations::find_best_split(store, rows, weights, parallel, minLeaf);
+
+  std::seed_seq seq{config_.seed, node};
+  std::mt19937_64 random_number_generator(seq);
+  std::vector<uint32_t> columns(store.numFeatures());
+  std::iota(columns.begin(), columns.end(), 0);
+  const size_t sampleSize = config_.mtry > 0 ? std::min(config_.mtry, columns.size()) : columns.size();
+  std::tuple<double, Question> best(0.0, Question());
+  for (size_t first = 0; first < columns.size(); first += sampleSize) {
+    // Partial Fisher-Yates shuffle: columns [first, last) are the next sample.
+    const size_t last = std::min(first + sampleSize, columns.size());
+    for (size_t i = first; i < last && sampleSize < columns.size(); i++) {
+      std::uniform_int_distribution<size_t> pick(i, columns.size() - 1);
+      std::swap(columns[i], columns[pick(random_number_generator)]);
     }
-	
-		root_ = buildTree(sample_data, dr_.metaData());
-    std::cout << "Done with building tree as part of bagging.... " << timer.format() << std::endl;
-}
-
-const Node DecisionTree::buildTree(const Data& rows, const MetaData& meta) {
-		//std::cout << "HUR DUR build INIT" << std::endl;
-		std::cout << "HUR DUR build 1" << std::endl;
-    auto[gain, question] = Calculations::find_best_split(rows, meta);
-    if (IsAlmostEqual(gain, 0.0)) {
-			ClassCounter classCounter = Calculations::classCounts(rows);
-			Leaf leaf(classCounter);
-			return Node(leaf);
+    std::vector<double> draws;
+    if (config_.randomThresholds) {
+      std::uniform_real_distribution<double> uniform(0.0, 1.0);
+      for (size_t i = first; i < last; i++)
+        draws.push_back(uniform(random_number_generator));
     }
-		std::cout << "HUR DUR build 2" << std::endl;
-    //const auto[true_rows, false_rows] = Calculations::partition(rows, question);
-		//int depth = 0;
-		static Data true_data; 
-		static Data false_data;
-		true_data.reserve(rows.size());
-		false_data.reserve(rows.size());
-		Calculations::partition(rows, question, true_data, false_data);
-    auto true_branch = std::async(std::launch::async, &DecisionTree::buildTree, this, std::cref(true_data), std::cref(meta));
-    auto false_branch = std::async(std::launch::async, &DecisionTree::buildTree, this, std::cref(false_data), std::cref(meta));
-		std::cout << "HUR DUR build 3" << std::endl;
-/* 		std::cout << "HUR DUR build 3" << std::endl;
-		Node *true_branch = new Node;
-		Node *false_branch = new Node;
-		std::thread buildTrueTree([this, &true_data, &meta, true_branch]() {
-				*true_branch = buildTree(true_data, meta);
-		});
-		std::thread buildFalseTree([this, &false_data, &meta, false_branch]() {
-				*false_branch = buildTree(false_data, meta);
-		});
-
-		buildTrueTree.join();
-		buildFalseTree.join();
-std::cout << "HUR DUR build 4" << std::endl;
-		Node res = Node(*true_branch, *false_branch, question);
-		delete true_branch;
-		delete false_branch;
-		return res; */
+    const std::vector<uint32_t> sample(columns.begin() + first, columns.begin() + last);
+    best = Calculations::find_best_split(store, rows, weights, sample, draws, parallel, minLeaf);
+    if (std::get<0>(best) > minGain)
+      break;
+  }
+  return best;
+}
+
+const Node DecisionTree::buildTree(const ColumnStore& store, const Rows& rows, const Weights& weights, int depth,
+                                   uint64_t node, int parallelLevels) const {
+    TRACE_SPAN("build_node", "depth", depth);
+    auto leaf = [&]() {
+      const auto counts = Calculations::classCounts(store, rows, weights);
+      return Node(Leaf(Calculations::toClassCounter(counts, store.schema())));
+    };
+    if (config_.maxDepth > 0 && depth >= config_.maxDepth)
+      return leaf();
+    const bool parallel = parallelLevels > 0;
+    auto[gain, question] = findSplit(store, rows, weights, parallel, node);
+    if (!(gain > minGain))
+      return leaf();
+		Rows true_rows;
+		Rows false_rows;
+		Calculations::partition(store, rows, question, true_rows, false_rows);
+    const Memory::Scratch partitionBytes((true_rows.capacity() + false_rows.capacity()) * sizeof(uint32_t));
+    if (!parallel)
+      return Node(buildTree(store, true_rows, weights, depth + 1, 2 * node, 0),
+                  buildTree(store, false_rows, weights, depth + 1, 2 * node + 1, 0), question);
+    auto true_branch = std::async(std::launch::async, &DecisionTree::buildTree, this, std::cref(store), std::cref(true_rows), std::cref(weights), depth + 1, 2 * node, parallelLevels - 1);
+    auto false_branch = std::async(std::launch::async, &DecisionTree::buildTree, this, std::cref(store), std::cref(false_rows), std::cref(weights), depth + 1, 2 * node + 1, parallelLevels - 1);
 		return Node(true_branch.get(), false_branch.get(), question);
 }
 
-const Node DecisionTree::buildTreeStandard(const Data& rows, const MetaData& meta, int depth) {
-    auto[gain, question] = Calculations::find_best_split(rows, meta);
-    if (IsAlmostEqual(gain, 0.0)) {
-			ClassCounter classCounter = Calculations::classCounts(rows);
-			Leaf leaf(classCounter);
-			return Node(leaf);
-    }
-		Data true_data;
-		Data false_data;
-    //const auto[true_rows, false_rows] = Calculations::partition(rows, question);
-		Calculations::partition(rows, question, true_data, false_data);
-		depth += 1;
-		//std::cout << depth << std::endl;
-		auto true_branch = buildTreeStandard(true_data, meta, depth);
-    auto false_branch = buildTreeStandard(false_data, meta, depth);
-		return Node(std::move(true_branch), std::move(false_branch), question);
+size_t DecisionTree::update(const Data& rows, double tolerance) {
+  if (!updater_)
+    updater_ = std::make_unique<TreeUpdater>(dr_, root_, config_);
+  // A retrained subtree continues at the depth and node number of the node
+  // it replaces, so maxDepth and the random streams of the nodes hold as in
+  // a full training. Most are small; only large ones are built in parallel.
+  auto build = [this](const ColumnStore& store, const Rows& subset, int depth, uint64_t node) {
+    const int parallelLevels = subset.size() < minParallelRows ? 0 : config_.parallelDepth;
+    return buildTree(store, subset, Weights(), depth, node, parallelLevels);
+  };
+  root_ = updater_->update(root_, rows, tolerance, build);
+  return updater_->rebuilt();
+}
 
+PruneResult DecisionTree::pruneCostComplexity(double alpha) {
+  return replaceRoot(Pruning::costComplexity(root_, dr_->trainColumns().schema(), alpha));
+}
+
+PruneResult DecisionTree::pruneReducedError(const Data& validation) {
+  return replaceRoot(Pruning::reducedError(root_, dr_->trainColumns().schema(), validation));
+}
+
+PruneResult DecisionTree::replaceRoot(Node root) {
+  PruneResult result{Pruning::countNodes(root_), Pruning::countNodes(root)};
+  root_ = std::move(root);
+  // The statistics of the updater follow the shape of the old tree.
+  updater_.reset();
+  return result;
 }
 
 void DecisionTree::print() const {
@@ -107,7 +204,7 @@ void DecisionTree::print(const shared_ptr<Node> root, string spacing) const {
     std::cout << spacing + "Predict: "; Utils::print::print_map(leaf->predictions());
     return;
   }
-  std::cout << spacing << root->question().toString(dr_.metaData().labels) << "\n";
+  std::cout << spacing << root->question().toString(dr_->metaData().labels) << "\n";
 
   std::cout << spacing << "--> True: " << "\n";
   print(root->trueBranch(), spacing + "   ");
@@ -116,6 +213,14 @@ void DecisionTree::print(const shared_ptr<Node> root, string spacing) const {
   print(root->falseBranch(), spacing + "   ");
 }
 
-void DecisionTree::test() const {
-  TreeTest t(dr_.testData(), dr_.metaData(), root_);
+Metrics DecisionTree::test() const {
+  return TreeTest().test(dr_->testData(), dr_->metaData(), root_);
+}
+
+Forest DecisionTree::flatten() const {
+  return Forest::fromNodes({&root_}, dr_->metaData());
+}
+
+void DecisionTree::save(const std::string& filename) const {
+  ModelIO::save(flatten(), filename);
 }
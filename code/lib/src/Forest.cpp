@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <numeric>
+#include "Forest.hpp"
+#include "ThreadPool.hpp"
+#include "Trace.hpp"
+
+using std::string;
+using std::vector;
+
+namespace {
+
+  struct OwnedTrees {
+    vector<vector<FlatNode>> nodes{};
+    vector<vector<uint32_t>> counts{};
+  };
+
+  /**
+   * Add classes and categorical values that are used by the tree but not
+   * declared in the header, so every leaf can be given the same width.
+   */
+  void completeSchema(const Node& node, Schema& schema) {
+    if (const auto& leaf = node.leaf(); leaf != nullptr) {
+      for (const auto& entry: leaf->predictions())
+        schema.addClass(entry.first);
+      return;
+    }
+    const Question& q = node.question();
+    if (schema.types()[q.column_] == Schema::ColumnType::Categorical)
+      schema.addCode(q.column_, q.value_);
+    completeSchema(*node.trueBranch(), schema);
+    completeSchema(*node.falseBranch(), schema);
+  }
+
+  Node unflatten(const FlatTree& tree, uint32_t index, const Schema& schema) {
+    const FlatNode& node = tree.nodes[index];
+    if (node.kind == FlatNode::Leaf) {
+      ClassCounter counts;
+      for (size_t c = 0; c < schema.numClasses(); c++)
+        if (const uint32_t count = tree.leafCounts[node.left + c]; count > 0)
+          counts[schema.classes()[c]] = static_cast<int>(count);
+      return Node(Leaf(counts));
+    }
+    const auto column = static_cast<int>(node.feature);
+    const Question question = node.kind == FlatNode::Numeric
+        ? Question(column, node.value)
+        : Question(column, schema.domains()[column][static_cast<size_t>(node.value)], false);
+    return Node(unflatten(tree, node.left, schema), unflatten(tree, node.right, schema), question);
+  }
+
+  void flatten(const Node& node, const Schema& schema, vector<FlatNode>& nodes, vector<uint32_t>& counts) {
+    const size_t index = nodes.size();
+    nodes.push_back(FlatNode{0, FlatNode::Leaf, 0.0, 0, 0});
+
+    if (const auto& leaf = node.leaf(); leaf != nullptr) {
+      const auto offset = static_cast<uint32_t>(counts.size());
+      counts.resize(counts.size() + schema.numClasses(), 0);
+      for (const auto& [label, count]: leaf->predictions())
+        counts[offset + schema.classCode(label)] = count;
+      const auto best = std::max_element(counts.begin() + offset, counts.end()) - (counts.begin() + offset);
+      nodes[index] = FlatNode{0, FlatNode::Leaf, 0.0, offset, static_cast<uint32_t>(best)};
+      return;
+    }
+
+    const Question& q = node.question();
+    const auto column = static_cast<uint32_t>(q.column_);
+    FlatNode flat{column, FlatNode::Numeric, 0.0, 0, 0};
+    if (schema.types()[column] == Schema::ColumnType::Categorical) {
+      flat.kind = FlatNode::Categorical;
+      flat.value = schema.code(column, q.value_);
+    } else {
+      flat.value = q.threshold_;
+    }
+    flat.left = static_cast<uint32_t>(nodes.size());
+    flatten(*node.trueBranch(), schema, nodes, counts);
+    flat.right = static_cast<uint32_t>(nodes.size());
+    flatten(*node.falseBranch(), schema, nodes, counts);
+    nodes[index] = flat;
+  }
+
+}
+
+Forest Forest::fromNodes(const vector<const Node*>& roots, const MetaData& meta, uint64_t seed) {
+  return fromNodes(roots, Schema(meta), seed);
+}
+
+Forest Forest::fromNodes(const vector<const Node*>& roots, const Schema& base, uint64_t seed) {
+  Schema schema(base);
+  for (const Node* root: roots)
+    completeSchema(*root, schema);
+
+  auto owned = std::make_shared<OwnedTrees>();
+  vector<FlatTree> trees;
+  owned->nodes.resize(roots.size());
+  owned->counts.resize(roots.size());
+  for (size_t t = 0; t < roots.size(); t++) {
+    flatten(*roots[t], schema, owned->nodes[t], owned->counts[t]);
+    trees.push_back(FlatTree{owned->nodes[t].data(), static_cast<uint32_t>(owned->nodes[t].size()),
+                             owned->counts[t].data(), static_cast<uint32_t>(owned->counts[t].size())});
+  }
+
+  // Most confident trees first, so early-exit voting settles sooner.
+  vector<double> confidences;
+  for (const auto& tree: trees)
+    confidences.push_back(confidence(tree, schema.numClasses()));
+  vector<size_t> order(trees.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return confidences[a] > confidences[b]; });
+  vector<FlatTree> ordered;
+  for (const auto t: order)
+    ordered.push_back(trees[t]);
+  trees = std::move(ordered);
+  return Forest(std::move(schema), std::move(trees), std::move(owned), seed);
+}
+
+vector<Node> Forest::toNodes() const {
+  vector<Node> roots;
+  roots.reserve(trees_.size());
+  for (const auto& tree: trees_)
+    roots.push_back(unflatten(tree, 0, schema_));
+  return roots;
+}
+
+Forest::Forest(Schema schema, vector<FlatTree> trees, std::shared_ptr<const void> storage, uint64_t seed) :
+  schema_(std::move(schema)),
+  trees_(std::move(trees)),
+  storage_(std::move(storage)),
+  seed_(seed) {}
+
+double Forest::confidence(const FlatTree& tree, size_t numClasses) {
+  uint64_t majority = 0;
+  uint64_t total = 0;
+  for (uint32_t offset = 0; offset + numClasses <= tree.numLeafCounts; offset += numClasses) {
+    const auto first = tree.leafCounts + offset;
+    majority += *std::max_element(first, first + numClasses);
+    total += std::accumulate(first, first + numClasses, uint64_t(0));
+  }
+  return total == 0 ? 0.0 : static_cast<double>(majority) / total;
+}
+
+bool Forest::decided(const uint32_t* votes, size_t numClasses, size_t remaining) {
+  uint32_t first = 0;
+  uint32_t second = 0;
+  for (size_t c = 0; c < numClasses; c++) {
+    if (votes[c] > first) {
+      second = first;
+      first = votes[c];
+    } else if (votes[c] > second) {
+      second = votes[c];
+    }
+  }
+  // Strictly ahead, so not even a tie is possible any more.
+  return first > second + remaining;
+}
+
+uint32_t Forest::predict(const double* x) const {
+  if (trees_.size() == 1)
+    return trees_.front().predict(x);
+
+  vector<uint32_t> votes(schema_.numClasses(), 0);
+  for (size_t t = 0; t < trees_.size(); t++) {
+    votes[trees_[t].predict(x)]++;
+    if (earlyExit_ && decided(votes.data(), votes.size(), trees_.size() - t - 1))
+      break;
+  }
+  return static_cast<uint32_t>(std::max_element(votes.begin(), votes.end()) - votes.begin());
+}
+
+string Forest::predict(const VecS& row) const {
+  vector<double> x(schema_.numFeatures());
+  schema_.encode(row, x.data());
+  return schema_.classes()[predict(x.data())];
+}
+
+void Forest::predictEncoded(const double* encoded, size_t n, uint32_t* predictions) const {
+  const size_t numFeatures = schema_.numFeatures();
+  if (trees_.size() == 1) {
+    for (size_t r = 0; r < n; r++)
+      predictions[r] = trees_.front().predict(encoded + r * numFeatures);
+    return;
+  }
+
+  // Tree-major order keeps one tree hot in cache for the whole block. With
+  // early exit, rows whose vote is settled are dropped after every group of
+  // trees.
+  const size_t numClasses = schema_.numClasses();
+  const size_t group = earlyExit_ ? earlyExitGroup : trees_.size();
+  vector<uint32_t> votes(n * numClasses, 0);
+  vector<uint32_t> active(n);
+  std::iota(active.begin(), active.end(), 0);
+  for (size_t first = 0; first < trees_.size() && !active.empty(); first += group) {
+    const size_t last = std::min(first + group, trees_.size());
+    for (size_t t = first; t < last; t++)
+      for (const auto r: active)
+        votes[r * numClasses + trees_[t].predict(encoded + r * numFeatures)]++;
+    if (last == trees_.size())
+      break;
+    active.erase(std::remove_if(active.begin(), active.end(), [&](uint32_t r) {
+      return decided(votes.data() + r * numClasses, numClasses, trees_.size() - last);
+    }), active.end());
+  }
+  for (size_t r = 0; r < n; r++) {
+    const auto first = votes.begin() + r * numClasses;
+    predictions[r] = static_cast<uint32_t>(std::max_element(first, first + numClasses) - first);
+  }
+}
+
+vector<uint32_t> Forest::predictBatch(const Data& rows) const {
+  vector<uint32_t> predictions(rows.size());
+  const size_t numFeatures = schema_.numFeatures();
+  ThreadPool& pool = ThreadPool::shared();
+  const size_t grain = std::max<size_t>(512, rows.size() / (4 * pool.size()) + 1);
+
+  pool.parallelFor(0, rows.size(), grain, [&](size_t begin, size_t end) {
+    vector<double> encoded((end - begin) * numFeatures);
+    for (size_t r = begin; r < end; r++)
+      schema_.encode(rows[r], encoded.data() + (r - begin) * numFeatures);
+    predictEncoded(encoded.data(), end - begin, predictions.data() + begin);
+  });
+  return predictions;
+}
+
+vector<uint32_t> Forest::predictBatch(const ColumnStore& store, const vector<uint32_t>& rows) const {
+  vector<uint32_t> predictions(rows.size());
+  const size_t numFeatures = schema_.numFeatures();
+  ThreadPool& pool = ThreadPool::shared();
+  const size_t grain = std::max<size_t>(512, rows.size() / (4 * pool.size()) + 1);
+
+  pool.parallelFor(0, rows.size(), grain, [&](size_t begin, size_t end) {
+    vector<double> encoded((end - begin) * numFeatures);
+    for (size_t f = 0; f < numFeatures; f++) {
+      const auto& column = store.column(f);
+      for (size_t r = begin; r < end; r++)
+        encoded[(r - begin) * numFeatures + f] = column[rows[r]];
+    }
+    predictEncoded(encoded.data(), end - begin, predictions.data() + begin);
+  });
+  return predictions;
+}
+
+Metrics Forest::evaluate(const Data& rows) const {
+  TRACE_SPAN("evaluate", "rows", static_cast<int64_t>(rows.size()));
+  const auto predictions = predictBatch(rows);
+  Metrics metrics(schema_.classes());
+  for (size_t r = 0; r < rows.size(); r++)
+    metrics.add(rows[r].back(), schema_.classes()[predictions[r]]);
+  return metrics;
+}
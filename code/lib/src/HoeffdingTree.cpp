@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <cmath>
+#include <stdexcept>
+#include "HoeffdingTree.hpp"
+
+using std::vector;
+
+namespace {
+
+  double splitGain(const ClassHistogram& parent, double parentSize, const ClassHistogram& trueCounts) {
+    const double trueSize = std::accumulate(trueCounts.begin(), trueCounts.end(), 0.0);
+    const double falseSize = parentSize - trueSize;
+    if (trueSize <= 0 || falseSize <= 0)
+      return 0.0;
+    ClassHistogram falseCounts(parent);
+    for (size_t c = 0; c < falseCounts.size(); c++)
+      falseCounts[c] = std::max(0.0, falseCounts[c] - trueCounts[c]);
+    const double p = trueSize / parentSize;
+    return Calculations::gini(parent, parentSize) - p * Calculations::gini(trueCounts, trueSize)
+           - (1 - p) * Calculations::gini(falseCounts, falseSize);
+  }
+
+}
+
+void HoeffdingTree::Gaussian::add(double x) {
+  count++;
+  const double delta = x - mean;
+  mean += delta / count;
+  m2 += delta * (x - mean);
+  min = std::min(min, x);
+  max = std::max(max, x);
+}
+
+double HoeffdingTree::Gaussian::countAbove(double threshold) const {
+  if (count == 0 || threshold > max)
+    return 0.0;
+  if (threshold <= min)
+    return count;
+  const double sd = std::sqrt(m2 / count);
+  if (sd == 0)
+    return mean >= threshold ? count : 0.0;
+  return count * 0.5 * std::erfc((threshold - mean) / (sd * std::sqrt(2.0)));
+}
+
+HoeffdingTree::HoeffdingTree(const MetaData& meta, const HoeffdingConfig& config) :
+  schema_(meta),
+  config_(config),
+  numClasses_(schema_.numClasses()),
+  offsets_(),
+  nodes_(),
+  leaves_(),
+  growing_(true),
+  numRows_(0),
+  encoded_(schema_.numFeatures()) {
+  if (numClasses_ == 0)
+    throw std::invalid_argument("The class values must be declared in the meta data");
+
+  size_t categorical = 0;
+  size_t numeric = 0;
+  for (size_t col = 0; col < schema_.numFeatures(); col++) {
+    if (schema_.types()[col] == Schema::ColumnType::Categorical) {
+      offsets_.push_back(categorical);
+      categorical += numClasses_ * schema_.domains()[col].size();
+    } else {
+      offsets_.push_back(numeric);
+      numeric += numClasses_;
+    }
+  }
+
+  nodes_.push_back(FlatNode{0, FlatNode::Leaf, 0.0, 0, 0});
+  leaves_.emplace_back();
+  leaves_.back().counts.assign(numClasses_, 0.0);
+  reset(leaves_.back());
+}
+
+void HoeffdingTree::reset(LeafStats& leaf) const {
+  leaf.seen = 0;
+  leaf.lastAttempt = 0;
+  leaf.observed.assign(numClasses_, 0.0);
+  leaf.categorical.clear();
+  leaf.numeric.clear();
+  if (!growing_) {
+    leaf.categorical.shrink_to_fit();
+    leaf.numeric.shrink_to_fit();
+    return;
+  }
+  for (size_t col = 0; col < schema_.numFeatures(); col++) {
+    if (schema_.types()[col] == Schema::ColumnType::Categorical)
+      leaf.categorical.resize(leaf.categorical.size() + numClasses_ * schema_.domains()[col].size(), 0.0);
+    else
+      leaf.numeric.resize(leaf.numeric.size() + numClasses_);
+  }
+}
+
+uint32_t HoeffdingTree::leafOf(const double* x) const {
+  uint32_t index = 0;
+  while (nodes_[index].kind != FlatNode::Leaf) {
+    const FlatNode& node = nodes_[index];
+    const double value = x[node.feature];
+    const bool answer = node.kind == FlatNode::Numeric ? value >= node.value : value == node.value;
+    index = answer ? node.left : node.right;
+  }
+  return index;
+}
+
+void HoeffdingTree::learn(const VecS& row) {
+  const uint32_t label = schema_.classCode(row.back());
+  if (label == Schema::npos)
+    throw std::invalid_argument("Unknown class value: " + row.back());
+  schema_.encode(row, encoded_.data());
+  learn(encoded_.data(), label);
+}
+
+void HoeffdingTree::learn(const Data& rows) {
+  for (const auto& row: rows)
+    learn(row);
+}
+
+void HoeffdingTree::learn(const double* x, uint32_t label) {
+  if (label >= numClasses_)
+    throw std::invalid_argument("Class code " + std::to_string(label) + " out of range, there are "
+                                + std::to_string(numClasses_) + " classes");
+  const uint32_t node = leafOf(x);
+  LeafStats& leaf = leaves_[nodes_[node].left];
+  leaf.counts[label]++;
+  numRows_++;
+  if (!growing_)
+    return;
+
+  leaf.seen++;
+  leaf.observed[label]++;
+
+  for (size_t col = 0; col < schema_.numFeatures(); col++) {
+    if (std::isnan(x[col]))
+      continue;
+    if (schema_.types()[col] == Schema::ColumnType::Categorical) {
+      const size_t domain = schema_.domains()[col].size();
+      leaf.categorical[offsets_[col] + label * domain + static_cast<size_t>(x[col])]++;
+    } else {
+      leaf.numeric[offsets_[col] + label].add(x[col]);
+    }
+  }
+
+  if (leaf.seen - leaf.lastAttempt >= config_.gracePeriod)
+    attemptSplit(node);
+}
+
+double HoeffdingTree::bound(double n) const {
+  // The gini gain lies in [0, 1 - 1 / numClasses].
+  const double range = 1.0 - 1.0 / static_cast<double>(numClasses_);
+  return std::sqrt(range * range * std::log(1.0 / config_.delta) / (2.0 * n));
+}
+
+HoeffdingTree::Candidate HoeffdingTree::bestSplit(const LeafStats& leaf, Candidate& runnerUp) const {
+  // Only the rows seen since the leaf was made are in its statistics.
+  const ClassHistogram& parent = leaf.observed;
+  const double parentSize = static_cast<double>(leaf.seen);
+
+  Candidate best;
+  Candidate candidate;
+  candidate.trueCounts.assign(numClasses_, 0.0);
+  auto consider = [&]() {
+    candidate.gain = splitGain(parent, parentSize, candidate.trueCounts);
+    if (candidate.gain > best.gain) {
+      // Only the best split per feature competes, as in the Hoeffding bound
+      // the runner-up must be a different attribute.
+      if (best.feature != candidate.feature)
+        runnerUp = best;
+      best = candidate;
+    } else if (candidate.feature != best.feature && candidate.gain > runnerUp.gain) {
+      runnerUp = candidate;
+    }
+  };
+
+  for (size_t col = 0; col < schema_.numFeatures(); col++) {
+    candidate.feature = static_cast<uint32_t>(col);
+    if (schema_.types()[col] == Schema::ColumnType::Categorical) {
+      candidate.kind = FlatNode::Categorical;
+      const size_t domain = schema_.domains()[col].size();
+      for (size_t code = 0; code < domain; code++) {
+        candidate.value = static_cast<double>(code);
+        for (size_t c = 0; c < numClasses_; c++)
+          candidate.trueCounts[c] = leaf.categorical[offsets_[col] + c * domain + code];
+        consider();
+      }
+      continue;
+    }
+
+    candidate.kind = FlatNode::Numeric;
+    const Gaussian* stats = leaf.numeric.data() + offsets_[col];
+    double low = std::numeric_limits<double>::infinity();
+    double high = -low;
+    for (size_t c = 0; c < numClasses_; c++) {
+      low = std::min(low, stats[c].min);
+      high = std::max(high, stats[c].max);
+    }
+    if (!(low < high))
+      continue;
+    const double step = (high - low) / static_cast<double>(config_.numThresholds + 1);
+    for (size_t i = 1; i <= config_.numThresholds; i++) {
+      candidate.value = low + step * static_cast<double>(i);
+      for (size_t c = 0; c < numClasses_; c++)
+        candidate.trueCounts[c] = stats[c].countAbove(candidate.value);
+      consider();
+    }
+  }
+  return best;
+}
+
+void HoeffdingTree::attemptSplit(uint32_t node) {
+  const uint32_t leafIndex = nodes_[node].left;
+  LeafStats& leaf = leaves_[leafIndex];
+  leaf.lastAttempt = leaf.seen;
+  if (std::count_if(leaf.counts.begin(), leaf.counts.end(), [](double c) { return c > 0; }) < 2)
+    return;
+
+  Candidate runnerUp;
+  const Candidate best = bestSplit(leaf, runnerUp);
+  const double epsilon = bound(static_cast<double>(leaf.seen));
+  if (best.kind == FlatNode::Leaf || best.gain <= 0
+      || (best.gain - runnerUp.gain <= epsilon && epsilon >= config_.tieThreshold))
+    return;
+
+  // The children start from the estimated class counts of their side, so
+  // they predict sensibly before they have seen any rows of their own.
+  ClassHistogram falseCounts(leaf.counts);
+  const double total = std::accumulate(leaf.counts.begin(), leaf.counts.end(), 0.0);
+  const double seen = static_cast<double>(leaf.seen);
+  ClassHistogram trueCounts(numClasses_);
+  for (size_t c = 0; c < numClasses_; c++) {
+    trueCounts[c] = best.trueCounts[c] * total / seen;
+    falseCounts[c] = std::max(0.0, falseCounts[c] - trueCounts[c]);
+  }
+
+  const auto falseLeaf = static_cast<uint32_t>(leaves_.size());
+  growing_ = leaves_.size() + 1 < config_.maxLeaves;
+  const auto trueNode = static_cast<uint32_t>(nodes_.size());
+  nodes_.push_back(FlatNode{0, FlatNode::Leaf, 0.0, leafIndex, 0});
+  nodes_.push_back(FlatNode{0, FlatNode::Leaf, 0.0, falseLeaf, 0});
+  nodes_[node] = FlatNode{best.feature, best.kind, best.value, trueNode, trueNode + 1};
+
+  leaves_.emplace_back();
+  leaves_[leafIndex].counts = std::move(trueCounts);
+  leaves_[falseLeaf].counts = std::move(falseCounts);
+  if (growing_) {
+    reset(leaves_[leafIndex]);
+    reset(leaves_[falseLeaf]);
+  } else {
+    for (auto& other: leaves_)
+      reset(other);
+  }
+}
+
+std::string HoeffdingTree::predict(const VecS& row) const {
+  vector<double> x(schema_.numFeatures());
+  schema_.encode(row, x.data());
+  const auto& counts = leaves_[nodes_[leafOf(x.data())].left].counts;
+  return schema_.classes()[std::max_element(counts.begin(), counts.end()) - counts.begin()];
+}
+
+Metrics HoeffdingTree::evaluate(const Data& rows) const {
+  Metrics metrics(schema_.classes());
+  for (const auto& row: rows)
+    metrics.add(row.back(), predict(row));
+  return metrics;
+}
+
+Node HoeffdingTree::toNode(uint32_t index) const {
+  const FlatNode& node = nodes_[index];
+  if (node.kind == FlatNode::Leaf)
+    return Node(Leaf(Calculations::toClassCounter(leaves_[node.left].counts, schema_)));
+  const auto column = static_cast<int>(node.feature);
+  const Question question = node.kind == FlatNode::Numeric
+      ? Question(column, node.value)
+      : Question(column, schema_.domains()[column][static_cast<size_t>(node.value)], false);
+  return Node(toNode(node.left), toNode(node.right), question);
+}
+
+Node HoeffdingTree::root() const {
+  return toNode(0);
+}
+
+Forest HoeffdingTree::flatten() const {
+  const Node node = root();
+  return Forest::fromNodes({&node}, schema_, 0);
+}
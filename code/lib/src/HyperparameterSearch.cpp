@@ -0,0 +1,222 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+#include <random>
+#include <set>
+#include <sstream>
+#include "CrossValidator.hpp"
+#include "DecisionTree.hpp"
+#include "Forest.hpp"
+#include "HyperparameterSearch.hpp"
+#include "Memory.hpp"
+#include "ThreadPool.hpp"
+#include "Trace.hpp"
+
+using std::shared_ptr;
+using std::vector;
+
+std::string Hyperparameters::toString() const {
+  std::ostringstream out;
+  out << "trees=" << trees
+      << " maxDepth=" << (tree.maxDepth > 0 ? std::to_string(tree.maxDepth) : "none")
+      << " minLeaf=" << tree.minLeaf
+      << " mtry=" << (tree.mtry > 0 ? std::to_string(tree.mtry) : "all")
+      << " thresholds=" << (tree.randomThresholds ? "random" : "best");
+  return out.str();
+}
+
+namespace {
+
+  /** The combination with mixed-radix number `index` over the dimensions of `space`. */
+  Hyperparameters combination(const SearchSpace& space, size_t index) {
+    Hyperparameters params;
+    params.tree.maxDepth = space.maxDepth[index % space.maxDepth.size()];
+    index /= space.maxDepth.size();
+    params.tree.minLeaf = space.minLeaf[index % space.minLeaf.size()];
+    index /= space.minLeaf.size();
+    params.tree.mtry = space.mtry[index % space.mtry.size()];
+    index /= space.mtry.size();
+    params.tree.randomThresholds = space.randomThresholds[index % space.randomThresholds.size()];
+    index /= space.randomThresholds.size();
+    params.trees = space.trees[index % space.trees.size()];
+    return params;
+  }
+
+  size_t combinations(const SearchSpace& space) {
+    if (space.maxDepth.empty() || space.minLeaf.empty() || space.mtry.empty() || space.randomThresholds.empty()
+        || space.trees.empty())
+      throw std::invalid_argument("Every setting of the search space needs at least one value");
+    return space.maxDepth.size() * space.minLeaf.size() * space.mtry.size() * space.randomThresholds.size()
+           * space.trees.size();
+  }
+
+  /** Better first: higher accuracy, then lower cost. */
+  bool better(const SearchResult& a, const SearchResult& b) {
+    if (a.metrics.accuracy() != b.metrics.accuracy())
+      return a.metrics.accuracy() > b.metrics.accuracy();
+    return a.cost < b.cost;
+  }
+
+}
+
+HyperparameterSearch::HyperparameterSearch(shared_ptr<const DataReader> dr, const SearchOptions& options) :
+  dr_(std::move(dr)),
+  options_(options),
+  train_(),
+  validation_() {
+  if (!(options_.eta > 1.0))
+    throw std::invalid_argument("Successive halving needs eta > 1");
+  const CrossValidator folds(dr_, options_.validationFolds, options_.seed);
+  validation_ = folds.fold(0);
+  for (size_t f = 1; f < folds.numFolds(); f++)
+    train_.insert(train_.end(), folds.fold(f).begin(), folds.fold(f).end());
+  std::mt19937_64 random_number_generator(options_.seed);
+  std::shuffle(train_.begin(), train_.end(), random_number_generator);
+}
+
+vector<Hyperparameters> HyperparameterSearch::grid(const SearchSpace& space) {
+  vector<Hyperparameters> candidates;
+  const size_t total = combinations(space);
+  for (size_t i = 0; i < total; i++)
+    candidates.push_back(combination(space, i));
+  return candidates;
+}
+
+vector<Hyperparameters> HyperparameterSearch::sample(const SearchSpace& space, size_t count, uint64_t seed) {
+  const size_t total = combinations(space);
+  if (count >= total)
+    return grid(space);
+  std::mt19937_64 random_number_generator(seed);
+  std::uniform_int_distribution<size_t> pick(0, total - 1);
+  std::set<size_t> drawn;
+  vector<Hyperparameters> candidates;
+  while (candidates.size() < count) {
+    const size_t index = pick(random_number_generator);
+    if (drawn.insert(index).second)
+      candidates.push_back(combination(space, index));
+  }
+  return candidates;
+}
+
+double HyperparameterSearch::cost(const Hyperparameters& params) const {
+  const auto numFeatures = static_cast<double>(dr_->trainColumns().numFeatures());
+  const double features = params.tree.mtry > 0 ? std::min<double>(params.tree.mtry, numFeatures) : numFeatures;
+  // Drawing a threshold is a scan instead of a sort and a scan.
+  const double perSplit = features / numFeatures * (params.tree.randomThresholds ? 0.25 : 1.0);
+  // Every level of the tree costs a pass over the rows.
+  const double depth = std::max(1.0, std::log2(static_cast<double>(train_.size())));
+  const double levels = params.tree.maxDepth > 0 ? std::min(1.0, params.tree.maxDepth / depth) : 1.0;
+  return std::max(params.trees, 1) * perSplit * levels;
+}
+
+SearchResult HyperparameterSearch::evaluate(const Hyperparameters& params, size_t rows) const {
+  TRACE_SPAN("search_config", "rows", static_cast<int64_t>(rows));
+  const auto start = std::chrono::steady_clock::now();
+  const ColumnStore& store = dr_->trainColumns();
+
+  // Many configurations are trained at the same time, each on one thread.
+  TreeConfig config = params.tree;
+  config.parallelDepth = 0;
+  vector<DecisionTree> trees;
+  if (params.trees <= 1) {
+    Weights weights(store.numRows(), 0);
+    for (size_t i = 0; i < rows; i++)
+      weights[train_[i]] = 1;
+    trees.emplace_back(dr_, weights, config);
+  } else {
+    // Bootstrap samples of the round's rows, seeded as in Bagging.
+    for (int t = 0; t < params.trees; t++) {
+      std::seed_seq seq{options_.seed, static_cast<uint64_t>(t)};
+      std::mt19937_64 random_number_generator(seq);
+      std::uniform_int_distribution<size_t> uniform_sampler(0, rows - 1);
+      Weights weights(store.numRows(), 0);
+      for (size_t i = 0; i < rows; i++)
+        weights[train_[uniform_sampler(random_number_generator)]]++;
+      config.seed = random_number_generator();
+      trees.emplace_back(dr_, weights, config);
+    }
+  }
+
+  vector<const Node*> roots;
+  for (const auto& tree: trees)
+    roots.push_back(&tree.root_);
+  const auto predictions = Forest::fromNodes(roots, store.schema()).predictBatch(store, validation_);
+  SearchResult result;
+  result.params = params;
+  result.rows = rows;
+  result.metrics = Metrics(store.schema().classes());
+  for (size_t i = 0; i < validation_.size(); i++)
+    result.metrics.add(store.labels()[validation_[i]], predictions[i]);
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  result.cost = cost(params);
+  return result;
+}
+
+vector<SearchResult> HyperparameterSearch::run(const vector<Hyperparameters>& candidates) const {
+  if (candidates.empty())
+    return {};
+  const Memory::Phase phase("search");
+  const auto n = static_cast<double>(train_.size());
+  const double eta = options_.eta;
+  // Enough rounds to get from minRows to all rows, but no more than it
+  // takes to get down to one configuration.
+  size_t numRounds = 1;
+  if (n > static_cast<double>(options_.minRows))
+    numRounds += static_cast<size_t>(std::floor(std::log(n / static_cast<double>(options_.minRows)) / std::log(eta)));
+  numRounds = std::min(numRounds, 1 + static_cast<size_t>(std::ceil(std::log(candidates.size()) / std::log(eta))));
+
+  vector<SearchResult> results(candidates.size());
+  vector<size_t> alive(candidates.size());
+  std::iota(alive.begin(), alive.end(), 0);
+  ThreadPool& pool = ThreadPool::shared();
+  for (size_t round = 0; round < numRounds; round++) {
+    TRACE_SPAN("search_round", "round", static_cast<int64_t>(round));
+    const auto rows = static_cast<size_t>(std::round(n / std::pow(eta, numRounds - 1 - round)));
+
+    // Cheapest first, so cheap configurations are done early and their
+    // workers pick up the next ones.
+    std::stable_sort(alive.begin(), alive.end(),
+                     [&](size_t a, size_t b) { return cost(candidates[a]) < cost(candidates[b]); });
+    pool.parallelFor(0, alive.size(), 1, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; i++) {
+        results[alive[i]] = evaluate(candidates[alive[i]], rows);
+        results[alive[i]].round = round;
+      }
+    });
+
+    if (round + 1 < numRounds) {
+      std::sort(alive.begin(), alive.end(), [&](size_t a, size_t b) { return better(results[a], results[b]); });
+      alive.resize(std::max<size_t>(1, static_cast<size_t>(std::ceil(alive.size() / eta))));
+    }
+  }
+
+  std::stable_sort(results.begin(), results.end(), [](const SearchResult& a, const SearchResult& b) {
+    if (a.round != b.round)
+      return a.round > b.round;
+    return better(a, b);
+  });
+  return results;
+}
+
+void HyperparameterSearch::printReport(std::ostream& out, const vector<SearchResult>& results) {
+  const auto flags = out.flags();
+  const auto precision = out.precision();
+  out << std::setw(5) << "rank" << std::setw(7) << "round" << std::setw(9) << "rows" << std::setw(10) << "accuracy"
+      << std::setw(10) << "seconds" << std::setw(8) << "cost" << "  configuration\n";
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto& r = results[i];
+    out << std::setw(5) << i + 1 << std::setw(7) << r.round << std::setw(9) << r.rows << std::fixed
+        << std::setprecision(4) << std::setw(10) << r.metrics.accuracy() << std::setprecision(2) << std::setw(10)
+        << r.seconds << std::setw(8) << r.cost << "  " << r.params.toString() << "\n";
+  }
+  out.flags(flags);
+  out.precision(precision);
+}
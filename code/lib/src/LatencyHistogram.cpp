@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include "LatencyHistogram.hpp"
+
+LatencyHistogram::LatencyHistogram() : buckets_(), count_(0), sum_(0), max_(0) {
+  reset();
+}
+
+void LatencyHistogram::reset() {
+  for (auto& bucket: buckets_)
+    bucket.store(0, std::memory_order_relaxed);
+  count_.store(0);
+  sum_.store(0);
+  max_.store(0);
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t value) {
+  if (value < (uint64_t(1) << subBits))
+    return value;
+  const int msb = 63 - __builtin_clzll(value);
+  const int shift = msb - subBits;
+  const uint64_t sub = (value >> shift) & ((uint64_t(1) << subBits) - 1);
+  return (size_t(shift + 1) << subBits) + sub;
+}
+
+uint64_t LatencyHistogram::upperBound(size_t bucket) {
+  if (bucket < (size_t(1) << subBits))
+    return bucket;
+  const int shift = static_cast<int>(bucket >> subBits) - 1;
+  const uint64_t sub = bucket & ((size_t(1) << subBits) - 1);
+  return (((uint64_t(1) << subBits) | sub) << shift) + ((uint64_t(1) << shift) - 1);
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+  buckets_[bucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(nanoseconds, std::memory_order_relaxed);
+  uint64_t seen = max_.load(std::memory_order_relaxed);
+  while (nanoseconds > seen && !max_.compare_exchange_weak(seen, nanoseconds, std::memory_order_relaxed)) {}
+}
+
+uint64_t LatencyHistogram::count() const {
+  return count_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::max() const {
+  return max_.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::mean() const {
+  const uint64_t n = count();
+  return n == 0 ? 0.0 : static_cast<double>(sum_.load(std::memory_order_relaxed)) / n;
+}
+
+uint64_t LatencyHistogram::percentile(double q) const {
+  const uint64_t n = count();
+  if (n == 0)
+    return 0;
+  const auto rank = static_cast<uint64_t>(q * (n - 1)) + 1;
+  uint64_t seen = 0;
+  for (size_t b = 0; b < numBuckets; b++) {
+    seen += buckets_[b].load(std::memory_order_relaxed);
+    if (seen >= rank)
+      return std::min(upperBound(b), max());
+  }
+  return max();
+}
@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <numeric>
+#include <unordered_set>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "DataReader.hpp"
+#include "Forest.hpp"
+#include "Memory.hpp"
+#include "Node.hpp"
+#include "QuantileSketch.hpp"
+
+using std::vector;
+
+namespace {
+
+  // A make_shared allocation holds the reference counts next to the object.
+  constexpr size_t sharedOverhead = 2 * sizeof(long);
+
+  template<typename T>
+  size_t vectorBytes(const vector<T>& v) {
+    return v.capacity() * sizeof(T);
+  }
+
+  template<typename Map>
+  size_t hashMapBytes(const Map& map) {
+    // Every element is a node with the next pointer and cached hash.
+    size_t bytes = map.bucket_count() * sizeof(void*)
+                   + map.size() * (sizeof(typename Map::value_type) + 2 * sizeof(void*));
+    for (const auto& [key, value]: map)
+      bytes += Memory::bytes(key) - sizeof(key);
+    return bytes;
+  }
+
+  size_t stringsBytes(const VecS& strings) {
+    size_t bytes = vectorBytes(strings);
+    for (const auto& s: strings)
+      bytes += Memory::bytes(s) - sizeof(s);
+    return bytes;
+  }
+
+  /** A hash map from every value to its code, as in Schema. */
+  size_t codesBytes(const VecS& values) {
+    using Entry = std::pair<const std::string, uint32_t>;
+    return values.size() * (sizeof(Entry) + 3 * sizeof(void*)) + stringsBytes(values) - vectorBytes(values);
+  }
+
+  std::atomic<size_t> scratchInUse{0};
+  std::atomic<size_t> scratchPeak{0};
+  std::atomic<size_t> budget{0};
+
+  struct Phases {
+    std::mutex mutex{};
+    size_t open = 0;
+    vector<Memory::PhasePeak> peaks{};
+  };
+
+  Phases& phases() {
+    static Phases instance;
+    return instance;
+  }
+
+  /** Value of a "Name:   1234 kB" line of /proc/self/status, in bytes. */
+  size_t statusBytes(const std::string& name) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+      if (line.rfind(name, 0) == 0)
+        return std::stoul(line.substr(name.size())) * 1024;
+    return 0;
+  }
+
+}
+
+size_t Memory::bytes(const std::string& s) {
+  // Short strings are stored in the object itself.
+  return sizeof(s) + (s.capacity() > 15 ? s.capacity() + 1 : 0);
+}
+
+size_t Memory::bytes(const Data& data) {
+  size_t total = sizeof(data) + vectorBytes(data);
+  for (const auto& row: data)
+    total += stringsBytes(row);
+  return total;
+}
+
+size_t Memory::bytes(const MetaData& meta) {
+  size_t total = sizeof(meta) + stringsBytes(meta.labels) + stringsBytes(meta.columnTypes)
+                 + vectorBytes(meta.domains);
+  for (const auto& domain: meta.domains)
+    total += stringsBytes(domain);
+  return total;
+}
+
+size_t Memory::bytes(const Schema& schema) {
+  size_t total = sizeof(schema) + stringsBytes(schema.names()) + vectorBytes(schema.types())
+                 + vectorBytes(schema.domains()) + bytes(schema.classLabel()) - sizeof(std::string)
+                 + stringsBytes(schema.classes()) + codesBytes(schema.classes());
+  for (const auto& domain: schema.domains())
+    total += stringsBytes(domain) + sizeof(std::unordered_map<std::string, uint32_t>) + codesBytes(domain);
+  return total;
+}
+
+size_t Memory::bytes(const QuantileSketch& sketch) {
+  // Levels grow by pushing values, so they have some slack.
+  return sizeof(sketch) + sketch.numRetained() * sizeof(double) * 3 / 2;
+}
+
+size_t Memory::bytes(const ColumnStore& store) {
+  size_t total = sizeof(store) - sizeof(Schema) + bytes(store.schema()) + vectorBytes(store.labels())
+                 + store.numFeatures() * sizeof(vector<double>);
+  for (size_t col = 0; col < store.numFeatures(); col++)
+    total += vectorBytes(store.column(col)) + bytes(store.sketch(col));
+  return total;
+}
+
+size_t Memory::bytes(const DataReader& dr) {
+  // The test set counts once it is loaded; measuring does not load it.
+  const size_t test = dr.testDataLoaded() ? bytes(dr.testData()) : 0;
+  return sizeof(dr) + bytes(dr.trainData()) + test + bytes(dr.metaData()) + bytes(dr.trainColumns())
+         - sizeof(Data) - sizeof(MetaData) - sizeof(ColumnStore);
+}
+
+size_t Memory::bytes(const Forest& forest) {
+  size_t total = sizeof(forest) + bytes(forest.schema()) + vectorBytes(forest.trees());
+  for (const auto& tree: forest.trees())
+    total += tree.numNodes * sizeof(FlatNode) + tree.numLeafCounts * sizeof(uint32_t);
+  return total;
+}
+
+size_t Memory::addTree(const Node& root, MemoryUsage& usage) {
+  std::unordered_set<const Node*> seen{&root};
+  vector<const Node*> stack{&root};
+  size_t nodes = 0;
+  size_t leaves = 0;
+  while (!stack.empty()) {
+    const Node* node = stack.back();
+    stack.pop_back();
+    // The root is held by value, every other node through a shared pointer.
+    const size_t object = sizeof(Node) + (node == &root ? 0 : sharedOverhead);
+    if (node->leaf() != nullptr) {
+      leaves += object + sizeof(Leaf) + sharedOverhead + hashMapBytes(node->leaf()->predictions());
+      continue;
+    }
+    nodes += object + bytes(node->question().value_) - sizeof(std::string);
+    for (const auto& child: {node->trueBranch(), node->falseBranch()})
+      if (child && seen.insert(child.get()).second)
+        stack.push_back(child.get());
+  }
+  usage.nodes += nodes;
+  usage.leaves += leaves;
+  return nodes + leaves;
+}
+
+void Memory::print(std::ostream& out, const MemoryUsage& usage) {
+  const auto mb = [](size_t bytes) { return static_cast<double>(bytes) / (1 << 20); };
+  const auto flags = out.flags();
+  const auto precision = out.precision();
+  out << std::fixed << std::setprecision(2)
+      << "Memory (MB)\n"
+      << "  dataset  " << std::setw(10) << mb(usage.dataset) << "\n"
+      << "  scratch  " << std::setw(10) << mb(usage.scratch) << "  (peak)\n"
+      << "  nodes    " << std::setw(10) << mb(usage.nodes) << "\n"
+      << "  leaves   " << std::setw(10) << mb(usage.leaves) << "\n"
+      << "  other    " << std::setw(10) << mb(usage.other) << "\n"
+      << "  total    " << std::setw(10) << mb(usage.total()) << "\n";
+  if (!usage.members.empty()) {
+    const size_t sum = std::accumulate(usage.members.begin(), usage.members.end(), size_t{0});
+    const size_t largest = *std::max_element(usage.members.begin(), usage.members.end());
+    out << "  " << usage.members.size() << " members, " << mb(sum) / usage.members.size() << " on average, "
+        << mb(largest) << " at most\n";
+  }
+  out.flags(flags);
+  out.precision(precision);
+}
+
+Memory::Scratch::Scratch(size_t bytes) : bytes_(bytes) {
+  const size_t inUse = ::scratchInUse.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  size_t peak = ::scratchPeak.load(std::memory_order_relaxed);
+  while (inUse > peak && !::scratchPeak.compare_exchange_weak(peak, inUse, std::memory_order_relaxed)) {}
+}
+
+Memory::Scratch::~Scratch() {
+  ::scratchInUse.fetch_sub(bytes_, std::memory_order_relaxed);
+}
+
+size_t Memory::scratchInUse() {
+  return ::scratchInUse.load(std::memory_order_relaxed);
+}
+
+size_t Memory::scratchPeak() {
+  return ::scratchPeak.load(std::memory_order_relaxed);
+}
+
+void Memory::resetScratchPeak() {
+  ::scratchPeak.store(::scratchInUse.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+size_t Memory::currentRss() {
+  std::ifstream statm("/proc/self/statm");
+  size_t size = 0;
+  size_t resident = 0;
+  if (!(statm >> size >> resident))
+    return 0;
+  return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+size_t Memory::peakRss() {
+  const size_t peak = statusBytes("VmHWM:");
+  if (peak > 0)
+    return peak;
+  struct rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<size_t>(usage.ru_maxrss) * 1024;
+}
+
+void Memory::resetPeakRss() {
+  std::ofstream clear("/proc/self/clear_refs");
+  if (clear)
+    clear << "5";
+}
+
+Memory::Phase::Phase(std::string name) : name_(std::move(name)) {
+  Phases& p = phases();
+  std::lock_guard<std::mutex> lock(p.mutex);
+  if (p.open++ == 0)
+    resetPeakRss();
+}
+
+Memory::Phase::~Phase() {
+  const size_t peak = peakRss();
+  Phases& p = phases();
+  std::lock_guard<std::mutex> lock(p.mutex);
+  p.open--;
+  for (auto& phase: p.peaks) {
+    if (phase.name == name_) {
+      phase.calls++;
+      phase.peakRss = std::max(phase.peakRss, peak);
+      return;
+    }
+  }
+  p.peaks.push_back(PhasePeak{name_, 1, peak});
+}
+
+vector<Memory::PhasePeak> Memory::phasePeaks() {
+  Phases& p = phases();
+  std::lock_guard<std::mutex> lock(p.mutex);
+  return p.peaks;
+}
+
+void Memory::clearPhases() {
+  Phases& p = phases();
+  std::lock_guard<std::mutex> lock(p.mutex);
+  p.peaks.clear();
+}
+
+void Memory::printPhases(std::ostream& out) {
+  const auto flags = out.flags();
+  const auto precision = out.precision();
+  out << "Peak RSS per phase (MB)\n" << std::fixed << std::setprecision(2);
+  for (const auto& phase: phasePeaks())
+    out << "  " << std::left << std::setw(12) << phase.name << std::right << std::setw(10)
+        << static_cast<double>(phase.peakRss) / (1 << 20) << "  (" << phase.calls << " calls)\n";
+  out.flags(flags);
+  out.precision(precision);
+}
+
+void Memory::setBudget(size_t bytes) {
+  ::budget.store(bytes, std::memory_order_relaxed);
+}
+
+size_t Memory::budget() {
+  return ::budget.load(std::memory_order_relaxed);
+}
+
+void Memory::checkBudget(const std::string& what, size_t additional) {
+  const size_t limit = budget();
+  if (limit == 0)
+    return;
+  const size_t rss = currentRss();
+  if (rss + additional <= limit)
+    return;
+  const auto mb = [](size_t bytes) { return std::to_string(bytes >> 20) + " MB"; };
+  throw BudgetExceeded("Memory budget of " + mb(limit) + " exceeded by " + what + ": " + mb(rss) + " in use, "
+                       + "about " + mb(additional) + " more needed");
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <iomanip>
+#include "Metrics.hpp"
+
+Metrics::Metrics(const VecS& classes) {
+  for (const auto& label: classes)
+    classIndex(label);
+}
+
+size_t Metrics::classIndex(const std::string& label) {
+  if (const auto it = index_.find(label); it != std::end(index_))
+    return it->second;
+
+  const size_t n = classes_.size();
+  std::vector<size_t> grown((n + 1) * (n + 1), 0);
+  for (size_t a = 0; a < n; a++)
+    std::copy_n(confusion_.begin() + a * n, n, grown.begin() + a * (n + 1));
+  confusion_ = std::move(grown);
+  classes_.push_back(label);
+  index_[label] = n;
+  return n;
+}
+
+void Metrics::add(const std::string& actual, const std::string& predicted) {
+  const size_t a = classIndex(actual);
+  add(a, classIndex(predicted));
+}
+
+void Metrics::add(size_t actual, size_t predicted) {
+  confusion_[actual * classes_.size() + predicted]++;
+  total_++;
+  if (actual == predicted)
+    correct_++;
+}
+
+void Metrics::merge(const Metrics& other) {
+  std::vector<size_t> mapping;
+  mapping.reserve(other.classes_.size());
+  for (const auto& label: other.classes_)
+    mapping.push_back(classIndex(label));
+
+  const size_t n = classes_.size();
+  const size_t m = other.classes_.size();
+  for (size_t a = 0; a < m; a++)
+    for (size_t p = 0; p < m; p++)
+      confusion_[mapping[a] * n + mapping[p]] += other.confusion_[a * m + p];
+  total_ += other.total_;
+  correct_ += other.correct_;
+}
+
+double Metrics::accuracy() const {
+  return total_ == 0 ? 0.0 : static_cast<double>(correct_) / total_;
+}
+
+double Metrics::precision(size_t c) const {
+  size_t predicted = 0;
+  for (size_t a = 0; a < classes_.size(); a++)
+    predicted += count(a, c);
+  return predicted == 0 ? 0.0 : static_cast<double>(count(c, c)) / predicted;
+}
+
+double Metrics::recall(size_t c) const {
+  size_t actual = 0;
+  for (size_t p = 0; p < classes_.size(); p++)
+    actual += count(c, p);
+  return actual == 0 ? 0.0 : static_cast<double>(count(c, c)) / actual;
+}
+
+double Metrics::error(size_t c) const {
+  size_t actual = 0;
+  for (size_t p = 0; p < classes_.size(); p++)
+    actual += count(c, p);
+  return actual == 0 ? 0.0 : 1.0 - static_cast<double>(count(c, c)) / actual;
+}
+
+void Metrics::print(std::ostream& os) const {
+  os << "Total accuracy: " << accuracy() << " (" << correct_ << "/" << total_ << ")\n";
+  os << std::left << std::setw(20) << "class" << std::setw(12) << "precision" << std::setw(12) << "recall"
+     << "error\n";
+  for (size_t c = 0; c < classes_.size(); c++) {
+    os << std::setw(20) << classes_[c] << std::setw(12) << precision(c) << std::setw(12) << recall(c)
+       << error(c) << "\n";
+  }
+  os << "Confusion matrix (rows: actual, columns: predicted)\n";
+  for (size_t a = 0; a < classes_.size(); a++) {
+    for (size_t p = 0; p < classes_.size(); p++)
+      os << std::right << std::setw(8) << count(a, p);
+    os << "\n";
+  }
+  os << std::left;
+}
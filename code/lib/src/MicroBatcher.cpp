@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <sstream>
+#include "MicroBatcher.hpp"
+
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+
+MicroBatcher::MicroBatcher(Predictor predictor, size_t maxBatchSize, std::chrono::microseconds maxWait) :
+  predictor_(std::move(predictor)),
+  maxBatchSize_(std::max<size_t>(maxBatchSize, 1)),
+  maxWait_(maxWait),
+  pending_(),
+  mutex_(),
+  available_(),
+  idle_(),
+  busy_(false),
+  stopping_(false),
+  latency_(),
+  requests_(0),
+  batches_(0),
+  started_(Clock::now()),
+  worker_(&MicroBatcher::run, this) {}
+
+MicroBatcher::~MicroBatcher() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  available_.notify_one();
+  worker_.join();
+}
+
+void MicroBatcher::submit(VecS row, Callback done) {
+  bool wake;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.push_back(Request{std::move(row), std::move(done), Clock::now()});
+    // The batching thread only needs a nudge for the first request of a
+    // batch and for the one that fills it up.
+    wake = pending_.size() == 1 || pending_.size() >= maxBatchSize_;
+  }
+  if (wake)
+    available_.notify_one();
+}
+
+void MicroBatcher::drain() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this]() { return pending_.empty() && !busy_; });
+}
+
+void MicroBatcher::run() {
+  std::vector<Request> batch;
+  Data rows;
+  VecS predictions;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      busy_ = false;
+      if (pending_.empty())
+        idle_.notify_all();
+      available_.wait(lock, [this]() { return stopping_ || !pending_.empty(); });
+      if (pending_.empty())
+        return;
+
+      const auto deadline = pending_.front().arrived + maxWait_;
+      available_.wait_until(lock, deadline, [this]() {
+        return stopping_ || pending_.size() >= maxBatchSize_;
+      });
+
+      const size_t n = std::min(pending_.size(), maxBatchSize_);
+      batch.clear();
+      for (size_t i = 0; i < n; i++) {
+        batch.push_back(std::move(pending_.front()));
+        pending_.pop_front();
+      }
+      busy_ = true;
+    }
+
+    rows.clear();
+    for (auto& request: batch)
+      rows.push_back(std::move(request.row));
+    predictions.assign(rows.size(), std::string());
+    predictor_(rows, predictions);
+
+    for (size_t i = 0; i < batch.size(); i++) {
+      batch[i].done(predictions[i]);
+      latency_.record(duration_cast<nanoseconds>(Clock::now() - batch[i].arrived).count());
+    }
+    requests_.fetch_add(batch.size());
+    batches_.fetch_add(1);
+  }
+}
+
+std::string MicroBatcher::summary() const {
+  const double seconds = uptime();
+  const uint64_t n = requests();
+  const uint64_t b = batches();
+  std::ostringstream os;
+  os << "requests=" << n
+     << " batches=" << b
+     << " avg_batch=" << (b == 0 ? 0.0 : static_cast<double>(n) / b)
+     << " throughput=" << (seconds > 0 ? n / seconds : 0.0) << "/s"
+     << " p50=" << latency_.percentile(0.50) / 1000.0 << "us"
+     << " p99=" << latency_.percentile(0.99) / 1000.0 << "us"
+     << " max=" << latency_.max() / 1000.0 << "us";
+  return os.str();
+}
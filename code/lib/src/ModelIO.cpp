@@ -0,0 +1,435 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ModelIO.hpp"
+
+using std::string;
+using std::vector;
+
+namespace {
+
+  constexpr char magic[8] = {'F', 'C', 'A', 'R', 'T', 'M', 'D', 'L'};
+  constexpr size_t headerSize = 72;
+  constexpr size_t treeEntrySize = 32;
+  constexpr uint32_t ensembleFlag = 1;
+  constexpr char compactMagic[8] = {'F', 'C', 'A', 'R', 'T', 'C', 'M', 'P'};
+
+  bool hostIsLittleEndian() {
+    const uint16_t probe = 1;
+    uint8_t first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+  }
+
+  class Writer {
+    public:
+      void u8(uint8_t v) { bytes_.push_back(static_cast<char>(v)); }
+      void u32(uint32_t v) { for (int i = 0; i < 4; i++) u8(static_cast<uint8_t>(v >> (8 * i))); }
+      void u64(uint64_t v) { for (int i = 0; i < 8; i++) u8(static_cast<uint8_t>(v >> (8 * i))); }
+      void f64(double v) { uint64_t bits; std::memcpy(&bits, &v, 8); u64(bits); }
+      void str(const string& s) { u32(static_cast<uint32_t>(s.size())); bytes_.append(s); }
+      void align(size_t to) { while (bytes_.size() % to != 0) u8(0); }
+      void patch64(size_t at, uint64_t v) { for (int i = 0; i < 8; i++) bytes_[at + i] = static_cast<char>(v >> (8 * i)); }
+      inline size_t size() const { return bytes_.size(); }
+      inline const string& bytes() const { return bytes_; }
+    private:
+      string bytes_{};
+  };
+
+  /** Whether `count` elements of `elemSize` bytes at `offset` fit in `size` bytes, without overflow. */
+  bool fits(uint64_t offset, uint64_t count, uint64_t elemSize, uint64_t size) {
+    return offset <= size && count <= (size - offset) / elemSize;
+  }
+
+  class Reader {
+    public:
+      Reader(const uint8_t* data, size_t size, uint64_t pos) : data_(data), size_(size), pos_(pos) {
+        if (pos > size)
+          throw std::runtime_error("Model file is truncated");
+      }
+      uint8_t u8() { need(1); return data_[pos_++]; }
+      uint32_t u32() { need(4); uint32_t v = 0; for (int i = 0; i < 4; i++) v |= uint32_t(data_[pos_++]) << (8 * i); return v; }
+      uint64_t u64() { need(8); uint64_t v = 0; for (int i = 0; i < 8; i++) v |= uint64_t(data_[pos_++]) << (8 * i); return v; }
+      double f64() { const uint64_t bits = u64(); double v; std::memcpy(&v, &bits, 8); return v; }
+      string str() { const uint32_t n = u32(); need(n); string s(reinterpret_cast<const char*>(data_ + pos_), n); pos_ += n; return s; }
+      inline size_t remaining() const { return size_ - pos_; }
+    private:
+      void need(size_t n) const {
+        if (n > size_ - pos_)
+          throw std::runtime_error("Model file is truncated");
+      }
+      const uint8_t* data_;
+      size_t size_;
+      size_t pos_;
+  };
+
+  /**
+   * Read-only private mapping of a whole file, unmapped on destruction.
+   */
+  struct MappedFile {
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    explicit MappedFile(const string& filename) : data(nullptr), size(0) {
+      const int fd = ::open(filename.c_str(), O_RDONLY);
+      if (fd < 0)
+        throw std::runtime_error("Can't open file: " + filename);
+      struct stat st;
+      if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        throw std::runtime_error("Can't read model file: " + filename);
+      }
+      size = static_cast<size_t>(st.st_size);
+      void* addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      ::close(fd);
+      if (addr == MAP_FAILED)
+        throw std::runtime_error("Can't map model file: " + filename);
+      data = static_cast<const uint8_t*>(addr);
+    }
+
+    ~MappedFile() {
+      if (data != nullptr)
+        ::munmap(const_cast<uint8_t*>(data), size);
+    }
+
+    const uint8_t* data;
+    size_t size;
+  };
+
+  struct TreeEntry {
+    uint64_t nodesOffset;
+    uint64_t countsOffset;
+    uint32_t numNodes;
+    uint32_t numCounts;
+  };
+
+  void writeSchema(Writer& out, const Schema& schema) {
+    out.str(schema.classLabel());
+    for (size_t col = 0; col < schema.numFeatures(); col++) {
+      out.u8(static_cast<uint8_t>(schema.types()[col]));
+      out.str(schema.names()[col]);
+      out.u32(static_cast<uint32_t>(schema.domains()[col].size()));
+      for (const auto& value: schema.domains()[col])
+        out.str(value);
+    }
+    out.u32(static_cast<uint32_t>(schema.numClasses()));
+    for (const auto& label: schema.classes())
+      out.str(label);
+  }
+
+  /** A count of elements of `elementSize` bytes, checked against the bytes left. */
+  size_t readCount(Reader& in, size_t elementSize) {
+    const uint32_t count = in.u32();
+    if (uint64_t(count) * elementSize > in.remaining())
+      throw std::runtime_error("Model file is truncated");
+    return count;
+  }
+
+  Schema readSchema(Reader& in, uint32_t numFeatures, uint32_t numClasses, const string& filename) {
+    Schema schema;
+    string classLabel = in.str();
+    for (uint32_t col = 0; col < numFeatures; col++) {
+      const auto type = static_cast<Schema::ColumnType>(in.u8());
+      string name = in.str();
+      VecS domain(readCount(in, sizeof(uint32_t)));
+      for (auto& value: domain)
+        value = in.str();
+      schema.addColumn(std::move(name), type, std::move(domain));
+    }
+    VecS classes(readCount(in, sizeof(uint32_t)));
+    for (auto& label: classes)
+      label = in.str();
+    if (classes.size() != numClasses)
+      throw std::runtime_error("Model file is corrupt: " + filename);
+    schema.setClasses(std::move(classLabel), std::move(classes));
+    return schema;
+  }
+
+  /**
+   * Write to a temporary file and rename it over `filename`, so a process
+   * that maps the old file keeps reading it (see `load`) and no reader ever
+   * sees a partly written model.
+   */
+  void writeFile(const Writer& out, const string& filename) {
+    const string temporary = filename + ".tmp";
+    {
+      std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+      if (!file)
+        throw std::runtime_error("Can't open file: " + temporary);
+      file.write(out.bytes().data(), static_cast<std::streamsize>(out.size()));
+      file.close();
+      if (!file) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Can't write model file: " + temporary);
+      }
+    }
+    if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+      std::remove(temporary.c_str());
+      throw std::runtime_error("Can't replace model file: " + filename);
+    }
+  }
+
+  void verifyTree(const FlatTree& tree, const Schema& schema) {
+    const size_t numClasses = schema.numClasses();
+    for (uint32_t i = 0; i < tree.numNodes; i++) {
+      const FlatNode& node = tree.nodes[i];
+      bool valid;
+      if (node.kind == FlatNode::Leaf) {
+        valid = size_t(node.left) + numClasses <= tree.numLeafCounts && node.right < numClasses;
+      } else {
+        valid = node.kind <= FlatNode::Categorical && node.feature < schema.numFeatures() && node.left > i
+                && node.right > i && node.left < tree.numNodes && node.right < tree.numNodes;
+        // A category code indexes the column's domain.
+        if (valid && node.kind == FlatNode::Categorical)
+          valid = node.value >= 0 && node.value < schema.domains()[node.feature].size()
+                  && node.value == static_cast<double>(static_cast<uint32_t>(node.value));
+      }
+      if (!valid)
+        throw std::runtime_error("Model file contains an invalid node");
+    }
+  }
+
+}
+
+void ModelIO::save(const Forest& forest, const string& filename) {
+  const Schema& schema = forest.schema();
+  Writer out;
+  for (char c: magic)
+    out.u8(static_cast<uint8_t>(c));
+  out.u32(version);
+  out.u32(forest.numTrees() > 1 ? ensembleFlag : 0);
+  out.u32(static_cast<uint32_t>(forest.numTrees()));
+  out.u32(static_cast<uint32_t>(schema.numClasses()));
+  out.u32(static_cast<uint32_t>(schema.numFeatures()));
+  out.u32(0);
+  out.u64(forest.seed());
+  const size_t offsets = out.size();
+  for (int i = 0; i < 4; i++)
+    out.u64(0);
+
+  const size_t schemaOffset = out.size();
+  writeSchema(out, schema);
+  const size_t schemaSize = out.size() - schemaOffset;
+
+  out.align(8);
+  const size_t tableOffset = out.size();
+  for (size_t t = 0; t < forest.numTrees(); t++)
+    for (size_t i = 0; i < treeEntrySize; i++)
+      out.u8(0);
+
+  for (size_t t = 0; t < forest.numTrees(); t++) {
+    const FlatTree& tree = forest.trees()[t];
+    out.align(8);
+    const size_t nodesOffset = out.size();
+    for (uint32_t i = 0; i < tree.numNodes; i++) {
+      const FlatNode& node = tree.nodes[i];
+      out.u32(node.feature);
+      out.u32(node.kind);
+      out.f64(node.value);
+      out.u32(node.left);
+      out.u32(node.right);
+    }
+    const size_t countsOffset = out.size();
+    for (uint32_t i = 0; i < tree.numLeafCounts; i++)
+      out.u32(tree.leafCounts[i]);
+
+    const size_t entry = tableOffset + t * treeEntrySize;
+    out.patch64(entry, nodesOffset);
+    out.patch64(entry + 8, countsOffset);
+    out.patch64(entry + 16, uint64_t(tree.numNodes) | (uint64_t(tree.numLeafCounts) << 32));
+  }
+  out.align(8);
+
+  out.patch64(offsets, schemaOffset);
+  out.patch64(offsets + 8, schemaSize);
+  out.patch64(offsets + 16, tableOffset);
+  out.patch64(offsets + 24, out.size());
+
+  writeFile(out, filename);
+}
+
+Forest ModelIO::load(const string& filename, bool verify) {
+  auto mapped = std::make_shared<MappedFile>(filename);
+  const uint8_t* data = mapped->data;
+  const size_t size = mapped->size;
+
+  if (size < headerSize || std::memcmp(data, magic, sizeof(magic)) != 0)
+    throw std::runtime_error("Not a model file: " + filename);
+
+  Reader header(data, size, sizeof(magic));
+  const uint32_t fileVersion = header.u32();
+  if (fileVersion != version)
+    throw std::runtime_error("Unsupported model file version " + std::to_string(fileVersion));
+  header.u32();  // flags
+  const uint32_t numTrees = header.u32();
+  const uint32_t numClasses = header.u32();
+  const uint32_t numFeatures = header.u32();
+  header.u32();
+  const uint64_t seed = header.u64();
+  const uint64_t schemaOffset = header.u64();
+  header.u64();  // schema size
+  const uint64_t tableOffset = header.u64();
+  const uint64_t fileSize = header.u64();
+  if (fileSize != size || tableOffset % 8 != 0 || !fits(tableOffset, numTrees, treeEntrySize, size))
+    throw std::runtime_error("Model file is corrupt: " + filename);
+
+  Reader in(data, size, schemaOffset);
+  Schema schema = readSchema(in, numFeatures, numClasses, filename);
+
+  vector<TreeEntry> entries(numTrees);
+  Reader table(data, size, tableOffset);
+  for (auto& entry: entries) {
+    entry.nodesOffset = table.u64();
+    entry.countsOffset = table.u64();
+    entry.numNodes = table.u32();
+    entry.numCounts = table.u32();
+    table.u64();
+    if (entry.nodesOffset % 8 != 0 || entry.countsOffset % 4 != 0 || entry.numNodes == 0
+        || !fits(entry.nodesOffset, entry.numNodes, sizeof(FlatNode), size)
+        || !fits(entry.countsOffset, entry.numCounts, sizeof(uint32_t), size))
+      throw std::runtime_error("Model file is corrupt: " + filename);
+  }
+
+  vector<FlatTree> trees;
+  trees.reserve(numTrees);
+  std::shared_ptr<const void> storage;
+  if (hostIsLittleEndian()) {
+    for (const auto& entry: entries) {
+      trees.push_back(FlatTree{reinterpret_cast<const FlatNode*>(data + entry.nodesOffset), entry.numNodes,
+                               reinterpret_cast<const uint32_t*>(data + entry.countsOffset), entry.numCounts});
+    }
+    storage = mapped;
+  } else {
+    // The on-disk layout is little-endian, so other hosts decode a copy.
+    auto owned = std::make_shared<std::pair<vector<vector<FlatNode>>, vector<vector<uint32_t>>>>();
+    for (const auto& entry: entries) {
+      Reader nodesIn(data, size, entry.nodesOffset);
+      vector<FlatNode> nodes(entry.numNodes);
+      for (auto& node: nodes)
+        node = FlatNode{nodesIn.u32(), nodesIn.u32(), nodesIn.f64(), nodesIn.u32(), nodesIn.u32()};
+      Reader countsIn(data, size, entry.countsOffset);
+      vector<uint32_t> counts(entry.numCounts);
+      for (auto& count: counts)
+        count = countsIn.u32();
+      owned->first.push_back(std::move(nodes));
+      owned->second.push_back(std::move(counts));
+      trees.push_back(FlatTree{owned->first.back().data(), entry.numNodes,
+                               owned->second.back().data(), entry.numCounts});
+    }
+    storage = owned;
+  }
+
+  if (verify)
+    for (const auto& tree: trees)
+      verifyTree(tree, schema);
+
+  return Forest(std::move(schema), std::move(trees), std::move(storage), seed);
+}
+
+void ModelIO::saveCompact(const CompactForest& forest, const string& filename) {
+  const Schema& schema = forest.schema();
+  Writer out;
+  for (char c: compactMagic)
+    out.u8(static_cast<uint8_t>(c));
+  out.u32(compactVersion);
+  out.u32(static_cast<uint32_t>(forest.numTrees()));
+  out.u32(static_cast<uint32_t>(schema.numClasses()));
+  out.u32(static_cast<uint32_t>(schema.numFeatures()));
+  out.u64(forest.seed());
+  out.f64(forest.thresholdError());
+  out.f64(forest.distributionError());
+  writeSchema(out, schema);
+
+  for (const auto& codebook: forest.codebooks()) {
+    out.u32(static_cast<uint32_t>(codebook.size()));
+    for (const auto threshold: codebook)
+      out.f64(threshold);
+  }
+  for (const auto root: forest.roots())
+    out.u32(root);
+  out.u32(static_cast<uint32_t>(forest.nodes().size()));
+  for (const auto& node: forest.nodes()) {
+    out.u32(node.left);
+    out.u32(node.right);
+    out.u32(uint32_t(node.feature) | (uint32_t(node.value) << 16));
+  }
+  out.u32(static_cast<uint32_t>(forest.distributions().size()));
+  for (const auto p: forest.distributions()) {
+    out.u8(static_cast<uint8_t>(p));
+    out.u8(static_cast<uint8_t>(p >> 8));
+  }
+  writeFile(out, filename);
+}
+
+CompactForest ModelIO::loadCompact(const string& filename) {
+  const MappedFile mapped(filename);
+  if (mapped.size < sizeof(compactMagic) || std::memcmp(mapped.data, compactMagic, sizeof(compactMagic)) != 0)
+    throw std::runtime_error("Not a compact model file: " + filename);
+
+  Reader in(mapped.data, mapped.size, sizeof(compactMagic));
+  const uint32_t fileVersion = in.u32();
+  if (fileVersion != compactVersion)
+    throw std::runtime_error("Unsupported model file version " + std::to_string(fileVersion));
+  const uint32_t numTrees = in.u32();
+  const uint32_t numClasses = in.u32();
+  const uint32_t numFeatures = in.u32();
+  const uint64_t seed = in.u64();
+  const double thresholdError = in.f64();
+  const double distributionError = in.f64();
+  Schema schema = readSchema(in, numFeatures, numClasses, filename);
+
+  vector<vector<double>> codebooks(numFeatures);
+  for (auto& codebook: codebooks) {
+    codebook.resize(readCount(in, sizeof(double)));
+    for (auto& threshold: codebook)
+      threshold = in.f64();
+  }
+  if (uint64_t(numTrees) * sizeof(uint32_t) > in.remaining())
+    throw std::runtime_error("Model file is truncated");
+  vector<uint32_t> roots(numTrees);
+  for (auto& root: roots)
+    root = in.u32();
+  vector<CompactNode> nodes(readCount(in, 3 * sizeof(uint32_t)));
+  for (auto& node: nodes) {
+    node.left = in.u32();
+    node.right = in.u32();
+    const uint32_t test = in.u32();
+    node.feature = static_cast<uint16_t>(test);
+    node.value = static_cast<uint16_t>(test >> 16);
+  }
+  vector<uint16_t> distributions(readCount(in, 2));
+  for (auto& p: distributions) {
+    const uint8_t low = in.u8();
+    p = static_cast<uint16_t>(low | (in.u8() << 8));
+  }
+
+  // Children precede their parents in the pool, so every path ends in a leaf.
+  for (uint32_t i = 0; i < nodes.size(); i++) {
+    const CompactNode& node = nodes[i];
+    const uint32_t feature = node.feature & ~CompactNode::categoricalBit;
+    const bool valid = node.isLeaf()
+      ? size_t(node.left) + numClasses <= distributions.size() && node.value < numClasses
+      : feature < numFeatures && node.left < i && node.right < i
+        && ((node.feature & CompactNode::categoricalBit) ? node.value < schema.domains()[feature].size()
+                                                          : node.value < codebooks[feature].size());
+    if (!valid)
+      throw std::runtime_error("Model file contains an invalid node");
+  }
+  for (const auto root: roots)
+    if (root >= nodes.size())
+      throw std::runtime_error("Model file is corrupt: " + filename);
+
+  return CompactForest(std::move(schema), std::move(codebooks), std::move(roots), std::move(nodes),
+                       std::move(distributions), seed, thresholdError, distributionError);
+}
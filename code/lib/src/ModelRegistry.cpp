@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "ModelRegistry.hpp"
+
+ModelRegistry::Handle::Handle(Slot* slot, const Forest* model) :
+  slot_(slot),
+  model_(model) {}
+
+ModelRegistry::Handle::Handle(Handle&& other) noexcept :
+  slot_(other.slot_),
+  model_(other.model_) {
+  other.slot_ = nullptr;
+  other.model_ = nullptr;
+}
+
+ModelRegistry::Handle::~Handle() {
+  if (slot_ == nullptr)
+    return;
+  slot_->hazard.store(nullptr, std::memory_order_release);
+  slot_->used.store(false, std::memory_order_release);
+}
+
+ModelRegistry::ModelRegistry() : ModelRegistry(nullptr) {}
+
+ModelRegistry::ModelRegistry(std::shared_ptr<const Forest> model) :
+  slots_(),
+  current_(model.get()),
+  version_(model ? 1 : 0),
+  writer_(),
+  owner_(std::move(model)),
+  retired_(),
+  numRetired_(0) {}
+
+ModelRegistry::Slot* ModelRegistry::claimSlot() const {
+  // Start at a per-thread position so readers rarely compete for a slot.
+  size_t i = std::hash<std::thread::id>()(std::this_thread::get_id()) % maxReaders;
+  for (size_t n = 0; n < maxReaders; n++, i = (i + 1) % maxReaders) {
+    bool expected = false;
+    if (!slots_[i].used.load(std::memory_order_relaxed)
+        && slots_[i].used.compare_exchange_strong(expected, true, std::memory_order_acquire))
+      return &slots_[i];
+  }
+  throw std::runtime_error("More than " + std::to_string(maxReaders) + " readers hold a model");
+}
+
+ModelRegistry::Handle ModelRegistry::acquire() const {
+  Slot* slot = claimSlot();
+  const Forest* model = current_.load(std::memory_order_acquire);
+  while (true) {
+    slot->hazard.store(model, std::memory_order_seq_cst);
+    // Once the hazard is visible, a writer that retires `model` afterwards
+    // will see it; if it was retired before, the pointer is no longer current.
+    const Forest* check = current_.load(std::memory_order_seq_cst);
+    if (check == model)
+      break;
+    model = check;
+  }
+  return Handle(slot, model);
+}
+
+void ModelRegistry::publish(std::shared_ptr<const Forest> model) {
+  std::lock_guard<std::mutex> lock(writer_);
+  current_.store(model.get(), std::memory_order_seq_cst);
+  if (owner_)
+    retired_.push_back(std::move(owner_));
+  owner_ = std::move(model);
+  version_.fetch_add(1);
+  numRetired_.store(retired_.size());
+  reclaimLocked();
+}
+
+void ModelRegistry::reclaim() const {
+  std::lock_guard<std::mutex> lock(writer_);
+  reclaimLocked();
+}
+
+void ModelRegistry::reclaimLocked() const {
+  std::vector<const Forest*> pinned;
+  for (const auto& slot: slots_)
+    if (const Forest* model = slot.hazard.load(std::memory_order_seq_cst); model != nullptr)
+      pinned.push_back(model);
+
+  auto stillPinned = [&pinned](const std::shared_ptr<const Forest>& model) {
+    return std::find(pinned.begin(), pinned.end(), model.get()) != pinned.end();
+  };
+  retired_.erase(std::stable_partition(retired_.begin(), retired_.end(), stillPinned), retired_.end());
+  numRetired_.store(retired_.size());
+}
@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "PerfCounters.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using PerfCounters::Counter;
+using PerfCounters::Sample;
+using PerfCounters::numCounters;
+
+namespace {
+
+  const char* const counterNames[numCounters] = {"cycles", "instructions", "L1d misses", "LLC misses",
+                                                 "branch misses"};
+
+  struct Totals {
+    uint64_t calls = 0;
+    uint64_t nanoseconds = 0;
+    Sample counters{};
+
+    void add(const Totals& other) {
+      calls += other.calls;
+      nanoseconds += other.nanoseconds;
+      for (size_t c = 0; c < numCounters; c++)
+        counters[c] += other.counters[c];
+    }
+  };
+
+  /**
+   * Counters of one thread, read as one group so they cover the same
+   * instructions. The totals outlive the thread, the counters do not.
+   */
+  struct ThreadCounters {
+    std::mutex mutex{};
+    int leader = -1;
+    std::vector<int> fds{};
+    std::vector<Counter> order{};    // counter of every value in a group read
+    int64_t depth = PerfCounters::noDepth;
+    PerfCounters::Scope* current = nullptr;
+    std::map<std::pair<const char*, int64_t>, Totals> totals{};
+
+    void close() {
+      std::lock_guard<std::mutex> lock(mutex);
+#ifdef __linux__
+      for (const int fd: fds)
+        ::close(fd);
+#endif
+      fds.clear();
+      order.clear();
+      leader = -1;
+    }
+  };
+
+  struct Registry {
+    std::mutex mutex{};
+    std::vector<std::shared_ptr<ThreadCounters>> threads{};
+    std::array<bool, numCounters> opened{};
+    std::string error{};             // why the first counter that failed did not open
+  };
+
+  Registry& registry() {
+    static Registry instance;
+    return instance;
+  }
+
+#ifdef __linux__
+  perf_event_attr attributes(Counter counter) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    switch (counter) {
+      case Counter::Cycles:
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+      case Counter::Instructions:
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+      case Counter::L1Misses:
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                      | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        break;
+      case Counter::LlcMisses:
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+      default:
+        attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+        break;
+    }
+    // User space only, which unprivileged processes may count by default.
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return attr;
+  }
+#endif
+
+  void open(ThreadCounters& thread) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (size_t c = 0; c < numCounters; c++) {
+      const auto counter = static_cast<Counter>(c);
+#ifdef __linux__
+      perf_event_attr attr = attributes(counter);
+      const auto fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, thread.leader, 0));
+      if (fd >= 0) {
+        if (thread.leader < 0)
+          thread.leader = fd;
+        thread.fds.push_back(fd);
+        thread.order.push_back(counter);
+        r.opened[c] = true;
+        continue;
+      }
+      const std::string reason = std::strerror(errno);
+#else
+      const std::string reason = "not supported on this platform";
+#endif
+      if (r.error.empty())
+        r.error = std::string(counterNames[c]) + ": " + reason;
+    }
+  }
+
+  ThreadCounters& threadCounters() {
+    // Closes the counters of a thread when it exits.
+    struct Owner {
+      std::shared_ptr<ThreadCounters> counters;
+      ~Owner() { counters->close(); }
+    };
+    thread_local Owner owner{[]() {
+      auto counters = std::make_shared<ThreadCounters>();
+      open(*counters);
+      Registry& r = registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      r.threads.push_back(counters);
+      return counters;
+    }()};
+    return *owner.counters;
+  }
+
+  /** Current counts of the thread, scaled up for the time the group was multiplexed out. */
+  void read(const ThreadCounters& thread, Sample& sample) {
+    sample.fill(0);
+#ifdef __linux__
+    if (thread.leader < 0)
+      return;
+    struct {
+      uint64_t nr;
+      uint64_t enabled;
+      uint64_t running;
+      uint64_t values[numCounters];
+    } group{};
+    if (::read(thread.leader, &group, sizeof(group)) <= 0 || group.running == 0)
+      return;
+    const double scale = static_cast<double>(group.enabled) / static_cast<double>(group.running);
+    for (size_t i = 0; i < group.nr && i < thread.order.size(); i++)
+      sample[thread.order[i]] = static_cast<uint64_t>(static_cast<double>(group.values[i]) * scale);
+#endif
+  }
+
+  void printTable(std::ostream& out, const std::map<std::pair<std::string, int64_t>, Totals>& rows,
+                  const std::array<bool, numCounters>& opened, bool depths) {
+    out << std::left << std::setw(18) << "phase" << std::right;
+    if (depths)
+      out << std::setw(6) << "depth";
+    out << std::setw(10) << "calls" << std::setw(12) << "time (ms)";
+    for (const auto name: counterNames)
+      out << std::setw(15) << name;
+    out << std::setw(7) << "IPC" << "\n";
+
+    for (const auto& [key, totals]: rows) {
+      out << std::left << std::setw(18) << key.first << std::right;
+      if (depths)
+        out << std::setw(6) << key.second;
+      out << std::setw(10) << totals.calls << std::setw(12) << std::fixed << std::setprecision(2)
+          << static_cast<double>(totals.nanoseconds) / 1e6;
+      for (size_t c = 0; c < numCounters; c++) {
+        if (opened[c])
+          out << std::setw(15) << totals.counters[c];
+        else
+          out << std::setw(15) << "n/a";
+      }
+      if (opened[Counter::Cycles] && opened[Counter::Instructions] && totals.counters[Counter::Cycles] > 0)
+        out << std::setw(7) << static_cast<double>(totals.counters[Counter::Instructions])
+                                 / static_cast<double>(totals.counters[Counter::Cycles]);
+      else
+        out << std::setw(7) << "n/a";
+      out << "\n";
+    }
+  }
+
+}
+
+std::atomic<bool> PerfCounters::detail::enabled{false};
+
+bool PerfCounters::enable(bool on) {
+  detail::enabled.store(on, std::memory_order_relaxed);
+  return on && threadCounters().leader >= 0;
+}
+
+bool PerfCounters::available(Counter counter) {
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  return r.opened[counter];
+}
+
+std::string PerfCounters::status() {
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  std::string opened;
+  for (size_t c = 0; c < numCounters; c++)
+    if (r.opened[c])
+      opened += (opened.empty() ? "" : ", ") + std::string(counterNames[c]);
+  if (r.error.empty())
+    return "counting " + opened;
+  if (opened.empty())
+    return "no hardware counters (" + r.error + "), only calls and time";
+  return "counting " + opened + " (" + r.error + ")";
+}
+
+void PerfCounters::reset() {
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  for (auto& thread: r.threads) {
+    std::lock_guard<std::mutex> threadLock(thread->mutex);
+    thread->totals.clear();
+  }
+}
+
+void PerfCounters::printSummary(std::ostream& out) {
+  std::map<std::pair<std::string, int64_t>, Totals> phases;
+  std::map<std::pair<std::string, int64_t>, Totals> depths;
+  std::array<bool, numCounters> opened{};
+  {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    opened = r.opened;
+    for (auto& thread: r.threads) {
+      std::lock_guard<std::mutex> threadLock(thread->mutex);
+      for (const auto& [key, totals]: thread->totals) {
+        phases[{key.first, noDepth}].add(totals);
+        if (key.second != noDepth)
+          depths[{key.first, key.second}].add(totals);
+      }
+    }
+  }
+
+  const auto flags = out.flags();
+  const auto precision = out.precision();
+  out << "Hardware counters: " << status() << "\n\n";
+  printTable(out, phases, opened, false);
+  if (!depths.empty()) {
+    out << "\n";
+    printTable(out, depths, opened, true);
+  }
+  out.flags(flags);
+  out.precision(precision);
+}
+
+void PerfCounters::Scope::begin(int64_t depth) {
+  ThreadCounters& thread = threadCounters();
+  outer_ = thread.current;
+  thread.current = this;
+  outerDepth_ = thread.depth;
+  if (depth != noDepth)
+    thread.depth = depth;
+  read(thread, start_);
+}
+
+void PerfCounters::Scope::end(const char* name, uint64_t nanoseconds) {
+  ThreadCounters& thread = threadCounters();
+  Sample stop;
+  read(thread, stop);
+  Sample counts;
+  for (size_t c = 0; c < numCounters; c++)
+    counts[c] = stop[c] >= start_[c] ? stop[c] - start_[c] : 0;
+  if (outer_ != nullptr) {
+    outer_->nestedNanoseconds_ += nanoseconds;
+    for (size_t c = 0; c < numCounters; c++)
+      outer_->nested_[c] += counts[c];
+  }
+  {
+    std::lock_guard<std::mutex> lock(thread.mutex);
+    Totals& totals = thread.totals[{name, thread.depth}];
+    totals.calls++;
+    totals.nanoseconds += nanoseconds - std::min(nanoseconds, nestedNanoseconds_);
+    for (size_t c = 0; c < numCounters; c++)
+      totals.counters[c] += counts[c] - std::min(counts[c], nested_[c]);
+  }
+  thread.current = outer_;
+  thread.depth = outerDepth_;
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include "Pruning.hpp"
+
+using std::string;
+using std::vector;
+
+namespace {
+
+  struct Pruned {
+    Node node;
+    ClassCounter counts;   // class counts of the training rows below the node
+    double cost;           // cost of the pruned subtree, or its validation errors
+  };
+
+  size_t total(const ClassCounter& counts) {
+    return static_cast<size_t>(Utils::tree::mapValueSum(counts));
+  }
+
+  /** Class a leaf predicts: the most frequent, ties to the first in the schema, as in a Forest. */
+  const string& majority(const ClassCounter& counts, const Schema& schema) {
+    return std::max_element(counts.begin(), counts.end(), [&schema](const auto& a, const auto& b) {
+      return a.second < b.second || (a.second == b.second && schema.classCode(a.first) > schema.classCode(b.first));
+    })->first;
+  }
+
+  /** Training rows a leaf with these counts misclassifies. */
+  size_t errors(const ClassCounter& counts, const Schema& schema) {
+    return counts.empty() ? 0 : total(counts) - static_cast<size_t>(counts.at(majority(counts, schema)));
+  }
+
+  /** Validation rows a leaf with these counts misclassifies. */
+  double mistakes(const ClassCounter& counts, const Schema& schema, const Data& validation,
+                  const vector<uint32_t>& rows) {
+    if (counts.empty())
+      return static_cast<double>(rows.size());
+    const string& label = majority(counts, schema);
+    double count = 0;
+    for (const auto row: rows)
+      count += validation[row].back() != label;
+    return count;
+  }
+
+  ClassCounter merge(ClassCounter counts, const ClassCounter& other) {
+    for (const auto& [label, count]: other)
+      counts[label] += count;
+    return counts;
+  }
+
+  Pruned pruneCostComplexity(const Node& node, const Schema& schema, double alpha, double numRows) {
+    if (const auto& leaf = node.leaf(); leaf != nullptr) {
+      const auto counts = leaf->predictions();
+      return Pruned{node, counts, errors(counts, schema) / numRows + alpha};
+    }
+    Pruned trueBranch = pruneCostComplexity(*node.trueBranch(), schema, alpha, numRows);
+    Pruned falseBranch = pruneCostComplexity(*node.falseBranch(), schema, alpha, numRows);
+    ClassCounter counts = merge(std::move(trueBranch.counts), falseBranch.counts);
+    const double asLeaf = errors(counts, schema) / numRows + alpha;
+    const double asSubtree = trueBranch.cost + falseBranch.cost;
+    // Ties go to the leaf, which gives the smallest optimal subtree.
+    if (asLeaf <= asSubtree)
+      return Pruned{Node(Leaf(counts)), counts, asLeaf};
+    return Pruned{Node(trueBranch.node, falseBranch.node, node.question()), std::move(counts), asSubtree};
+  }
+
+  Pruned pruneReducedError(const Node& node, const Schema& schema, const Data& validation,
+                           const vector<uint32_t>& rows) {
+    if (const auto& leaf = node.leaf(); leaf != nullptr) {
+      const auto counts = leaf->predictions();
+      return Pruned{node, counts, mistakes(counts, schema, validation, rows)};
+    }
+    vector<uint32_t> trueRows;
+    vector<uint32_t> falseRows;
+    for (const auto row: rows)
+      (node.question().solve(validation[row]) ? trueRows : falseRows).push_back(row);
+    Pruned trueBranch = pruneReducedError(*node.trueBranch(), schema, validation, trueRows);
+    Pruned falseBranch = pruneReducedError(*node.falseBranch(), schema, validation, falseRows);
+    ClassCounter counts = merge(std::move(trueBranch.counts), falseBranch.counts);
+
+    const double asLeaf = mistakes(counts, schema, validation, rows);
+    const double asSubtree = trueBranch.cost + falseBranch.cost;
+    if (asLeaf <= asSubtree)
+      return Pruned{Node(Leaf(counts)), counts, asLeaf};
+    return Pruned{Node(trueBranch.node, falseBranch.node, node.question()), std::move(counts), asSubtree};
+  }
+
+  ClassCounter trainingCounts(const Node& node) {
+    if (const auto& leaf = node.leaf(); leaf != nullptr)
+      return leaf->predictions();
+    return merge(trainingCounts(*node.trueBranch()), trainingCounts(*node.falseBranch()));
+  }
+
+}
+
+size_t Pruning::countNodes(const Node& root) {
+  if (root.leaf() != nullptr)
+    return 1;
+  return 1 + countNodes(*root.trueBranch()) + countNodes(*root.falseBranch());
+}
+
+Node Pruning::costComplexity(const Node& root, const Schema& schema, double alpha) {
+  const size_t numRows = total(trainingCounts(root));
+  return pruneCostComplexity(root, schema, alpha, static_cast<double>(std::max<size_t>(numRows, 1))).node;
+}
+
+Node Pruning::reducedError(const Node& root, const Schema& schema, const Data& validation) {
+  vector<uint32_t> rows(validation.size());
+  std::iota(rows.begin(), rows.end(), 0);
+  return pruneReducedError(root, schema, validation, rows).node;
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include "QuantileSketch.hpp"
+
+using std::vector;
+
+namespace {
+
+  constexpr char magic[8] = {'F', 'C', 'A', 'R', 'T', 'Q', 'S', 'K'};
+  constexpr uint32_t version = 1;
+  // Capacity of a level relative to the one above it.
+  constexpr double shrink = 2.0 / 3.0;
+  constexpr size_t minCapacity = 2;
+
+  void putU64(std::string& out, uint64_t value) {
+    for (int i = 0; i < 8; i++)
+      out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+  }
+
+  void putF64(std::string& out, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putU64(out, bits);
+  }
+
+  class Reader {
+    public:
+      explicit Reader(const std::string& bytes) : bytes_(bytes) {}
+
+      uint64_t u64() {
+        if (pos_ + 8 > bytes_.size())
+          throw std::runtime_error("Truncated quantile sketch");
+        uint64_t value = 0;
+        for (int i = 0; i < 8; i++)
+          value |= static_cast<uint64_t>(static_cast<unsigned char>(bytes_[pos_ + i])) << (8 * i);
+        pos_ += 8;
+        return value;
+      }
+
+      double f64() {
+        const uint64_t bits = u64();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+      }
+
+      inline size_t pos() const { return pos_; }
+      inline void skip(size_t n) { pos_ += n; }
+
+    private:
+      const std::string& bytes_;
+      size_t pos_ = 0;
+  };
+
+}
+
+QuantileSketch::QuantileSketch(size_t k, uint64_t seed) :
+  k_(std::max(k, minCapacity)),
+  min_(std::numeric_limits<double>::infinity()),
+  max_(-std::numeric_limits<double>::infinity()),
+  random_number_generator_(seed) {
+  grow();
+}
+
+size_t QuantileSketch::capacity(size_t level) const {
+  const double height = static_cast<double>(levels_.size() - 1 - level);
+  return std::max(minCapacity, static_cast<size_t>(std::ceil(std::pow(shrink, height) * static_cast<double>(k_))));
+}
+
+void QuantileSketch::grow() {
+  levels_.emplace_back();
+  maxSize_ = 0;
+  for (size_t level = 0; level < levels_.size(); level++)
+    maxSize_ += capacity(level);
+}
+
+void QuantileSketch::add(double value) {
+  if (std::isnan(value))
+    return;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+  count_++;
+  levels_[0].push_back(value);
+  if (++size_ >= maxSize_)
+    compress();
+}
+
+void QuantileSketch::compress() {
+  while (size_ >= maxSize_) {
+    // Compact the lowest level that is over its capacity; there is one, as
+    // the levels together are.
+    size_t level = 0;
+    while (levels_[level].size() < capacity(level))
+      level++;
+    if (level + 1 == levels_.size())
+      grow();
+
+    auto& values = levels_[level];
+    std::sort(values.begin(), values.end());
+    // An odd value out stays behind, the others pair up.
+    const bool odd = values.size() % 2 == 1;
+    const double last = values.back();
+    const size_t pairs = values.size() / 2;
+    const size_t offset = random_number_generator_() & 1;
+    auto& next = levels_[level + 1];
+    for (size_t i = 0; i < pairs; i++)
+      next.push_back(values[2 * i + offset]);
+    values.clear();
+    if (odd)
+      values.push_back(last);
+    size_ -= pairs;
+  }
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+  if (other.k_ != k_)
+    throw std::invalid_argument("Can't merge quantile sketches with k " + std::to_string(k_) + " and "
+                                + std::to_string(other.k_));
+  if (other.empty())
+    return;
+  while (levels_.size() < other.levels_.size())
+    grow();
+  for (size_t level = 0; level < other.levels_.size(); level++)
+    levels_[level].insert(levels_[level].end(), other.levels_[level].begin(), other.levels_[level].end());
+  size_ += other.size_;
+  count_ += other.count_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  compress();
+}
+
+size_t QuantileSketch::numRetained() const {
+  return size_;
+}
+
+double QuantileSketch::rankError() const {
+  return rankError(k_);
+}
+
+double QuantileSketch::rankError(size_t k) {
+  // The empirical 99% bound of the DataSketches KLL sketch, which compacts
+  // the same way.
+  return 2.296 / std::pow(static_cast<double>(std::max(k, minCapacity)), 0.9723);
+}
+
+vector<std::pair<double, uint64_t>> QuantileSketch::weighted() const {
+  vector<std::pair<double, uint64_t>> items;
+  items.reserve(size_);
+  for (size_t level = 0; level < levels_.size(); level++)
+    for (const auto value: levels_[level])
+      items.emplace_back(value, uint64_t{1} << level);
+  std::sort(items.begin(), items.end());
+  return items;
+}
+
+double QuantileSketch::quantile(double q) const {
+  if (empty())
+    return std::nan("");
+  if (q <= 0.0)
+    return min_;
+  if (q >= 1.0)
+    return max_;
+  const auto rank = static_cast<uint64_t>(q * static_cast<double>(count_));
+  uint64_t seen = 0;
+  for (const auto& [value, weight]: weighted()) {
+    seen += weight;
+    if (seen > rank)
+      return value;
+  }
+  return max_;
+}
+
+vector<double> QuantileSketch::boundaries(size_t numBins) const {
+  vector<double> bounds;
+  if (empty() || numBins == 0)
+    return bounds;
+  const auto items = weighted();
+  // The weights of the held values add up to count: compacting a pair of
+  // values keeps one of twice the weight.
+  size_t i = 0;
+  uint64_t seen = items.empty() ? 0 : items[0].second;
+  bounds.push_back(min_);
+  for (size_t b = 1; b < numBins; b++) {
+    const uint64_t rank = b * count_ / numBins;
+    while (seen <= rank && i + 1 < items.size())
+      seen += items[++i].second;
+    bounds.push_back(items[i].first);
+  }
+  return bounds;
+}
+
+std::string QuantileSketch::serialize() const {
+  std::string out(magic, sizeof(magic));
+  putU64(out, version);
+  putU64(out, k_);
+  putU64(out, count_);
+  putF64(out, min_);
+  putF64(out, max_);
+  putU64(out, levels_.size());
+  for (const auto& level: levels_) {
+    putU64(out, level.size());
+    for (const auto value: level)
+      putF64(out, value);
+  }
+  return out;
+}
+
+QuantileSketch QuantileSketch::deserialize(const std::string& bytes, uint64_t seed) {
+  if (bytes.size() < sizeof(magic) || std::memcmp(bytes.data(), magic, sizeof(magic)) != 0)
+    throw std::runtime_error("Not a quantile sketch");
+  Reader in(bytes);
+  in.skip(sizeof(magic));
+  if (in.u64() != version)
+    throw std::runtime_error("Unsupported quantile sketch version");
+  QuantileSketch sketch(in.u64(), seed);
+  sketch.count_ = in.u64();
+  sketch.min_ = in.f64();
+  sketch.max_ = in.f64();
+  const uint64_t numLevels = in.u64();
+  if (numLevels == 0 || numLevels > 64)
+    throw std::runtime_error("Corrupt quantile sketch");
+  while (sketch.levels_.size() < numLevels)
+    sketch.grow();
+  uint64_t weight = 0;
+  for (auto& level: sketch.levels_) {
+    const uint64_t size = in.u64();
+    if (size > (bytes.size() - in.pos()) / 8)
+      throw std::runtime_error("Truncated quantile sketch");
+    for (uint64_t i = 0; i < size; i++)
+      level.push_back(in.f64());
+    weight += size << (&level - sketch.levels_.data());
+    sketch.size_ += size;
+  }
+  if (weight != sketch.count_)
+    throw std::runtime_error("Corrupt quantile sketch");
+  sketch.compress();
+  return sketch;
+}
@@ -5,26 +5,61 @@
  */
 
 #include "Question.hpp"
+#include <cstdio>
+#include <cstdlib>
 #include "Utils.hpp"
 
 using std::string;
 using std::vector;
 
-Question::Question() : column_(0), value_("") {}
+namespace {
+  bool parsesAsNumber(const string& value) {
+    char* end = nullptr;
+    std::strtod(value.c_str(), &end);
+    return !value.empty() && end != value.c_str();
+  }
+
+  string thresholdString(double value) {
+    char buffer[32];
+    for (int precision = 6; precision <= 17; precision++) {
+      std::snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+      if (std::strtod(buffer, nullptr) == value)
+        break;
+    }
+    return buffer;
+  }
+}
+
+Question::Question() : column_(0), value_(""), numeric_(false), threshold_(0.0) {}
+
+Question::Question(const int column, const string value) :
+  Question(column, value, parsesAsNumber(value)) {}
+
+Question::Question(const int column, const string value, const bool numeric) :
+  column_(column),
+  value_(value),
+  numeric_(numeric),
+  threshold_(numeric ? std::stod(value) : 0.0) {}
 
-Question::Question(const int column, const string value) : column_(column), value_(value) {}
+Question::Question(const int column, const double threshold) :
+  column_(column),
+  value_(thresholdString(threshold)),
+  numeric_(true),
+  threshold_(threshold) {}
 
-const bool Question::solve(VecS example) const {
+const bool Question::solve(const VecS& example) const {
   const string& val = example[column_];
-  if (isNumeric(val)) {
-    return std::stod(val) >= std::stod(value_);
+  if (numeric_) {
+    char* end = nullptr;
+    const double parsed = std::strtod(val.c_str(), &end);
+    return end != val.c_str() && parsed >= threshold_;
   } else {
     return val == value_;
   }
 }
 const string Question::toString(const VecS& labels) const {
   string condition = "==";
-  if (isNumeric(value_))
+  if (numeric_)
     condition = ">=";
   return "Is " + labels[column_] + " " + condition + " " + value_ + "?";
 }
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <cstdlib>
+#include "Schema.hpp"
+
+using std::string;
+
+Schema::Schema(const MetaData& meta) {
+  const size_t numColumns = meta.labels.size();
+  for (size_t col = 0; col + 1 < numColumns; col++) {
+    const bool categorical = meta.columnTypes[col] == "categorical";
+    addColumn(meta.labels[col], categorical ? ColumnType::Categorical : ColumnType::Numeric,
+              categorical && col < meta.domains.size() ? meta.domains[col] : VecS());
+  }
+  if (numColumns > 0)
+    setClasses(meta.labels.back(), meta.domains.size() == numColumns ? meta.domains.back() : VecS());
+}
+
+void Schema::addColumn(string name, ColumnType type, VecS domain) {
+  names_.push_back(std::move(name));
+  types_.push_back(type);
+  domains_.push_back(std::move(domain));
+  codes_.emplace_back();
+  for (uint32_t i = 0; i < domains_.back().size(); i++)
+    codes_.back().emplace(domains_.back()[i], i);
+}
+
+void Schema::setClasses(string label, VecS classes) {
+  classLabel_ = std::move(label);
+  classes_ = std::move(classes);
+  classCodes_.clear();
+  for (uint32_t i = 0; i < classes_.size(); i++)
+    classCodes_.emplace(classes_[i], i);
+}
+
+uint32_t Schema::code(size_t column, const string& value) const {
+  const auto& codes = codes_[column];
+  const auto it = codes.find(value);
+  return it == std::end(codes) ? npos : it->second;
+}
+
+uint32_t Schema::classCode(const string& label) const {
+  const auto it = classCodes_.find(label);
+  return it == std::end(classCodes_) ? npos : it->second;
+}
+
+uint32_t Schema::addCode(size_t column, const string& value) {
+  if (const uint32_t known = code(column, value); known != npos)
+    return known;
+  const auto added = static_cast<uint32_t>(domains_[column].size());
+  domains_[column].push_back(value);
+  codes_[column].emplace(value, added);
+  return added;
+}
+
+uint32_t Schema::addClass(const string& label) {
+  if (const uint32_t known = classCode(label); known != npos)
+    return known;
+  const auto added = static_cast<uint32_t>(classes_.size());
+  classes_.push_back(label);
+  classCodes_.emplace(label, added);
+  return added;
+}
+
+void Schema::encode(const VecS& row, double* out) const {
+  constexpr double missing = std::numeric_limits<double>::quiet_NaN();
+  for (size_t col = 0; col < names_.size(); col++) {
+    const string& value = row[col];
+    if (types_[col] == ColumnType::Numeric) {
+      char* end = nullptr;
+      const double parsed = std::strtod(value.c_str(), &end);
+      out[col] = (end == value.c_str()) ? missing : parsed;
+    } else {
+      const auto& codes = codes_[col];
+      const auto it = codes.find(value);
+      out[col] = it == std::end(codes) ? missing : it->second;
+    }
+  }
+}
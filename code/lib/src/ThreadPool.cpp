@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(size_t numThreads) :
+  workers_(),
+  jobs_(),
+  mutex_(),
+  available_(),
+  stopping_(false) {
+  numThreads = std::max<size_t>(numThreads, 1);
+  workers_.reserve(numThreads);
+  for (size_t i = 0; i < numThreads; i++)
+    workers_.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  available_.notify_all();
+  for (auto& worker: workers_)
+    worker.join();
+}
+
+ThreadPool& ThreadPool::shared() {
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::enqueue(std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push(std::move(job));
+  }
+  available_.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+  while (true) {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      available_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+      if (jobs_.empty())
+        return;
+      job = std::move(jobs_.front());
+      jobs_.pop();
+    }
+    job();
+  }
+}
+
+void ThreadPool::parallelFor(size_t first, size_t last, size_t grain,
+                             const std::function<void(size_t, size_t)>& body) {
+  if (first >= last)
+    return;
+  grain = std::max<size_t>(grain, 1);
+  const size_t numChunks = (last - first + grain - 1) / grain;
+  if (numChunks == 1) {
+    body(first, last);
+    return;
+  }
+
+  // Chunks are claimed through a shared counter, so helpers that only start
+  // after all chunks are taken return immediately. The caller waits for the
+  // claimed chunks only, never for a helper that is still queued.
+  struct State {
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> done{0};
+    std::mutex mutex{};
+    std::condition_variable finished{};
+    std::exception_ptr error{};
+  };
+  auto state = std::make_shared<State>();
+
+  auto work = [state, first, last, grain, numChunks, &body]() {
+    size_t chunk;
+    while ((chunk = state->next.fetch_add(1)) < numChunks) {
+      const size_t begin = first + chunk * grain;
+      try {
+        body(begin, std::min(begin + grain, last));
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (!state->error)
+          state->error = std::current_exception();
+      }
+      if (state->done.fetch_add(1) + 1 == numChunks) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->finished.notify_all();
+      }
+    }
+  };
+
+  const size_t helpers = std::min(size(), numChunks - 1);
+  for (size_t i = 0; i < helpers; i++)
+    enqueue(work);
+  work();
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->finished.wait(lock, [&state, numChunks]() { return state->done.load() == numChunks; });
+  if (state->error)
+    std::rethrow_exception(state->error);
+}
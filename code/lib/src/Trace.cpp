@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include "Trace.hpp"
+
+namespace {
+
+  struct Event {
+    const char* name;
+    const char* argName;
+    int64_t arg;
+    uint64_t start;
+    uint64_t end;
+  };
+
+  /**
+   * Events of one thread. Only the owning thread writes. The buffer grows
+   * up to its capacity, as short-lived threads only record a few events.
+   */
+  struct Buffer {
+    explicit Buffer(uint32_t thread) : thread(thread), events(), count(0) {}
+
+    uint32_t thread;
+    std::vector<Event> events;
+    std::atomic<uint64_t> count;   // events ever recorded
+  };
+
+  /** Buffers of all threads that traced, kept after the threads exit. */
+  struct Registry {
+    std::mutex mutex{};
+    std::vector<std::shared_ptr<Buffer>> buffers{};
+  };
+
+  Registry& registry() {
+    static Registry instance;
+    return instance;
+  }
+
+  Buffer& threadBuffer() {
+    thread_local std::shared_ptr<Buffer> buffer = []() {
+      Registry& r = registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      r.buffers.push_back(std::make_shared<Buffer>(static_cast<uint32_t>(r.buffers.size() + 1)));
+      return r.buffers.back();
+    }();
+    return *buffer;
+  }
+
+  void writeString(std::ostream& out, const char* s) {
+    out << '"';
+    for (; *s != '\0'; s++) {
+      if (*s == '"' || *s == '\\')
+        out << '\\';
+      out << *s;
+    }
+    out << '"';
+  }
+
+}
+
+std::atomic<bool> Trace::detail::enabled{false};
+
+void Trace::enable(bool on) {
+  detail::enabled.store(on, std::memory_order_relaxed);
+}
+
+uint64_t Trace::now() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Trace::Span::begin() {
+  start_ = now();
+  counting_ = PerfCounters::enabled();
+  if (counting_)
+    counters_.begin(argName_ != nullptr && std::strcmp(argName_, "depth") == 0 ? arg_ : PerfCounters::noDepth);
+}
+
+void Trace::Span::end() {
+  const uint64_t end = now();
+  if (counting_)
+    counters_.end(name_, end - start_);
+  if (!enabled())
+    return;
+
+  Buffer& buffer = threadBuffer();
+  const uint64_t n = buffer.count.load(std::memory_order_relaxed);
+  if (n < bufferSize)
+    buffer.events.push_back(Event{name_, argName_, arg_, start_, end});
+  else
+    buffer.events[n % bufferSize] = Event{name_, argName_, arg_, start_, end};
+  buffer.count.store(n + 1, std::memory_order_release);
+}
+
+void Trace::clear() {
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  for (auto& buffer: r.buffers) {
+    buffer->events.clear();
+    buffer->count.store(0, std::memory_order_relaxed);
+  }
+}
+
+uint64_t Trace::dropped() {
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  uint64_t dropped = 0;
+  for (const auto& buffer: r.buffers) {
+    const uint64_t n = buffer->count.load(std::memory_order_acquire);
+    dropped += n > bufferSize ? n - bufferSize : 0;
+  }
+  return dropped;
+}
+
+void Trace::writeChromeTrace(const std::string& filename) {
+  std::ofstream out(filename);
+  if (!out)
+    throw std::runtime_error("Can't open file: " + filename);
+
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  uint64_t origin = std::numeric_limits<uint64_t>::max();
+  for (const auto& buffer: r.buffers) {
+    const uint64_t n = buffer->count.load(std::memory_order_acquire);
+    for (uint64_t i = n > bufferSize ? n - bufferSize : 0; i < n; i++)
+      origin = std::min(origin, buffer->events[i % bufferSize].start);
+  }
+
+  // Timestamps are in microseconds, relative to the first event, to the
+  // nanosecond so nested spans stay nested.
+  out << std::fixed << std::setprecision(3);
+  out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+  bool first = true;
+  for (const auto& buffer: r.buffers) {
+    const uint64_t n = buffer->count.load(std::memory_order_acquire);
+    for (uint64_t i = n > bufferSize ? n - bufferSize : 0; i < n; i++) {
+      const Event& e = buffer->events[i % bufferSize];
+      out << (first ? "\n" : ",\n") << "{\"name\": ";
+      writeString(out, e.name);
+      out << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->thread
+          << ", \"ts\": " << (e.start - origin) / 1e3 << ", \"dur\": " << (e.end - e.start) / 1e3;
+      if (e.argName != nullptr) {
+        out << ", \"args\": {";
+        writeString(out, e.argName);
+        out << ": " << e.arg << "}";
+      }
+      out << "}";
+      first = false;
+    }
+  }
+  out << "\n]}\n";
+  if (!out)
+    throw std::runtime_error("Can't write file: " + filename);
+}
@@ -5,14 +5,12 @@
  */
 
 #include "TreeTest.hpp"
+#include "ThreadPool.hpp"
+#include "Trace.hpp"
 
 using std::make_shared;
 using std::shared_ptr;
 
-TreeTest::TreeTest(const Data& testData, const MetaData& meta, const Node &root) {
-  test(testData, meta.labels, make_shared<Node>(root));
-}
-
 const ClassCounter TreeTest::classify(const VecS& row, shared_ptr<Node> node) const {
   if (bool is_leaf = node->leaf() != nullptr; is_leaf) {
     const auto &leaf = node->leaf();
@@ -35,15 +33,28 @@ void TreeTest::printLeaf(ClassCounter counts) const {
   Utils::print::print_map(scale);
 }
 
-void TreeTest::test(const Data& testData, const VecS& labels, shared_ptr<Node> tree) const {
-  float accuracy = 0;
-  for (const auto& row: testData) {
-    const auto& classification = classify(row, tree);
-    static size_t last = row.size() - 1;
-    // Comment out this line to print the predicion of each example
-    // std::cout << "Actual: " << row[last] << "\tPrediction: "; printLeaf(classification);
-    if (Utils::tree::getMax(classification) == row[last])
-      accuracy += 1;
-  }
-  std::cout << "Total accuracy: " << (accuracy / testData.size()) << std::endl;
+Metrics TreeTest::test(const Data& testData, const MetaData& meta, const Node &root) const {
+  TRACE_SPAN("evaluate", "rows", static_cast<int64_t>(testData.size()));
+  const auto tree = make_shared<Node>(root);
+  const VecS& classes = meta.domains.empty() ? VecS() : meta.domains.back();
+  ThreadPool& pool = ThreadPool::shared();
+  const size_t grain = std::max<size_t>(1024, testData.size() / (4 * pool.size()) + 1);
+  const size_t numChunks = (testData.size() + grain - 1) / grain;
+
+  std::vector<Metrics> partial(numChunks, Metrics(classes));
+  pool.parallelFor(0, testData.size(), grain, [&](size_t begin, size_t end) {
+    Metrics& metrics = partial[begin / grain];
+    for (size_t i = begin; i < end; i++) {
+      const VecS& row = testData[i];
+      const auto& classification = classify(row, tree);
+      // Comment out this line to print the predicion of each example
+      // std::cout << "Actual: " << row.back() << "\tPrediction: "; printLeaf(classification);
+      metrics.add(row.back(), Utils::tree::getMax(classification));
+    }
+  });
+
+  Metrics metrics(classes);
+  for (const auto& part: partial)
+    metrics.merge(part);
+  return metrics;
 }
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <numeric>
+#include "TreeUpdater.hpp"
+
+using std::vector;
+
+namespace {
+
+  inline void bump(ClassHistogram& counts, size_t index) {
+    if (index >= counts.size())
+      counts.resize(index + 1, 0.0);
+    counts[index]++;
+  }
+
+  double splitGain(const ClassHistogram& parent, const ClassHistogram& trueCounts) {
+    const double parentSize = std::accumulate(parent.begin(), parent.end(), 0.0);
+    const double trueSize = std::accumulate(trueCounts.begin(), trueCounts.end(), 0.0);
+    const double falseSize = parentSize - trueSize;
+    if (trueSize <= 0 || falseSize <= 0)
+      return 0.0;
+    ClassHistogram falseCounts(parent);
+    for (size_t c = 0; c < trueCounts.size() && c < falseCounts.size(); c++)
+      falseCounts[c] -= trueCounts[c];
+    const double p = trueSize / parentSize;
+    return Calculations::gini(parent, parentSize) - p * Calculations::gini(trueCounts, trueSize)
+           - (1 - p) * Calculations::gini(falseCounts, falseSize);
+  }
+
+}
+
+TreeUpdater::TreeUpdater(std::shared_ptr<const DataReader> dr, const Node& root, const TreeConfig& config) :
+  dr_(std::move(dr)),
+  config_(config),
+  schema_(dr_->trainColumns().schema()),
+  bins_(dr_->trainColumns(), numBins),
+  numClasses_(schema_.numClasses()),
+  offsets_(),
+  added_(),
+  addedLabels_(),
+  root_(),
+  rebuilt_(0) {
+  size_t offset = 0;
+  for (size_t col = 0; col < bins_.numFeatures(); col++) {
+    offsets_.push_back(offset);
+    offset += numClasses_ * bins_.numBins(col);
+  }
+  offsets_.push_back(offset);
+
+  Rows ids(dr_->trainColumns().numRows());
+  std::iota(ids.begin(), ids.end(), 0);
+  root_ = collect(root, ids, 0, 1);
+}
+
+TreeUpdater::TreeUpdater(const TreeUpdater& other) :
+  dr_(other.dr_),
+  config_(other.config_),
+  schema_(other.schema_),
+  bins_(other.bins_),
+  numClasses_(other.numClasses_),
+  offsets_(other.offsets_),
+  added_(other.added_),
+  addedLabels_(other.addedLabels_),
+  root_(clone(*other.root_)),
+  rebuilt_(other.rebuilt_) {}
+
+std::unique_ptr<TreeUpdater::Stats> TreeUpdater::clone(const Stats& stats) {
+  auto copy = std::make_unique<Stats>();
+  copy->counts = stats.counts;
+  copy->histogram = stats.histogram;
+  copy->rows = stats.rows;
+  copy->size = stats.size;
+  copy->dirty = stats.dirty;
+  copy->depth = stats.depth;
+  copy->node = stats.node;
+  if (stats.trueChild)
+    copy->trueChild = clone(*stats.trueChild);
+  if (stats.falseChild)
+    copy->falseChild = clone(*stats.falseChild);
+  return copy;
+}
+
+const VecS& TreeUpdater::row(uint32_t id) const {
+  const Data& train = dr_->trainData();
+  return id < train.size() ? train[id] : added_[id - train.size()];
+}
+
+uint32_t TreeUpdater::label(uint32_t id) const {
+  const ColumnStore& store = dr_->trainColumns();
+  return id < store.numRows() ? store.labels()[id] : addedLabels_[id - store.numRows()];
+}
+
+void TreeUpdater::binRow(uint32_t id, uint8_t* bins) const {
+  const ColumnStore& store = dr_->trainColumns();
+  if (id < store.numRows()) {
+    for (size_t col = 0; col < bins_.numFeatures(); col++)
+      bins[col] = bins_.bins(col)[id];
+    return;
+  }
+  vector<double> x(schema_.numFeatures());
+  schema_.encode(row(id), x.data());
+  for (size_t col = 0; col < bins_.numFeatures(); col++)
+    bins[col] = bins_.binOf(col, x[col]);
+}
+
+void TreeUpdater::count(vector<uint32_t>& histogram, uint32_t classCode, const uint8_t* bins) const {
+  if (classCode >= numClasses_)
+    return;
+  if (histogram.empty())
+    histogram.assign(offsets_.back(), 0);
+  for (size_t col = 0; col < bins_.numFeatures(); col++)
+    histogram[offsets_[col] + classCode * bins_.numBins(col) + bins[col]]++;
+}
+
+bool TreeUpdater::keepsHistogram(size_t size) const {
+  return size * bins_.numFeatures() >= histogramFactor * offsets_.back();
+}
+
+vector<uint32_t> TreeUpdater::histogramOf(const Stats& stats) const {
+  Rows ids;
+  gather(stats, ids);
+  vector<uint32_t> histogram(offsets_.back(), 0);
+  vector<uint8_t> bins(bins_.numFeatures());
+  for (const auto id: ids) {
+    binRow(id, bins.data());
+    count(histogram, label(id), bins.data());
+  }
+  return histogram;
+}
+
+void TreeUpdater::add(const Node& node, Stats& stats, uint32_t id, const uint8_t* bins, bool dirty) const {
+  const VecS& example = row(id);
+  const uint32_t classCode = label(id);
+  const Node* n = &node;
+  Stats* s = &stats;
+  while (true) {
+    s->dirty |= dirty;
+    bump(s->counts, classCode);
+    // The rows below the node so far are counted once, when it gets big
+    // enough to keep a histogram; from then on every row is added to it.
+    if (s->histogram.empty() && keepsHistogram(s->size + 1))
+      s->histogram = histogramOf(*s);
+    s->size++;
+    if (!s->histogram.empty())
+      count(s->histogram, classCode, bins);
+    if (n->leaf() != nullptr) {
+      s->rows.push_back(id);
+      return;
+    }
+
+    const bool answer = n->question().solve(example);
+    auto& child = answer ? s->trueChild : s->falseChild;
+    if (!child) {
+      child = std::make_unique<Stats>();
+      child->depth = s->depth + 1;
+      child->node = 2 * s->node + (answer ? 0 : 1);
+    }
+    n = (&child == &s->trueChild ? n->trueBranch() : n->falseBranch()).get();
+    s = child.get();
+  }
+}
+
+std::unique_ptr<TreeUpdater::Stats> TreeUpdater::collect(const Node& node, const Rows& ids, int depth,
+                                                         uint64_t number) const {
+  auto stats = std::make_unique<Stats>();
+  stats->depth = depth;
+  stats->node = number;
+  vector<uint8_t> bins(bins_.numFeatures());
+  for (const auto id: ids) {
+    binRow(id, bins.data());
+    add(node, *stats, id, bins.data(), false);
+  }
+  return stats;
+}
+
+void TreeUpdater::gather(const Stats& stats, Rows& ids) const {
+  ids.insert(ids.end(), stats.rows.begin(), stats.rows.end());
+  if (stats.trueChild)
+    gather(*stats.trueChild, ids);
+  if (stats.falseChild)
+    gather(*stats.falseChild, ids);
+}
+
+double TreeUpdater::bestGain(const Stats& stats) const {
+  const vector<uint32_t> counted = stats.histogram.empty() ? histogramOf(stats) : vector<uint32_t>();
+  const vector<uint32_t>& histogram = stats.histogram.empty() ? counted : stats.histogram;
+
+  ClassHistogram known(stats.counts);
+  known.resize(numClasses_, 0.0);
+  vector<double> column;
+  double best = 0.0;
+  for (size_t col = 0; col < bins_.numFeatures(); col++) {
+    column.assign(histogram.begin() + offsets_[col], histogram.begin() + offsets_[col + 1]);
+    const auto [bin, gain] = Calculations::best_histogram_split(column.data(), bins_.numBins(col),
+                                                                bins_.isNumeric(col), known,
+                                                                static_cast<double>(config_.minLeaf));
+    best = std::max(best, gain);
+  }
+  return best;
+}
+
+Node TreeUpdater::rebuild(Stats& stats, const Builder& build) {
+  Rows ids;
+  gather(stats, ids);
+  Data rows;
+  rows.reserve(ids.size());
+  for (const auto id: ids)
+    rows.push_back(row(id));
+  const ColumnStore store(rows, dr_->metaData());
+  Rows local(rows.size());
+  std::iota(local.begin(), local.end(), 0);
+
+  Node node = build(store, local, stats.depth, stats.node);
+  stats = std::move(*collect(node, ids, stats.depth, stats.node));
+  rebuilt_++;
+  return node;
+}
+
+Node TreeUpdater::refresh(const Node& node, Stats& stats, double tolerance, const Builder& build) {
+  if (!stats.dirty)
+    return node;
+  stats.dirty = false;
+
+  if (node.leaf() != nullptr) {
+    const bool atMaxDepth = config_.maxDepth > 0 && stats.depth >= config_.maxDepth;
+    if (!atMaxDepth && bestGain(stats) > tolerance)
+      return rebuild(stats, build);
+    return Node(Leaf(Calculations::toClassCounter(stats.counts, schema_)));
+  }
+
+  const ClassHistogram noRows;
+  const double current = splitGain(stats.counts, stats.trueChild ? stats.trueChild->counts : noRows);
+  if (bestGain(stats) > current + tolerance)
+    return rebuild(stats, build);
+
+  for (const bool answer: {true, false}) {
+    auto& child = answer ? stats.trueChild : stats.falseChild;
+    if (!child) {
+      child = std::make_unique<Stats>();
+      child->depth = stats.depth + 1;
+      child->node = 2 * stats.node + (answer ? 0 : 1);
+    }
+  }
+  return Node(refresh(*node.trueBranch(), *stats.trueChild, tolerance, build),
+              refresh(*node.falseBranch(), *stats.falseChild, tolerance, build), node.question());
+}
+
+Node TreeUpdater::update(const Node& root, const Data& rows, double tolerance, const Builder& build) {
+  rebuilt_ = 0;
+  vector<uint8_t> bins(bins_.numFeatures());
+  for (const auto& example: rows) {
+    const auto id = static_cast<uint32_t>(numRows());
+    added_.push_back(example);
+    addedLabels_.push_back(schema_.addClass(example.back()));
+    binRow(id, bins.data());
+    add(root, *root_, id, bins.data(), true);
+  }
+  return refresh(root, *root_, tolerance, build);
+}
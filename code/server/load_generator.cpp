@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <boost/algorithm/string.hpp>
+#include "../lib/include/LatencyHistogram.hpp"
+
+/**
+ * Load generator for the prediction server.
+ *
+ * Replays the data rows of an ARFF file over a number of connections to a
+ * server socket. Each connection keeps at most --depth requests in flight;
+ * with --rate the total request rate is capped as well. Latency is measured
+ * per request from sending the row until its answer is received.
+ */
+
+namespace {
+
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    std::string socket{};
+    std::string data{};
+    size_t connections = 4;
+    size_t depth = 16;
+    size_t requests = 100000;
+    double rate = 0;
+  };
+
+  bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+      const std::string arg = argv[i];
+      const std::string value = argv[i + 1];
+      if (arg == "--socket")
+        options.socket = value;
+      else if (arg == "--data")
+        options.data = value;
+      else if (arg == "--connections")
+        options.connections = std::stoul(value);
+      else if (arg == "--depth")
+        options.depth = std::stoul(value);
+      else if (arg == "--requests")
+        options.requests = std::stoul(value);
+      else if (arg == "--rate")
+        options.rate = std::stod(value);
+      else
+        return false;
+    }
+    return argc % 2 == 1 && !options.socket.empty() && !options.data.empty()
+      && options.connections > 0 && options.depth > 0;
+  }
+
+  std::vector<std::string> readRows(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file)
+      throw std::runtime_error("Can't open file: " + filename);
+    std::vector<std::string> rows;
+    std::string line;
+    bool data = false;
+    while (std::getline(file, line)) {
+      boost::trim(line);
+      if (line.empty() || line[0] == '%')
+        continue;
+      if (!data) {
+        data = boost::istarts_with(line, "@DATA");
+        continue;
+      }
+      rows.push_back(line + "\n");
+    }
+    if (rows.empty())
+      throw std::runtime_error("No data rows in " + filename);
+    return rows;
+  }
+
+  int connect(const std::string& path) {
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+      throw std::runtime_error("Can't connect to " + path);
+    return fd;
+  }
+
+  /**
+   * One client connection: the calling thread sends, a second thread reads
+   * the answers and records latencies.
+   */
+  void runConnection(const Options& options, const std::vector<std::string>& rows, size_t first,
+                     size_t count, LatencyHistogram& latency, size_t& errors) {
+    const int fd = connect(options.socket);
+    std::mutex mutex;
+    std::condition_variable slot;
+    std::deque<Clock::time_point> inFlight;
+
+    std::thread receiver([&]() {
+      std::string buffer;
+      char chunk[64 * 1024];
+      size_t received = 0;
+      while (received < count) {
+        const ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0)
+          break;
+        buffer.append(chunk, static_cast<size_t>(n));
+        size_t start = 0, end;
+        while ((end = buffer.find('\n', start)) != std::string::npos) {
+          const auto now = Clock::now();
+          if (buffer.compare(start, 5, "ERROR") == 0)
+            errors++;
+          start = end + 1;
+          std::lock_guard<std::mutex> lock(mutex);
+          latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - inFlight.front()).count());
+          inFlight.pop_front();
+          received++;
+          slot.notify_one();
+        }
+        buffer.erase(0, start);
+      }
+    });
+
+    const auto interval = options.rate > 0
+      ? std::chrono::duration<double>(options.connections / options.rate)
+      : std::chrono::duration<double>(0);
+    auto next = Clock::now();
+    for (size_t i = 0; i < count; i++) {
+      if (options.rate > 0) {
+        next += std::chrono::duration_cast<Clock::duration>(interval);
+        std::this_thread::sleep_until(next);
+      }
+      const std::string& row = rows[(first + i) % rows.size()];
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        slot.wait(lock, [&]() { return inFlight.size() < options.depth; });
+        inFlight.push_back(Clock::now());
+      }
+      if (::send(fd, row.data(), row.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(row.size()))
+        break;
+    }
+    receiver.join();
+    ::close(fd);
+  }
+
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    std::cerr << "Usage: " << argv[0] << " --socket PATH --data FILE.arff [--connections N]"
+              << " [--depth N] [--requests N] [--rate REQUESTS_PER_SECOND]" << std::endl;
+    return 2;
+  }
+
+  const auto rows = readRows(options.data);
+  LatencyHistogram latency;
+  std::vector<size_t> errors(options.connections, 0);
+  std::vector<std::thread> clients;
+
+  const auto start = Clock::now();
+  const size_t perConnection = options.requests / options.connections;
+  for (size_t c = 0; c < options.connections; c++) {
+    const size_t count = perConnection + (c < options.requests % options.connections ? 1 : 0);
+    clients.emplace_back(runConnection, std::cref(options), std::cref(rows), c * perConnection, count,
+                         std::ref(latency), std::ref(errors[c]));
+  }
+  for (auto& client: clients)
+    client.join();
+  const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  size_t totalErrors = 0;
+  for (const auto e: errors)
+    totalErrors += e;
+  std::cout << "requests=" << latency.count()
+            << " errors=" << totalErrors
+            << " seconds=" << seconds
+            << " throughput=" << latency.count() / seconds << "/s"
+            << " mean=" << latency.mean() / 1000.0 << "us"
+            << " p50=" << latency.percentile(0.50) / 1000.0 << "us"
+            << " p99=" << latency.percentile(0.99) / 1000.0 << "us"
+            << " p999=" << latency.percentile(0.999) / 1000.0 << "us"
+            << " max=" << latency.max() / 1000.0 << "us" << std::endl;
+  return latency.count() == options.requests ? 0 : 1;
+}
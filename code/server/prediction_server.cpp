@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <boost/algorithm/string.hpp>
+#include "../lib/include/MicroBatcher.hpp"
+#include "../lib/include/ModelIO.hpp"
+#include "../lib/include/ModelRegistry.hpp"
+
+/**
+ * Local prediction server.
+ *
+ * Rows are comma-separated feature values, one per line, optionally followed
+ * by the class value (which is ignored). Every row is answered with one line
+ * holding the predicted class, or "ERROR ..." for malformed rows. Rows are
+ * read from stdin, or from any number of clients on a Unix domain socket
+ * when --socket is given. On a socket, the line "STATS" is answered with the
+ * current counters; send it when no rows of that connection are in flight.
+ *
+ * SIGHUP reloads the model file. The new model replaces the live one
+ * without pausing the batches that are being scored.
+ */
+
+namespace {
+
+  volatile std::sig_atomic_t stopRequested = 0;
+  volatile std::sig_atomic_t reloadRequested = 0;
+
+  void requestStop(int) {
+    stopRequested = 1;
+  }
+
+  void requestReload(int) {
+    reloadRequested = 1;
+  }
+
+  struct Options {
+    std::string model{};
+    std::string socket{};
+    size_t maxBatchSize = 64;
+    long maxWaitMicros = 200;
+    long statsInterval = 0;
+  };
+
+  void usage(const char* program) {
+    std::cerr << "Usage: " << program << " --model FILE [--socket PATH] [--max-batch N]"
+              << " [--max-wait-us N] [--stats-interval SECONDS]" << std::endl;
+  }
+
+  bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+      const std::string arg = argv[i];
+      if (i + 1 >= argc)
+        return false;
+      const std::string value = argv[++i];
+      if (arg == "--model")
+        options.model = value;
+      else if (arg == "--socket")
+        options.socket = value;
+      else if (arg == "--max-batch")
+        options.maxBatchSize = std::stoul(value);
+      else if (arg == "--max-wait-us")
+        options.maxWaitMicros = std::stol(value);
+      else if (arg == "--stats-interval")
+        options.statsInterval = std::stol(value);
+      else
+        return false;
+    }
+    return !options.model.empty();
+  }
+
+  VecS parseRow(const std::string& line) {
+    VecS row;
+    boost::split(row, line, boost::is_any_of(","));
+    for (auto& value: row)
+      boost::trim(value);
+    return row;
+  }
+
+  MicroBatcher::Predictor makePredictor(const ModelRegistry& registry) {
+    return [&registry](const Data& rows, VecS& predictions) {
+      const auto model = registry.acquire();
+      const size_t numFeatures = model->schema().numFeatures();
+      Data valid;
+      std::vector<size_t> positions;
+      for (size_t i = 0; i < rows.size(); i++) {
+        if (rows[i].size() < numFeatures) {
+          predictions[i] = "ERROR expected " + std::to_string(numFeatures) + " values";
+        } else {
+          valid.push_back(rows[i]);
+          positions.push_back(i);
+        }
+      }
+      const auto classes = model->predictBatch(valid);
+      for (size_t i = 0; i < positions.size(); i++)
+        predictions[positions[i]] = model->schema().classes()[classes[i]];
+    };
+  }
+
+  std::shared_ptr<const Forest> loadModel(const std::string& filename) {
+    // Check every node, so a bad file is rejected here and not while serving.
+    auto model = std::make_shared<const Forest>(ModelIO::load(filename, true));
+    std::cerr << "Loaded " << model->numTrees() << " tree(s), " << model->schema().numFeatures()
+              << " features, " << model->schema().numClasses() << " classes" << std::endl;
+    return model;
+  }
+
+  /**
+   * Client connection; closed once the reader is done and the last pending
+   * answer has been written.
+   */
+  class Connection {
+    public:
+      explicit Connection(int fd) : fd_(fd), mutex_() {}
+      Connection(const Connection&) = delete;
+      Connection& operator=(const Connection&) = delete;
+      ~Connection() { ::close(fd_); }
+
+      void write(const std::string& line) {
+        const std::string out = line + "\n";
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t written = 0;
+        while (written < out.size()) {
+          const ssize_t n = ::send(fd_, out.data() + written, out.size() - written, MSG_NOSIGNAL);
+          if (n <= 0)
+            return;
+          written += static_cast<size_t>(n);
+        }
+      }
+
+      inline int fd() const { return fd_; }
+
+    private:
+      const int fd_;
+      std::mutex mutex_;
+  };
+
+  void serveConnection(std::shared_ptr<Connection> connection, MicroBatcher& batcher) {
+    std::string buffer;
+    char chunk[64 * 1024];
+    while (!stopRequested) {
+      const ssize_t n = ::recv(connection->fd(), chunk, sizeof(chunk), 0);
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        continue;
+      if (n <= 0)
+        break;
+      buffer.append(chunk, static_cast<size_t>(n));
+
+      size_t start = 0, end;
+      while ((end = buffer.find('\n', start)) != std::string::npos) {
+        std::string line = buffer.substr(start, end - start);
+        start = end + 1;
+        boost::trim(line);
+        if (line.empty())
+          continue;
+        if (line == "STATS") {
+          connection->write(batcher.summary());
+          continue;
+        }
+        batcher.submit(parseRow(line), [connection](const std::string& prediction) {
+          connection->write(prediction);
+        });
+      }
+      buffer.erase(0, start);
+    }
+  }
+
+  int serveSocket(const Options& options, MicroBatcher& batcher) {
+    const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (listener < 0 || options.socket.size() >= sizeof(address.sun_path)) {
+      std::cerr << "Can't create socket: " << options.socket << std::endl;
+      return 1;
+    }
+    std::strncpy(address.sun_path, options.socket.c_str(), sizeof(address.sun_path) - 1);
+    ::unlink(options.socket.c_str());
+    if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || ::listen(listener, 128) != 0) {
+      std::cerr << "Can't listen on socket: " << options.socket << std::endl;
+      ::close(listener);
+      return 1;
+    }
+    std::cerr << "Listening on " << options.socket << std::endl;
+
+    // Threads of finished clients are joined in the accept loop, so a long
+    // running server does not keep one per connection it ever had.
+    struct Client {
+      std::thread thread;
+      std::shared_ptr<std::atomic<bool>> done;
+    };
+    std::vector<Client> clients;
+    auto reap = [&clients]() {
+      for (auto it = clients.begin(); it != clients.end();) {
+        if (it->done->load()) {
+          it->thread.join();
+          it = clients.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    };
+    while (!stopRequested) {
+      reap();
+      pollfd pfd{listener, POLLIN, 0};
+      if (::poll(&pfd, 1, 200) <= 0)
+        continue;
+      const int fd = ::accept(listener, nullptr, nullptr);
+      if (fd < 0)
+        continue;
+      // Wake up regularly to notice a stop request on idle connections.
+      timeval timeout{0, 200000};
+      ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+      auto connection = std::make_shared<Connection>(fd);
+      auto done = std::make_shared<std::atomic<bool>>(false);
+      std::thread thread([connection, &batcher, done]() {
+        serveConnection(connection, batcher);
+        done->store(true);
+      });
+      clients.push_back(Client{std::move(thread), done});
+    }
+
+    ::close(listener);
+    ::unlink(options.socket.c_str());
+    for (auto& client: clients)
+      client.thread.join();
+    return 0;
+  }
+
+  int serveStdin(MicroBatcher& batcher) {
+    std::mutex output;
+    std::string line;
+    while (!stopRequested && std::getline(std::cin, line)) {
+      boost::trim(line);
+      if (line.empty() || line[0] == '%')
+        continue;
+      batcher.submit(parseRow(line), [&output](const std::string& prediction) {
+        std::lock_guard<std::mutex> lock(output);
+        std::cout << prediction << '\n';
+      });
+    }
+    return 0;
+  }
+
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  std::signal(SIGINT, requestStop);
+  std::signal(SIGTERM, requestStop);
+  std::signal(SIGHUP, requestReload);
+
+  ModelRegistry registry(loadModel(options.model));
+
+  int status;
+  std::string summary;
+  {
+    MicroBatcher batcher(makePredictor(registry), options.maxBatchSize,
+                         std::chrono::microseconds(options.maxWaitMicros));
+
+    std::atomic<bool> done(false);
+    std::thread reporter([&]() {
+      const auto interval = std::chrono::seconds(std::max(options.statsInterval, 0L));
+      auto next = std::chrono::steady_clock::now() + interval;
+      while (!done) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if (reloadRequested) {
+          reloadRequested = 0;
+          try {
+            registry.publish(loadModel(options.model));
+          } catch (const std::exception& e) {
+            std::cerr << "Reload failed, keeping the current model: " << e.what() << std::endl;
+          }
+        }
+        if (options.statsInterval > 0 && std::chrono::steady_clock::now() >= next) {
+          next += interval;
+          std::cerr << batcher.summary() << std::endl;
+        }
+      }
+    });
+
+    status = options.socket.empty() ? serveStdin(batcher) : serveSocket(options, batcher);
+    done = true;
+    reporter.join();
+    batcher.drain();
+    summary = batcher.summary();
+  }
+  std::cout.flush();
+  std::cerr << summary << std::endl;
+  return status;
+}
@@ -12,6 +12,8 @@ int main() {
   d.test.filename = "../data/covtype_test.arff";
 
   Bagging bc(d, 5);
-  bc.test();
+  bc.test().print();
+  std::cout << "Out-of-bag estimate" << std::endl;
+  bc.outOfBag().print();
   return 0;
 }
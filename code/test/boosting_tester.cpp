@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <iostream>
+#include "../lib/include/Boosting.hpp"
+#include "../lib/include/CrossValidator.hpp"
+
+namespace {
+
+  std::shared_ptr<const DataReader> load(const std::string& name) {
+    Dataset d;
+    d.train.filename = "../data/" + name + ".arff";
+    d.test.filename = "../data/" + name + "_test.arff";
+    return std::make_shared<const DataReader>(d);
+  }
+
+  double accuracy(const Boosting& gb, const Data& rows) {
+    const auto predictions = gb.predictBatch(rows);
+    size_t correct = 0;
+    for (size_t r = 0; r < rows.size(); r++)
+      correct += gb.schema().classes()[predictions[r]] == rows[r].back();
+    return static_cast<double>(correct) / rows.size();
+  }
+
+}
+
+int main() {
+  // Softmax on iris. A stratified fifth of the training rows is held out
+  // for early stopping by giving it weight 0, the model is fitted on the
+  // rest, and the test set is only used to test.
+  const auto iris = load("iris");
+  const CrossValidator folds(iris, 5);
+  Weights weights(iris->trainData().size(), 1);
+  Data validation;
+  for (const auto row: folds.fold(0)) {
+    weights[row] = 0;
+    validation.push_back(iris->trainData()[row]);
+  }
+  BoostingConfig config;
+  config.rounds = 200;
+  config.learningRate = 0.3;
+  const Boosting gb(iris, weights, config, validation);
+  const auto& loss = gb.validationLoss();
+  if (loss.empty()) {
+    std::cout << "No validation loss was recorded" << std::endl;
+    return 1;
+  }
+  const double testAccuracy = accuracy(gb, iris->testData());
+  std::cout << "Kept " << gb.rounds() << " of " << loss.size() << " rounds, validation loss " << loss.back()
+            << ", test accuracy " << testAccuracy << std::endl;
+  if (gb.rounds() == 0 || gb.rounds() > static_cast<size_t>(config.rounds) || testAccuracy < 0.8) {
+    std::cout << "Boosting did not learn iris" << std::endl;
+    return 1;
+  }
+
+  // Early stopping keeps the rounds up to the first one with the lowest
+  // validation loss, after `earlyStoppingRounds` rounds without improvement.
+  const size_t bestRound = std::min_element(loss.begin(), loss.end()) - loss.begin();
+  if (gb.rounds() >= static_cast<size_t>(config.rounds)
+      || loss.size() != bestRound + 1 + config.earlyStoppingRounds || gb.rounds() != bestRound + 1) {
+    std::cout << "Early stopping did not keep the best round " << bestRound << std::endl;
+    return 1;
+  }
+
+  // The logistic loss on tennis, without a validation set: all rounds are
+  // kept and the training rows are learned.
+  const auto tennis = load("tennis");
+  BoostingConfig logistic;
+  logistic.rounds = 50;
+  logistic.lambda = 0.0;
+  logistic.minHessian = 0.0;
+  const Boosting binary(tennis, logistic);
+  const double trainAccuracy = accuracy(binary, tennis->trainData());
+  std::cout << "Tennis training accuracy " << trainAccuracy << std::endl;
+  if (binary.rounds() != static_cast<size_t>(logistic.rounds) || !binary.validationLoss().empty()
+      || trainAccuracy < 0.9) {
+    std::cout << "Boosting did not learn tennis" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <fstream>
+#include <iostream>
+#include "../lib/include/DataReader.hpp"
+
+namespace {
+
+  void write(const std::string& filename, const std::string& rows) {
+    std::ofstream out(filename);
+    out << "@RELATION points\n\n@ATTRIBUTE x NUMERIC\n@ATTRIBUTE color {red,blue}\n"
+        << "@ATTRIBUTE class {yes,no}\n\n@DATA\n" << rows;
+  }
+
+}
+
+int main() {
+  Dataset d;
+  d.train.filename = "points.arff";
+  d.test.filename = "points_test.arff";
+
+  // Blank lines and comments between the rows are not rows.
+  write(d.train.filename, "1,red,yes\n\n% a comment\n  % an indented one\n2,blue,no\n   \n3,red,yes\n");
+  write(d.test.filename, "1,red,yes\n");
+  const DataReader dr(d);
+  if (dr.trainData().size() != 3 || dr.trainColumns().numRows() != 3) {
+    std::cout << "Read " << dr.trainData().size() << " rows instead of 3" << std::endl;
+    return 1;
+  }
+  if (dr.testDataLoaded() || dr.testData().size() != 1 || !dr.testDataLoaded()) {
+    std::cout << "The test set is not loaded on first use" << std::endl;
+    return 1;
+  }
+
+  // A row with a missing value is reported with its line number.
+  write(d.train.filename, "1,red,yes\n2,no\n");
+  try {
+    const DataReader broken(d);
+    std::cout << "A row with too few values was accepted" << std::endl;
+    return 1;
+  } catch (const std::runtime_error& e) {
+    if (std::string(e.what()).find("line 9") == std::string::npos) {
+      std::cout << "Error without the line number: " << e.what() << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -14,6 +14,6 @@ int main() {
   DataReader dr(d);
   DecisionTree dt(dr);
   dt.print();
-  dt.test();
+  dt.test().print();
   return 0;
 }
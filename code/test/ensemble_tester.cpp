@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <vector>
+#include "../lib/include/Bagging.hpp"
+#include "../lib/include/CrossValidator.hpp"
+#include "../lib/include/ModelIO.hpp"
+#include "../lib/include/ThreadPool.hpp"
+
+namespace {
+
+  std::shared_ptr<const DataReader> load(const std::string& name) {
+    Dataset d;
+    d.train.filename = "../data/" + name + ".arff";
+    d.test.filename = "../data/" + name + "_test.arff";
+    return std::make_shared<const DataReader>(d);
+  }
+
+  /** Whether both forests hold the same trees, node for node, in the same order. */
+  bool sameTrees(const Forest& a, const Forest& b) {
+    if (a.numTrees() != b.numTrees())
+      return false;
+    for (size_t t = 0; t < a.numTrees(); t++) {
+      const FlatTree& x = a.trees()[t];
+      const FlatTree& y = b.trees()[t];
+      if (x.numNodes != y.numNodes || x.numLeafCounts != y.numLeafCounts
+          || std::memcmp(x.nodes, y.nodes, x.numNodes * sizeof(FlatNode)) != 0
+          || std::memcmp(x.leafCounts, y.leafCounts, x.numLeafCounts * sizeof(uint32_t)) != 0)
+        return false;
+    }
+    return true;
+  }
+
+  /** Whether both forests hold the same trees, in any order. */
+  bool sameTreeSet(const Forest& a, const Forest& b) {
+    if (a.numTrees() != b.numTrees())
+      return false;
+    std::vector<bool> matched(b.numTrees(), false);
+    for (const auto& x: a.trees()) {
+      bool found = false;
+      for (size_t t = 0; t < b.numTrees() && !found; t++) {
+        const FlatTree& y = b.trees()[t];
+        found = !matched[t] && x.numNodes == y.numNodes && x.numLeafCounts == y.numLeafCounts
+                && std::memcmp(x.nodes, y.nodes, x.numNodes * sizeof(FlatNode)) == 0
+                && std::memcmp(x.leafCounts, y.leafCounts, x.numLeafCounts * sizeof(uint32_t)) == 0;
+        if (found)
+          matched[t] = true;
+      }
+      if (!found)
+        return false;
+    }
+    return true;
+  }
+
+}
+
+int main() {
+  const auto iris = load("iris");
+  const Forest reference = Bagging(iris, 9).flatten();
+
+  // Bags and cross-validations started from tasks on the shared pool, as
+  // many at once as it has threads and one more, so every worker waits for
+  // work of its own, and from the threads of a second, larger pool. The
+  // waiting threads build their own trees, so none of this deadlocks, and
+  // every bag is the bag built on the calling thread.
+  ThreadPool& shared = ThreadPool::shared();
+  ThreadPool outer(4);
+  const CrossValidator cv(iris, 5);
+  const double accuracy = cv.run(TreeConfig()).meanAccuracy;
+  for (ThreadPool* pool: {&shared, &outer}) {
+    std::vector<std::future<Forest>> bags;
+    std::vector<std::future<double>> folds;
+    for (size_t i = 0; i <= pool->size(); i++) {
+      bags.push_back(pool->submit([&iris]() { return Bagging(iris, 9).flatten(); }));
+      folds.push_back(pool->submit([&cv]() { return cv.run(TreeConfig()).meanAccuracy; }));
+    }
+    for (auto& bag: bags) {
+      if (!sameTrees(bag.get(), reference)) {
+        std::cout << "A bag built on a pool of " << pool->size() << " threads differs" << std::endl;
+        return 1;
+      }
+    }
+    for (auto& fold: folds) {
+      if (fold.get() != accuracy) {
+        std::cout << "Cross-validation on a pool of " << pool->size() << " threads differs" << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  // Early exit must not change a single prediction, also for an even
+  // number of trees where votes can tie, and when the leader is a class of
+  // higher index than one that can still catch up: ties go to the lower one.
+  if (Forest::decided(std::vector<uint32_t>{2, 3}.data(), 2, 1)
+      || !Forest::decided(std::vector<uint32_t>{1, 3}.data(), 2, 1)) {
+    std::cout << "A vote that can still tie was settled, or one that can't was not" << std::endl;
+    return 1;
+  }
+  Data rows = iris->trainData();
+  rows.insert(rows.end(), iris->testData().begin(), iris->testData().end());
+  for (const int size: {1, 8, 9}) {
+    for (const size_t mtry: {size_t(0), size_t(1)}) {
+      TreeConfig config;
+      config.mtry = mtry;
+      Forest forest = Bagging(iris, size, config).flatten();
+      forest.setEarlyExit(false);
+      const auto full = forest.predictBatch(rows);
+      forest.setEarlyExit(true);
+      const auto early = forest.predictBatch(rows);
+      std::vector<double> x(forest.schema().numFeatures());
+      for (size_t r = 0; r < rows.size(); r++) {
+        forest.schema().encode(rows[r], x.data());
+        if (early[r] != full[r] || forest.predict(x.data()) != full[r]) {
+          std::cout << "Early exit changed the prediction of row " << r << " with " << size << " trees" << std::endl;
+          return 1;
+        }
+      }
+    }
+  }
+
+  // Learner i always draws from stream i of the seed, so an ensemble grown
+  // in steps, or grown after loading it from a file, is the ensemble built
+  // at its final size at once.
+  Bagging grown(iris, 0);
+  grown.addTrees(4);
+  grown.addTrees(5);
+  if (grown.size() != 9 || !sameTrees(grown.flatten(), reference)) {
+    std::cout << "An ensemble grown in steps differs from one built at once" << std::endl;
+    return 1;
+  }
+  Bagging(iris, 4).save("ensemble_head.model");
+  Bagging continued(iris, ModelIO::load("ensemble_head.model"));
+  continued.addTrees(5);
+  const Forest continuedForest = continued.flatten();
+  if (continued.size() != 9 || !sameTreeSet(continuedForest, reference)
+      || continuedForest.predictBatch(rows) != reference.predictBatch(rows)) {
+    std::cout << "A loaded ensemble did not continue the random stream" << std::endl;
+    return 1;
+  }
+  return 0;
+}
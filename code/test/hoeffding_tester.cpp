@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <random>
+#include "../lib/include/DataReader.hpp"
+#include "../lib/include/HoeffdingTree.hpp"
+
+int main() {
+  Dataset d;
+  d.train.filename = "../data/iris.arff";
+  d.test.filename = "../data/iris_test.arff";
+
+  DataReader dr(d);
+  HoeffdingConfig config;
+  config.gracePeriod = 20;
+  config.maxLeaves = 4;
+  HoeffdingTree ht(dr.metaData(), config);
+
+  // Feed the training set as a stream, one row at a time, 60 times over in
+  // a different order each time.
+  Data rows = dr.trainData();
+  std::mt19937_64 random_number_generator(1234);
+  boost::timer::cpu_timer timer;
+  for (int pass = 0; pass < 60; pass++) {
+    std::shuffle(rows.begin(), rows.end(), random_number_generator);
+    ht.learn(rows);
+  }
+  std::cout << "Learned " << ht.numRows() << " rows into " << ht.numLeaves() << " leaves in "
+            << timer.format() << std::endl;
+  const Metrics metrics = ht.evaluate(dr.trainData());
+  metrics.print();
+
+  // The classes are equally frequent, so a single leaf gets a third right.
+  if (ht.numLeaves() > config.maxLeaves || ht.numLeaves() < 2 || metrics.accuracy() < 0.9) {
+    std::cout << "The tree did not learn the stream" << std::endl;
+    return 1;
+  }
+
+  std::vector<double> x(ht.schema().numFeatures(), 0.0);
+  try {
+    ht.learn(x.data(), static_cast<uint32_t>(ht.schema().numClasses()));
+    std::cout << "A class code out of range was accepted" << std::endl;
+    return 1;
+  } catch (const std::invalid_argument&) {}
+  return 0;
+}
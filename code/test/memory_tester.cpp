@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <iostream>
+#include <numeric>
+#include "../lib/include/Bagging.hpp"
+#include "../lib/include/Memory.hpp"
+
+int main() {
+  Dataset d;
+  d.train.filename = "../data/iris.arff";
+  d.test.filename = "../data/iris_test.arff";
+  const auto iris = std::make_shared<const DataReader>(d);
+
+  // The data set is shared by all learners, so it is counted once whatever
+  // the size of the ensemble, and the trees add up to their members.
+  const MemoryUsage one = Bagging(iris, 1).memoryUsage();
+  const MemoryUsage five = Bagging(iris, 5).memoryUsage();
+  Memory::print(std::cout, five);
+  if (one.dataset != Memory::bytes(*iris) || five.dataset != one.dataset) {
+    std::cout << "The data set is not counted exactly once" << std::endl;
+    return 1;
+  }
+  if (five.members.size() != 5 || five.nodes + five.leaves == 0
+      || std::accumulate(five.members.begin(), five.members.end(), size_t(0)) != five.nodes + five.leaves) {
+    std::cout << "The trees do not add up to the ensemble members" << std::endl;
+    return 1;
+  }
+
+  // A generous budget lets training run, one below the resident set size
+  // stops it before anything is allocated.
+  Memory::setBudget(size_t(1) << 40);
+  Memory::checkBudget("a generous budget");
+  Memory::setBudget(1);
+  try {
+    Memory::checkBudget("a tiny budget");
+    std::cout << "Exceeding the budget did not throw" << std::endl;
+    return 1;
+  } catch (const Memory::BudgetExceeded&) {}
+  try {
+    Bagging(iris, 5);
+    std::cout << "An ensemble was built over the budget" << std::endl;
+    return 1;
+  } catch (const Memory::BudgetExceeded& e) {
+    std::cout << e.what() << std::endl;
+  }
+  Memory::setBudget(0);
+  Memory::checkBudget("no budget", size_t(1) << 50);
+  return 0;
+}
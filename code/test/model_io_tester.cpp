@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include "../lib/include/Bagging.hpp"
+#include "../lib/include/CompactForest.hpp"
+#include "../lib/include/ModelIO.hpp"
+
+int main() {
+  Dataset d;
+  d.train.filename = "../data/iris.arff";
+  d.test.filename = "../data/iris_test.arff";
+
+  DataReader dr(d);
+  Bagging bc(dr, 5);
+  bc.save("iris_bagging.model");
+
+  const Forest model = ModelIO::load("iris_bagging.model", true);
+  const Metrics expected = bc.test();
+  const Metrics loaded = model.evaluate(dr.testData());
+  loaded.print();
+  if (model.numTrees() != 5 || loaded.correct() != expected.correct()) {
+    std::cout << "Loaded model does not match the trained ensemble" << std::endl;
+    return 1;
+  }
+
+  // Compression with all thresholds kept must not change a single vote.
+  ModelIO::saveCompact(CompactForest(bc.flatten()), "iris_bagging.cmodel");
+  const CompactForest compact = ModelIO::loadCompact("iris_bagging.cmodel");
+  if (compact.predictBatch(dr.testData()) != model.predictBatch(dr.testData())) {
+    std::cout << "Compressed model does not match the trained ensemble" << std::endl;
+    return 1;
+  }
+
+  // A root that tests a feature beyond the schema must not pass verification.
+  std::string bytes;
+  {
+    std::ifstream in("iris_bagging.model", std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  uint64_t tableOffset = 0;
+  uint64_t nodesOffset = 0;
+  std::memcpy(&tableOffset, bytes.data() + 56, sizeof(tableOffset));
+  std::memcpy(&nodesOffset, bytes.data() + tableOffset, sizeof(nodesOffset));
+  const auto rejects = [](std::string corrupt) {
+    {
+      std::ofstream out("iris_corrupt.model", std::ios::binary);
+      out.write(corrupt.data(), static_cast<std::streamsize>(corrupt.size()));
+    }
+    try {
+      ModelIO::load("iris_corrupt.model", true);
+      return false;
+    } catch (const std::runtime_error&) {
+      return true;
+    }
+  };
+  std::string badFeature = bytes;
+  const uint32_t feature = 1000;
+  std::memcpy(&badFeature[nodesOffset], &feature, sizeof(feature));
+  if (!rejects(badFeature)) {
+    std::cout << "A node with an invalid feature passed verification" << std::endl;
+    return 1;
+  }
+
+  // Offsets so large that offset + size wraps around must not pass the bounds checks.
+  const uint64_t huge = ~uint64_t(7);
+  std::string badNodes = bytes;
+  std::memcpy(&badNodes[tableOffset], &huge, sizeof(huge));
+  std::string badSchema = bytes;
+  std::memcpy(&badSchema[40], &huge, sizeof(huge));
+  if (!rejects(badNodes) || !rejects(badSchema)) {
+    std::cout << "An offset beyond the end of the file was accepted" << std::endl;
+    return 1;
+  }
+  return 0;
+}
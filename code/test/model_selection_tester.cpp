@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include "../lib/include/BatchTrainer.hpp"
+#include "../lib/include/CrossValidator.hpp"
+#include "../lib/include/HyperparameterSearch.hpp"
+#include "../lib/include/Pruning.hpp"
+
+namespace {
+
+  std::shared_ptr<const DataReader> load(const std::string& name) {
+    Dataset d;
+    d.train.filename = "../data/" + name + ".arff";
+    d.test.filename = "../data/" + name + "_test.arff";
+    return std::make_shared<const DataReader>(d);
+  }
+
+  int smallestLeaf(const Node& node) {
+    if (node.leaf() != nullptr) {
+      int rows = 0;
+      for (const auto& [label, count]: node.leaf()->predictions())
+        rows += count;
+      return rows;
+    }
+    return std::min(smallestLeaf(*node.trueBranch()), smallestLeaf(*node.falseBranch()));
+  }
+
+}
+
+int main() {
+  const auto iris = load("iris");
+  const ColumnStore& store = iris->trainColumns();
+
+  // Folds are disjoint, cover every row and hold every class in proportion.
+  const CrossValidator cv(iris, 5);
+  std::vector<int> seen(store.numRows(), 0);
+  for (size_t f = 0; f < cv.numFolds(); f++) {
+    std::vector<size_t> perClass(store.numClasses(), 0);
+    for (const auto row: cv.fold(f)) {
+      seen[row]++;
+      perClass[store.labels()[row]]++;
+    }
+    for (const auto count: perClass) {
+      if (count != 10) {
+        std::cout << "Fold " << f << " is not stratified" << std::endl;
+        return 1;
+      }
+    }
+  }
+  if (std::count(seen.begin(), seen.end(), 1) != static_cast<long>(seen.size())) {
+    std::cout << "Folds do not partition the rows" << std::endl;
+    return 1;
+  }
+
+  // Splits that leave fewer than minLeaf rows on a side are never made.
+  TreeConfig config;
+  config.minLeaf = 20;
+  const DecisionTree bounded(iris, Weights(), config);
+  if (smallestLeaf(bounded.root_) < 20) {
+    std::cout << "A leaf has fewer than minLeaf rows" << std::endl;
+    return 1;
+  }
+
+  // Nine configurations on 120 rows: rounds of 13, 40 and 120 rows, each
+  // keeping the best third.
+  SearchSpace space;
+  space.maxDepth = {1, 2, 3};
+  space.minLeaf = {1, 5, 20};
+  SearchOptions options;
+  options.minRows = 10;
+  const auto results = HyperparameterSearch(iris, options).run(HyperparameterSearch::grid(space));
+  std::map<size_t, size_t> lastRound;
+  std::map<size_t, size_t> rowsOfRound;
+  for (const auto& result: results) {
+    lastRound[result.round]++;
+    rowsOfRound[result.round] = result.rows;
+  }
+  if (results.size() != 9 || results.front().round != 2 || lastRound != std::map<size_t, size_t>{{0, 6}, {1, 2}, {2, 1}}
+      || rowsOfRound != std::map<size_t, size_t>{{0, 13}, {1, 40}, {2, 120}}) {
+    std::cout << "Successive halving kept the wrong number of configurations" << std::endl;
+    return 1;
+  }
+
+  // Jobs of different sizes come back in the order they were given, each
+  // the tree trained on its own.
+  std::vector<TrainingJob> jobs(4);
+  jobs[0].data = load("tennis");
+  jobs[1].data = iris;
+  jobs[2].data = load("fruit");
+  jobs[3].data = iris;
+  jobs[3].config.maxDepth = 2;
+  const BatchResult batch = BatchTrainer().train(jobs);
+  if (batch.trees.size() != jobs.size()) {
+    std::cout << "Batch returned " << batch.trees.size() << " trees for " << jobs.size() << " jobs" << std::endl;
+    return 1;
+  }
+  for (size_t j = 0; j < jobs.size(); j++) {
+    const DecisionTree alone(jobs[j].data, jobs[j].weights, jobs[j].config);
+    const Data& rows = jobs[j].data->trainData();
+    if (Pruning::countNodes(batch.trees[j].root_) != Pruning::countNodes(alone.root_)
+        || batch.trees[j].flatten().predictBatch(rows) != alone.flatten().predictBatch(rows)) {
+      std::cout << "Batch tree " << j << " is not the tree of job " << j << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <vector>
+#include "../lib/include/DecisionTree.hpp"
+#include "../lib/include/PerfCounters.hpp"
+#include "../lib/include/Trace.hpp"
+
+namespace {
+
+  /** Position after the JSON value that starts at or after `pos`, or npos if there is none. */
+  size_t skipValue(const std::string& s, size_t pos) {
+    const auto skipSpace = [&s](size_t p) { return s.find_first_not_of(" \t\r\n", p); };
+    pos = skipSpace(pos);
+    if (pos == std::string::npos)
+      return pos;
+    if (s[pos] == '"') {
+      for (pos++; pos < s.size() && s[pos] != '"'; pos++)
+        pos += s[pos] == '\\';
+      return pos < s.size() ? pos + 1 : std::string::npos;
+    }
+    if (s[pos] == '{' || s[pos] == '[') {
+      const bool object = s[pos] == '{';
+      const char close = object ? '}' : ']';
+      pos = skipSpace(pos + 1);
+      if (pos != std::string::npos && s[pos] == close)
+        return pos + 1;
+      while (pos != std::string::npos) {
+        if (object) {
+          pos = skipValue(s, pos);
+          pos = pos == std::string::npos ? pos : skipSpace(pos);
+          if (pos == std::string::npos || s[pos] != ':')
+            return std::string::npos;
+          pos++;
+        }
+        pos = skipValue(s, pos);
+        pos = pos == std::string::npos ? pos : skipSpace(pos);
+        if (pos == std::string::npos)
+          return pos;
+        if (s[pos] == close)
+          return pos + 1;
+        if (s[pos] != ',')
+          return std::string::npos;
+        pos++;
+      }
+      return pos;
+    }
+    const size_t end = s.find_first_not_of("-+.eE0123456789", pos);
+    if (end != pos)
+      return end;
+    for (const std::string literal: {"true", "false", "null"})
+      if (s.compare(pos, literal.size(), literal) == 0)
+        return pos + literal.size();
+    return std::string::npos;
+  }
+
+  double field(const std::string& event, const std::string& name) {
+    return std::stod(event.substr(event.find("\"" + name + "\": ") + name.size() + 4));
+  }
+
+  /**
+   * Checks the Chrome trace in `filename`: valid JSON, with spans that are
+   * nested or disjoint on every thread. Returns the number of spans, or -1.
+   */
+  long checkTrace(const std::string& filename) {
+    std::ifstream in(filename);
+    const std::string json((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    const size_t end = skipValue(json, 0);
+    if (end == std::string::npos || json.find_first_not_of(" \n", end) != std::string::npos)
+      return -1;
+
+    // The exporter writes one event per line.
+    std::map<int, std::vector<std::pair<double, double>>> spans;
+    std::istringstream lines(json);
+    std::string line;
+    long count = 0;
+    while (std::getline(lines, line)) {
+      if (line.rfind("{\"name\"", 0) != 0)
+        continue;
+      const double ts = field(line, "ts");
+      const double dur = field(line, "dur");
+      if (line.find("\"ph\": \"X\"") == std::string::npos || ts < 0 || dur < 0)
+        return -1;
+      spans[static_cast<int>(field(line, "tid"))].emplace_back(ts, ts + dur);
+      count++;
+    }
+    const double rounding = 0.002;
+    for (auto& [thread, events]: spans) {
+      std::sort(events.begin(), events.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first || (a.first == b.first && a.second > b.second);
+      });
+      std::vector<double> open;
+      for (const auto& [start, stop]: events) {
+        while (!open.empty() && open.back() <= start + rounding)
+          open.pop_back();
+        if (!open.empty() && stop > open.back() + rounding)
+          return -1;
+        open.push_back(stop);
+      }
+    }
+    return count;
+  }
+
+}
+
+int main() {
+  Dataset d;
+  d.train.filename = "../data/iris.arff";
+  d.test.filename = "../data/iris_test.arff";
+  const auto iris = std::make_shared<const DataReader>(d);
+
+  // Counters the kernel refuses, as in most containers, are left out: the
+  // spans still count calls and time and the summary shows n/a for them.
+  const bool counting = PerfCounters::enable();
+  bool missing = false;
+  for (int c = 0; c < PerfCounters::numCounters; c++)
+    missing |= !PerfCounters::available(static_cast<PerfCounters::Counter>(c));
+  if (!counting && !missing) {
+    std::cout << "No counter could be opened, yet all are available" << std::endl;
+    return 1;
+  }
+  {
+    PerfCounters::Scope scope;
+    scope.begin(PerfCounters::noDepth);
+    const DecisionTree tree(iris, Weights(), TreeConfig());
+    scope.end("profiled", 1000);
+  }
+  PerfCounters::enable(false);
+  std::ostringstream summary;
+  PerfCounters::printSummary(summary);
+  std::cout << summary.str();
+  if (summary.str().find("profiled") == std::string::npos || summary.str().find("train_tree") == std::string::npos) {
+    std::cout << "The summary misses a span" << std::endl;
+    return 1;
+  }
+  if (missing && summary.str().find("n/a") == std::string::npos) {
+    std::cout << "The summary does not mark missing counters" << std::endl;
+    return 1;
+  }
+  PerfCounters::reset();
+
+  // Switched off at run time, trace points record nothing.
+  Trace::enable(false);
+  Trace::clear();
+  const DecisionTree untraced(iris, Weights(), TreeConfig());
+  Trace::writeChromeTrace("untraced.json");
+  if (checkTrace("untraced.json") != 0) {
+    std::cout << "Spans were recorded while tracing was off" << std::endl;
+    return 1;
+  }
+
+  Trace::enable();
+  TreeConfig parallel;
+  parallel.parallelDepth = 2;
+  const DecisionTree traced(iris, Weights(), parallel);
+  Trace::enable(false);
+  Trace::writeChromeTrace("traced.json");
+  const long spans = checkTrace("traced.json");
+  std::cout << "Traced " << spans << " spans" << std::endl;
+  if (spans <= 0) {
+    std::cout << "The trace is not valid JSON with nested spans" << std::endl;
+    return 1;
+  }
+  Trace::clear();
+  return 0;
+}
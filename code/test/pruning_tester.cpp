@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <iostream>
+#include "../lib/include/DecisionTree.hpp"
+#include "../lib/include/Pruning.hpp"
+
+namespace {
+
+  size_t trainingCorrect(const DecisionTree& tree, const DataReader& dr) {
+    const auto predictions = tree.flatten().predictBatch(dr.trainData());
+    size_t correct = 0;
+    for (size_t r = 0; r < predictions.size(); r++)
+      correct += predictions[r] == dr.trainColumns().labels()[r];
+    return correct;
+  }
+
+  std::shared_ptr<const DataReader> load(const std::string& name) {
+    Dataset d;
+    d.train.filename = "../data/" + name + ".arff";
+    d.test.filename = "../data/" + name + "_test.arff";
+    return std::make_shared<const DataReader>(d);
+  }
+
+}
+
+int main() {
+  const auto iris = load("iris");
+  DecisionTree tree(iris, Weights(), TreeConfig());
+  const size_t nodes = Pruning::countNodes(tree.root_);
+  const size_t correct = trainingCorrect(tree, *iris);
+
+  // alpha = 0 only removes splits that don't reduce the training error.
+  DecisionTree unpruned = tree;
+  const PruneResult none = unpruned.pruneCostComplexity(0.0);
+  if (none.nodesBefore != nodes || none.nodesAfter > nodes || trainingCorrect(unpruned, *iris) != correct) {
+    std::cout << "Pruning with alpha 0 changed the training accuracy" << std::endl;
+    return 1;
+  }
+
+  // A leaf is worth two misclassified rows here, so the smallest subtrees go.
+  DecisionTree pruned = tree;
+  const PruneResult some = pruned.pruneCostComplexity(2.0 / 150);
+  std::cout << "Pruned " << some.nodesBefore << " to " << some.nodesAfter << " nodes" << std::endl;
+  if (some.nodesAfter >= some.nodesBefore || some.nodesAfter != Pruning::countNodes(pruned.root_)
+      || some.nodesAfter == 1) {
+    std::cout << "Pruning with a small alpha did not shrink the tree" << std::endl;
+    return 1;
+  }
+
+  DecisionTree stump = tree;
+  if (stump.pruneCostComplexity(1e9).nodesAfter != 1 || stump.root_.leaf() == nullptr) {
+    std::cout << "Pruning with a huge alpha did not leave a single leaf" << std::endl;
+    return 1;
+  }
+
+  // A leaf with tied counts predicts the class that comes first in the
+  // schema (Lime before Eggplant in fruit), not the first in the alphabet,
+  // so merging these leaves costs no validation mistakes.
+  const auto fruit = load("fruit");
+  const Node split(Node(Leaf({{"Lime", 1}})), Node(Leaf({{"Eggplant", 1}})), Question(2, 25.0));
+  const Data validation{{"Hard", "Green", "30", "Lime"}};
+  const Node merged = Pruning::reducedError(split, fruit->trainColumns().schema(), validation);
+  if (merged.leaf() == nullptr) {
+    std::cout << "A tie was not broken by class order" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "../lib/include/QuantileSketch.hpp"
+
+int main() {
+  // A skewed stream with many repeated values, as in integer-valued columns.
+  std::mt19937_64 random_number_generator(7);
+  std::exponential_distribution<double> exponential(0.01);
+  std::vector<double> values(1000000);
+  for (auto& value: values)
+    value = std::floor(exponential(random_number_generator));
+  std::vector<double> few(values.begin(), values.begin() + 150);
+
+  // Four parts sketched separately, as by parsing threads, one of them
+  // shipped as bytes, as from a worker process.
+  std::vector<QuantileSketch> parts(4, QuantileSketch(QuantileSketch::defaultK));
+  for (size_t i = 0; i < values.size(); i++)
+    parts[i % parts.size()].add(values[i]);
+  QuantileSketch sketch = QuantileSketch::deserialize(parts[0].serialize());
+  for (size_t p = 1; p < parts.size(); p++)
+    sketch.merge(parts[p]);
+
+  std::sort(values.begin(), values.end());
+  if (sketch.count() != values.size() || sketch.min() != values.front() || sketch.max() != values.back()) {
+    std::cout << "Merged sketch lost values" << std::endl;
+    return 1;
+  }
+  const auto n = static_cast<double>(values.size());
+  double worst = 0.0;
+  for (int percent = 1; percent < 100; percent++) {
+    const double q = percent / 100.0;
+    const double value = sketch.quantile(q);
+    // Any rank the value takes counts, as repeated values span many ranks.
+    const double below = std::lower_bound(values.begin(), values.end(), value) - values.begin();
+    const double upTo = std::upper_bound(values.begin(), values.end(), value) - values.begin();
+    const double error = std::max({0.0, below / n - q, q - upTo / n});
+    worst = std::max(worst, error);
+  }
+  std::cout << "Retained " << sketch.numRetained() << " of " << sketch.count() << " values, worst rank error "
+            << worst << ", bound " << sketch.rankError() << std::endl;
+  if (worst > sketch.rankError()) {
+    std::cout << "Rank error exceeds the bound" << std::endl;
+    return 1;
+  }
+
+  // Below k values nothing is compacted, so the boundaries are exact.
+  QuantileSketch small;
+  for (const auto value: few)
+    small.add(value);
+  std::sort(few.begin(), few.end());
+  const auto bounds = small.boundaries(10);
+  for (size_t b = 0; b < bounds.size(); b++) {
+    if (bounds[b] != few[b * few.size() / bounds.size()]) {
+      std::cout << "Boundaries of a small sketch are not exact" << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <iostream>
+#include <random>
+#include "../lib/include/Bagging.hpp"
+#include "../lib/include/DecisionTree.hpp"
+
+namespace {
+
+  /** Number of leaves that hold rows of more than one class. */
+  size_t impureLeaves(const Node& node) {
+    if (node.leaf() != nullptr) {
+      size_t classes = 0;
+      for (const auto& [label, count]: node.leaf()->predictions())
+        classes += count > 0;
+      return classes > 1;
+    }
+    return impureLeaves(*node.trueBranch()) + impureLeaves(*node.falseBranch());
+  }
+
+  /**
+   * Number of numeric tests of a flattened tree whose threshold leaves all
+   * of `rows`, the encoded training rows that reach the node, on one side.
+   * The tree only saw a bootstrap sample of them, whose values lie within
+   * theirs, so a threshold drawn from the sample's range passes.
+   */
+  size_t thresholdsOutOfRange(const FlatTree& tree, uint32_t index, const std::vector<const double*>& rows) {
+    const FlatNode& node = tree.nodes[index];
+    if (node.kind == FlatNode::Leaf)
+      return 0;
+    std::vector<const double*> trueRows;
+    std::vector<const double*> falseRows;
+    for (const auto x: rows) {
+      const double v = x[node.feature];
+      const bool goTrue = node.kind == FlatNode::Numeric ? v >= node.value : v == node.value;
+      (goTrue ? trueRows : falseRows).push_back(x);
+    }
+    const bool outOfRange = node.kind == FlatNode::Numeric && (trueRows.empty() || falseRows.empty());
+    return outOfRange + thresholdsOutOfRange(tree, node.left, trueRows)
+           + thresholdsOutOfRange(tree, node.right, falseRows);
+  }
+
+  /** Checks a bagged ensemble on iris, returns an error message or an empty string. */
+  std::string checkEnsemble(const Bagging& ensemble, int size, const DataReader& dr) {
+    const Forest forest = ensemble.flatten();
+    if (ensemble.size() != static_cast<size_t>(size) || forest.numTrees() != static_cast<size_t>(size))
+      return "has " + std::to_string(forest.numTrees()) + " trees instead of " + std::to_string(size);
+    const double accuracy = ensemble.test().accuracy();
+    const double outOfBag = ensemble.outOfBag().accuracy();
+    std::cout << "Test accuracy " << accuracy << ", out-of-bag accuracy " << outOfBag << std::endl;
+    if (accuracy < 0.85 || outOfBag < 0.85)
+      return "is not accurate";
+
+    const Data& train = dr.trainData();
+    std::vector<double> encoded(train.size() * forest.schema().numFeatures());
+    std::vector<const double*> rows;
+    for (size_t r = 0; r < train.size(); r++) {
+      rows.push_back(encoded.data() + r * forest.schema().numFeatures());
+      forest.schema().encode(train[r], encoded.data() + r * forest.schema().numFeatures());
+    }
+    for (const auto& tree: forest.trees())
+      if (thresholdsOutOfRange(tree, 0, rows) != 0)
+        return "has a threshold outside the values of its node";
+    return "";
+  }
+
+}
+
+int main() {
+  Dataset d;
+  d.train.filename = "../data/iris.arff";
+  d.test.filename = "../data/iris_test.arff";
+  const auto iris = std::make_shared<const DataReader>(d);
+
+  const DecisionTree full(iris, Weights(), TreeConfig());
+  if (impureLeaves(full.root_) != 0) {
+    std::cout << "The tree on all features has impure leaves" << std::endl;
+    return 1;
+  }
+
+  // Trees that see one or two features per split, on bootstrap samples as
+  // in a random forest, must grow as far: a node whose sample can't split
+  // it draws more features.
+  const size_t n = iris->trainColumns().numRows();
+  std::mt19937_64 random_number_generator(1234);
+  std::uniform_int_distribution<size_t> uniform_sampler(0, n - 1);
+  for (uint64_t seed = 0; seed < 20; seed++) {
+    std::vector<size_t> samples(n);
+    for (auto& sample: samples)
+      sample = uniform_sampler(random_number_generator);
+    TreeConfig config;
+    config.mtry = 1 + seed % 2;
+    config.seed = seed;
+    const DecisionTree tree(iris, DecisionTree::bootstrapWeights(n, samples), config);
+    if (impureLeaves(tree.root_) != 0) {
+      std::cout << "Tree " << seed << " with mtry " << config.mtry << " has impure leaves" << std::endl;
+      return 1;
+    }
+  }
+
+  // The ensembles themselves, with the default feature sample per split.
+  const std::string forestError = checkEnsemble(Bagging::randomForest(iris, 25), 25, *iris);
+  if (!forestError.empty()) {
+    std::cout << "The random forest " << forestError << std::endl;
+    return 1;
+  }
+  const std::string extraError = checkEnsemble(Bagging::extraTrees(iris, 25), 25, *iris);
+  if (!extraError.empty()) {
+    std::cout << "The Extra-Trees ensemble " << extraError << std::endl;
+    return 1;
+  }
+  return 0;
+}
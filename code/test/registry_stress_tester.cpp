@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <atomic>
+#include <thread>
+#include "../lib/include/Bagging.hpp"
+#include "../lib/include/ModelIO.hpp"
+#include "../lib/include/ModelRegistry.hpp"
+
+/**
+ * Predicts continuously from several threads while two models are swapped
+ * in a tight loop. Every model is freshly mapped from disk, so a reader
+ * using a reclaimed model would touch unmapped memory. Each batch of
+ * predictions must match one of the two models exactly.
+ */
+int main() {
+  Dataset d;
+  d.train.filename = "../data/iris.arff";
+  d.test.filename = "../data/iris_test.arff";
+
+  DataReader dr(d);
+  DecisionTree dt(dr);
+  Bagging bc(dr, 5);
+  dt.save("registry_tree.model");
+  bc.save("registry_bagging.model");
+
+  const Data& rows = dr.testData();
+  const auto treePredictions = ModelIO::load("registry_tree.model").predictBatch(rows);
+  const auto baggingPredictions = ModelIO::load("registry_bagging.model").predictBatch(rows);
+
+  ModelRegistry registry(std::make_shared<const Forest>(ModelIO::load("registry_tree.model")));
+  std::atomic<bool> stop(false);
+  std::atomic<size_t> predictions(0);
+  std::atomic<size_t> mismatches(0);
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 4; r++) {
+    readers.emplace_back([&]() {
+      while (!stop) {
+        const auto model = registry.acquire();
+        const auto& expected = model->numTrees() == 1 ? treePredictions : baggingPredictions;
+        std::vector<double> x(model->schema().numFeatures());
+        for (size_t i = 0; i < rows.size(); i++) {
+          model->schema().encode(rows[i], x.data());
+          if (model->predict(x.data()) != expected[i])
+            mismatches++;
+        }
+        predictions += rows.size();
+      }
+    });
+  }
+
+  size_t swaps = 0;
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+  while (std::chrono::steady_clock::now() < deadline) {
+    const char* file = swaps % 2 == 0 ? "registry_bagging.model" : "registry_tree.model";
+    registry.publish(std::make_shared<const Forest>(ModelIO::load(file)));
+    swaps++;
+  }
+  stop = true;
+  for (auto& reader: readers)
+    reader.join();
+  registry.reclaim();
+
+  std::cout << "swaps=" << swaps << " predictions=" << predictions
+            << " mismatches=" << mismatches << " retired=" << registry.retired() << std::endl;
+  if (mismatches != 0 || registry.retired() != 0 || swaps == 0)
+    return 1;
+
+  // Releasing the last handle of a retired model leaves it to the writer.
+  {
+    const auto pinned = registry.acquire();
+    registry.publish(std::make_shared<const Forest>(ModelIO::load("registry_tree.model")));
+  }
+  if (registry.retired() != 1) {
+    std::cout << "A reader freed a retired model" << std::endl;
+    return 1;
+  }
+  registry.reclaim();
+
+  // Once every slot is taken, acquire fails instead of waiting.
+  std::vector<ModelRegistry::Handle> handles;
+  for (size_t i = 0; i < ModelRegistry::maxReaders; i++)
+    handles.push_back(registry.acquire());
+  try {
+    registry.acquire();
+    std::cout << "More than maxReaders handles were handed out" << std::endl;
+    return 1;
+  } catch (const std::runtime_error&) {}
+  return 0;
+}
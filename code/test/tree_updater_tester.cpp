@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) DTAI - KU Leuven – All rights reserved.
+ * Proprietary, do not copy or distribute without permission.
+ * Written by Pieter Robberechts, 2019
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../lib/include/DecisionTree.hpp"
+#include "../lib/include/Pruning.hpp"
+
+namespace {
+
+  void writeArff(const std::vector<std::string>& header, const std::vector<std::string>& rows, size_t n,
+                 const std::string& filename) {
+    std::ofstream out(filename);
+    for (const auto& line: header)
+      out << line << "\n";
+    for (size_t r = 0; r < n; r++)
+      out << rows[r] << "\n";
+  }
+
+  /** Class counts of the leaves, left to right. */
+  void leafCounts(const Node& node, std::vector<ClassCounter>& counts) {
+    if (node.leaf() != nullptr) {
+      counts.push_back(node.leaf()->predictions());
+      return;
+    }
+    leafCounts(*node.trueBranch(), counts);
+    leafCounts(*node.falseBranch(), counts);
+  }
+
+  bool sameTree(const DecisionTree& a, const DecisionTree& b, const Data& rows) {
+    std::vector<ClassCounter> countsA;
+    std::vector<ClassCounter> countsB;
+    leafCounts(a.root_, countsA);
+    leafCounts(b.root_, countsB);
+    return countsA == countsB && a.flatten().predictBatch(rows) == b.flatten().predictBatch(rows);
+  }
+
+}
+
+int main() {
+  // The fruit rows in a random order, of which the first part is trained on
+  // and the rest added in two updates. Its numeric column has fewer
+  // distinct values than bins, so the binned check sees every split the
+  // learner does.
+  std::vector<std::string> header;
+  std::vector<std::string> rows;
+  {
+    std::ifstream in("../data/fruit.arff");
+    std::string line;
+    bool data = false;
+    while (std::getline(in, line)) {
+      if (!data)
+        header.push_back(line);
+      else if (!line.empty())
+        rows.push_back(line);
+      data |= line.rfind("@DATA", 0) == 0 || line.rfind("@data", 0) == 0;
+    }
+  }
+  std::mt19937_64 random_number_generator(3);
+  std::shuffle(rows.begin(), rows.end(), random_number_generator);
+  const size_t trained = rows.size() / 2;
+  writeArff(header, rows, trained, "fruit_head.arff");
+  writeArff(header, rows, rows.size(), "fruit_all.arff");
+
+  Dataset head;
+  head.train.filename = "fruit_head.arff";
+  head.test.filename = "../data/fruit_test.arff";
+  Dataset all = head;
+  all.train.filename = "fruit_all.arff";
+  const auto full = std::make_shared<const DataReader>(all);
+  const Data& allRows = full->trainData();
+
+  // With tolerance 0 every node whose split is no longer the best is
+  // retrained, so the updated tree is the tree trained on all rows.
+  DecisionTree updated(std::make_shared<const DataReader>(head), Weights(), TreeConfig());
+  const size_t middle = (trained + allRows.size()) / 2;
+  size_t rebuilt = updated.update(Data(allRows.begin() + trained, allRows.begin() + middle), 0.0);
+  // A copy is updated on its own statistics, not on those of the original.
+  DecisionTree copy = updated;
+  rebuilt += updated.update(Data(allRows.begin() + middle, allRows.end()), 0.0);
+  copy.update(Data(allRows.begin() + middle, allRows.end()), 0.0);
+  const DecisionTree retrained(full, Weights(), TreeConfig());
+
+  const size_t updatedNodes = Pruning::countNodes(updated.root_);
+  const size_t retrainedNodes = Pruning::countNodes(retrained.root_);
+  std::cout << "Updated tree: " << updatedNodes << " nodes, " << rebuilt << " subtrees retrained; retrained tree: "
+            << retrainedNodes << " nodes" << std::endl;
+  if (updatedNodes != retrainedNodes || !sameTree(updated, retrained, allRows)) {
+    std::cout << "Updated tree does not match the tree trained on all rows" << std::endl;
+    return 1;
+  }
+  if (!sameTree(copy, retrained, allRows)) {
+    std::cout << "Updated copy does not match the tree trained on all rows" << std::endl;
+    return 1;
+  }
+
+  // Rows that don't change the class proportions don't change the best
+  // splits, and the impure leaves at the depth limit can't be split.
+  TreeConfig shallow;
+  shallow.maxDepth = 2;
+  DecisionTree limited(full, Weights(), shallow);
+  for (int repeat = 0; repeat < 3; repeat++) {
+    if (limited.update(allRows) != 0) {
+      std::cout << "Rows that change no split retrained a subtree" << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}